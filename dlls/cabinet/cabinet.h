@@ -148,6 +148,9 @@ struct ZIPstate {
     cab_ULONG v[ZIPN_MAX];      /* values in order of bit length */
     cab_ULONG x[ZIPBMAX+1];     /* bit offsets, then code stack */
     cab_UBYTE *inpos;
+    struct Ziphuft *fixed_tl;   /* fixed literal/length table, built once */
+    struct Ziphuft *fixed_td;   /* fixed distance table, built once */
+    cab_LONG  fixed_bl, fixed_bd;
 };
   
 /* Quantum stuff */
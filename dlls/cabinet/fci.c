@@ -188,9 +188,25 @@ typedef struct FCI_Int
   cab_ULONG          pending_data_size;   /* size of data not yet assigned to a folder */
   cab_ULONG          folders_data_size;   /* total size of data contained in the current folders */
   TCOMP              compression;
-  cab_UWORD        (*compress)(struct FCI_Int *);
+  cab_UWORD        (*compress)(struct FCI_Int *, const unsigned char *, cab_UWORD, unsigned char *);
+  unsigned int       max_threads;         /* number of threads compressing blocks */
+  unsigned char     *batch_in;            /* uncompressed blocks of a batch */
+  unsigned char     *batch_out;           /* compressed blocks of a batch */
 } FCI_Int;
 
+/* number of blocks read and compressed in parallel at a time */
+#define FCI_BATCH_BLOCKS 16
+
+struct compress_batch
+{
+    FCI_Int     *fci;
+    LONG         count;                          /* number of blocks */
+    LONG         next;                           /* next block to compress */
+    LONG         workers;                        /* worker threads still running */
+    HANDLE       done;                           /* signaled when all workers are done */
+    cab_UWORD    compressed[FCI_BATCH_BLOCKS];
+};
+
 #define FCI_INT_MAGIC 0xfcfcfc05
 
 static void set_error( FCI_Int *fci, int oper, int err )
@@ -309,14 +325,13 @@ static void free_file( FCI_Int *fci, struct file *file )
     fci->free( file );
 }
 
-/* create a new data block for the data in fci->data_in */
-static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+/* add an already compressed block to the folder data */
+static BOOL write_data_block( FCI_Int *fci, const unsigned char *data, cab_UWORD compressed,
+                              cab_UWORD uncompressed, PFNFCISTATUS status_callback )
 {
     int err;
     struct data_block *block;
 
-    if (!fci->cdata_in) return TRUE;
-
     if (fci->data.handle == -1 && !create_temp_file( fci, &fci->data )) return FALSE;
 
     if (!(block = fci->alloc( sizeof(*block) )))
@@ -324,10 +339,10 @@ static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
         set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return FALSE;
     }
-    block->uncompressed = fci->cdata_in;
-    block->compressed   = fci->compress( fci );
+    block->uncompressed = uncompressed;
+    block->compressed   = compressed;
 
-    if (fci->write( fci->data.handle, fci->data_out,
+    if (fci->write( fci->data.handle, (void *)data,
                     block->compressed, &err, fci->pv ) != block->compressed)
     {
         set_error( fci, FCIERR_TEMP_FILE, err );
@@ -335,7 +350,6 @@ static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
         return FALSE;
     }
 
-    fci->cdata_in = 0;
     fci->pending_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + block->compressed;
     fci->cCompressedBytesInFolder += block->compressed;
     fci->cDataBlocks++;
@@ -349,6 +363,120 @@ static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
     return TRUE;
 }
 
+/* create a new data block for the data in fci->data_in */
+static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    cab_UWORD compressed;
+
+    if (!fci->cdata_in) return TRUE;
+
+    if (!(compressed = fci->compress( fci, fci->data_in, fci->cdata_in, fci->data_out )))
+    {
+        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+        return FALSE;
+    }
+    if (!write_data_block( fci, fci->data_out, compressed, fci->cdata_in, status_callback ))
+        return FALSE;
+
+    fci->cdata_in = 0;
+    return TRUE;
+}
+
+static void compress_batch_blocks( struct compress_batch *batch )
+{
+    FCI_Int *fci = batch->fci;
+    LONG i;
+
+    while ((i = InterlockedIncrement( &batch->next ) - 1) < batch->count)
+        batch->compressed[i] = fci->compress( fci, fci->batch_in + i * CAB_BLOCKMAX, CAB_BLOCKMAX,
+                                              fci->batch_out + i * 2 * CAB_BLOCKMAX );
+}
+
+static DWORD CALLBACK compress_batch_thread( void *arg )
+{
+    struct compress_batch *batch = arg;
+
+    compress_batch_blocks( batch );
+    if (!InterlockedDecrement( &batch->workers )) SetEvent( batch->done );
+    return 0;
+}
+
+/* read up to FCI_BATCH_BLOCKS full blocks, compress them in parallel and add
+ * them in order; a trailing partial block is left in fci->data_in.
+ * Returns -1 on error, 0 at the end of the file, 1 if there is more data. */
+static int add_data_batch( FCI_Int *fci, INT_PTR handle, struct file *file, PFNFCISTATUS status_callback )
+{
+    struct compress_batch batch;
+    unsigned char *in = fci->batch_in;
+    unsigned int i, threads;
+    int err, len, size = 0;
+    BOOL eof = FALSE;
+
+    batch.fci     = fci;
+    batch.count   = 0;
+    batch.next    = 0;
+    batch.workers = 0;
+    batch.done    = NULL;
+
+    while (batch.count < FCI_BATCH_BLOCKS && !eof)
+    {
+        in = fci->batch_in + batch.count * CAB_BLOCKMAX;
+        for (size = 0; size < CAB_BLOCKMAX; size += len)
+        {
+            len = fci->read( handle, in + size, CAB_BLOCKMAX - size, &err, fci->pv );
+            if (len == -1)
+            {
+                set_error( fci, FCIERR_READ_SRC, err );
+                return -1;
+            }
+            if (!len)
+            {
+                eof = TRUE;
+                break;
+            }
+        }
+        file->size += size;
+        if (size == CAB_BLOCKMAX)
+        {
+            batch.count++;
+            size = 0;
+        }
+    }
+
+    threads = batch.count > 1 ? min( fci->max_threads, batch.count ) - 1 : 0;
+    if (threads && (batch.done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        batch.workers = threads;
+        for (i = 0; i < threads; i++)
+        {
+            if (QueueUserWorkItem( compress_batch_thread, &batch, WT_EXECUTEDEFAULT )) continue;
+            if (!InterlockedDecrement( &batch.workers )) SetEvent( batch.done );
+        }
+    }
+    compress_batch_blocks( &batch );
+    if (batch.done)
+    {
+        WaitForSingleObject( batch.done, INFINITE );
+        CloseHandle( batch.done );
+    }
+
+    for (i = 0; i < batch.count; i++)
+    {
+        if (!batch.compressed[i])
+        {
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return -1;
+        }
+        if (!write_data_block( fci, fci->batch_out + i * 2 * CAB_BLOCKMAX, batch.compressed[i],
+                               CAB_BLOCKMAX, status_callback ))
+            return -1;
+    }
+
+    memcpy( fci->data_in, in, size );
+    fci->cdata_in = size;
+    return eof ? 0 : 1;
+}
+
 /* add compressed blocks for all the data that can be read from the file */
 static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL execute,
                            PFNFCIGETOPENINFO get_open_info, PFNFCISTATUS status_callback )
@@ -370,6 +498,14 @@ static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL
 
     for (;;)
     {
+        /* compress whole blocks in parallel once the current one is flushed */
+        if (fci->batch_in && !fci->cdata_in)
+        {
+            if ((len = add_data_batch( fci, handle, file, status_callback )) == -1) return FALSE;
+            if (!len) break;
+            continue;
+        }
+
         len = fci->read( handle, fci->data_in + fci->cdata_in,
                          CAB_BLOCKMAX - fci->cdata_in, &err, fci->pv );
         if (!len) break;
@@ -903,45 +1039,43 @@ static BOOL add_files_to_folder( FCI_Int *fci, struct folder *folder, cab_ULONG
     return TRUE;
 }
 
-static cab_UWORD compress_NONE( FCI_Int *fci )
+static cab_UWORD compress_NONE( FCI_Int *fci, const unsigned char *in, cab_UWORD size, unsigned char *out )
 {
-    memcpy( fci->data_out, fci->data_in, fci->cdata_in );
-    return fci->cdata_in;
+    memcpy( out, in, size );
+    return size;
 }
 
 #ifdef HAVE_ZLIB
 
+/* blocks may be compressed on worker threads, so zlib memory doesn't come
+ * from the caller's allocator which isn't required to be thread safe */
 static void *zalloc( void *opaque, unsigned int items, unsigned int size )
 {
-    FCI_Int *fci = opaque;
-    return fci->alloc( items * size );
+    return HeapAlloc( GetProcessHeap(), 0, items * size );
 }
 
 static void zfree( void *opaque, void *ptr )
 {
-    FCI_Int *fci = opaque;
-    fci->free( ptr );
+    HeapFree( GetProcessHeap(), 0, ptr );
 }
 
-static cab_UWORD compress_MSZIP( FCI_Int *fci )
+/* compress a single block; the output buffer must hold 2 * CAB_BLOCKMAX bytes */
+static cab_UWORD compress_MSZIP( FCI_Int *fci, const unsigned char *in, cab_UWORD size, unsigned char *out )
 {
     z_stream stream;
 
     stream.zalloc = zalloc;
     stream.zfree  = zfree;
-    stream.opaque = fci;
+    stream.opaque = NULL;
     if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
-    {
-        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return 0;
-    }
-    stream.next_in   = fci->data_in;
-    stream.avail_in  = fci->cdata_in;
-    stream.next_out  = fci->data_out + 2;
-    stream.avail_out = sizeof(fci->data_out) - 2;
+    stream.next_in   = (unsigned char *)in;
+    stream.avail_in  = size;
+    stream.next_out  = out + 2;
+    stream.avail_out = 2 * CAB_BLOCKMAX - 2;
     /* insert the signature */
-    fci->data_out[0] = 'C';
-    fci->data_out[1] = 'K';
+    out[0] = 'C';
+    out[1] = 'K';
     deflate( &stream, Z_FINISH );
     deflateEnd( &stream );
     return stream.total_out + 2;
@@ -1011,6 +1145,7 @@ HFCI __cdecl FCICreate(
 	void *pv)
 {
   FCI_Int *p_fci_internal;
+  SYSTEM_INFO si;
 
   if (!perf) {
     SetLastError(ERROR_BAD_ARGUMENTS);
@@ -1071,6 +1206,11 @@ HFCI __cdecl FCICreate(
   p_fci_internal->folders_data_size = 0;
   p_fci_internal->compression = tcompTYPE_NONE;
   p_fci_internal->compress = compress_NONE;
+  p_fci_internal->batch_in = NULL;
+  p_fci_internal->batch_out = NULL;
+
+  GetSystemInfo( &si );
+  p_fci_internal->max_threads = max( si.dwNumberOfProcessors, 1 );
 
   list_init( &p_fci_internal->folders_list );
   list_init( &p_fci_internal->files_list );
@@ -1441,6 +1581,18 @@ BOOL __cdecl FCIAddFile(
 #ifdef HAVE_ZLIB
           p_fci_internal->compression = tcompTYPE_MSZIP;
           p_fci_internal->compress    = compress_MSZIP;
+          if (p_fci_internal->max_threads > 1 && !p_fci_internal->batch_in)
+          {
+              /* not fatal, blocks are compressed one at a time without them */
+              p_fci_internal->batch_in  = p_fci_internal->alloc( FCI_BATCH_BLOCKS * CAB_BLOCKMAX );
+              p_fci_internal->batch_out = p_fci_internal->alloc( FCI_BATCH_BLOCKS * 2 * CAB_BLOCKMAX );
+              if (!p_fci_internal->batch_in || !p_fci_internal->batch_out)
+              {
+                  if (p_fci_internal->batch_in) p_fci_internal->free( p_fci_internal->batch_in );
+                  if (p_fci_internal->batch_out) p_fci_internal->free( p_fci_internal->batch_out );
+                  p_fci_internal->batch_in = p_fci_internal->batch_out = NULL;
+              }
+          }
           break;
 #endif
       default:
@@ -1449,6 +1601,13 @@ BOOL __cdecl FCIAddFile(
       case tcompTYPE_NONE:
           p_fci_internal->compression = tcompTYPE_NONE;
           p_fci_internal->compress    = compress_NONE;
+          if (p_fci_internal->batch_in)
+          {
+              /* storing blocks gains nothing from threads */
+              p_fci_internal->free( p_fci_internal->batch_in );
+              p_fci_internal->free( p_fci_internal->batch_out );
+              p_fci_internal->batch_in = p_fci_internal->batch_out = NULL;
+          }
           break;
       }
   }
@@ -1751,6 +1910,9 @@ BOOL __cdecl FCIDestroy(HFCI hfci)
 
     close_temp_file( p_fci_internal, &p_fci_internal->data );
 
+    if (p_fci_internal->batch_in) p_fci_internal->free( p_fci_internal->batch_in );
+    if (p_fci_internal->batch_out) p_fci_internal->free( p_fci_internal->batch_out );
+
     /* hfci can now be removed */
     p_fci_internal->free(hfci);
     return TRUE;
@@ -184,6 +184,17 @@ typedef struct fdi_cds_fwd {
 #define DECR_OUTPUT       (6)
 #define DECR_USERABORT    (7)
 
+/* copy a match within the window; the source may overlap the destination
+ * only when it lies behind it, in which case the run is repeated */
+static inline void fdi_copy_match(cab_UBYTE *dest, const cab_UBYTE *src, int len)
+{
+  if (len <= 0) return;
+  if (src > dest || dest - src >= len)
+    memmove(dest, src, len);
+  else
+    while (len--) *dest++ = *src++;
+}
+
 static void set_error( FDI_Int *fdi, int oper, int err )
 {
     fdi->perf->erfOper = oper;
@@ -1172,10 +1183,9 @@ static cab_LONG fdi_Zipinflate_codes(const struct Ziphuft *tl, const struct Ziph
         e = ZIPWSIZE - max(d, w);
         e = min(e, n);
         n -= e;
-        do
-        {
-          CAB(outbuf)[w++] = CAB(outbuf)[d++];
-        } while (--e);
+        fdi_copy_match(CAB(outbuf) + w, CAB(outbuf) + d, e);
+        w += e;
+        d += e;
       } while (n);
     }
   }
@@ -1218,13 +1228,21 @@ static cab_LONG fdi_Zipinflate_stored(fdi_decomp_state *decomp_state)
     return 1;                   /* error in compressed data */
   ZIPDUMPBITS(16)
 
-  /* read and output the compressed data */
-  while(n--)
+  if (w + n > ZIPWSIZE)
+    return 1;
+
+  /* drain whole bytes left in the bit buffer, then copy the rest directly */
+  while(n && k >= 8)
   {
-    ZIPNEEDBITS(8)
     CAB(outbuf)[w++] = (cab_UBYTE)b;
     ZIPDUMPBITS(8)
+    n--;
   }
+  if (ZIP(inpos) + n > CAB(inbuf) + sizeof(CAB(inbuf)))
+    return 1;
+  memcpy(CAB(outbuf) + w, ZIP(inpos), n);
+  ZIP(inpos) += n;
+  w += n;
 
   /* restore the globals from the locals */
   ZIP(window_posn) = w;              /* restore global window pointer */
@@ -1238,43 +1256,54 @@ static cab_LONG fdi_Zipinflate_stored(fdi_decomp_state *decomp_state)
  */
 static cab_LONG fdi_Zipinflate_fixed(fdi_decomp_state *decomp_state)
 {
-  struct Ziphuft *fixed_tl;
-  struct Ziphuft *fixed_td;
-  cab_LONG fixed_bl, fixed_bd;
   cab_LONG i;                /* temporary variable */
   cab_ULONG *l;
 
-  l = ZIP(ll);
-
-  /* literal table */
-  for(i = 0; i < 144; i++)
-    l[i] = 8;
-  for(; i < 256; i++)
-    l[i] = 9;
-  for(; i < 280; i++)
-    l[i] = 7;
-  for(; i < 288; i++)          /* make a complete, but wrong code set */
-    l[i] = 8;
-  fixed_bl = 7;
-  if((i = fdi_Ziphuft_build(l, 288, 257, Zipcplens, Zipcplext, &fixed_tl, &fixed_bl, decomp_state)))
-    return i;
-
-  /* distance table */
-  for(i = 0; i < 30; i++)      /* make an incomplete code set */
-    l[i] = 5;
-  fixed_bd = 5;
-  if((i = fdi_Ziphuft_build(l, 30, 0, Zipcpdist, Zipcpdext, &fixed_td, &fixed_bd, decomp_state)) > 1)
+  /* the fixed tables never change, so only build them once per folder */
+  if (!ZIP(fixed_tl))
   {
-    fdi_Ziphuft_free(CAB(fdi), fixed_tl);
-    return i;
+    struct Ziphuft *fixed_tl, *fixed_td;
+
+    l = ZIP(ll);
+
+    /* literal table */
+    for(i = 0; i < 144; i++)
+      l[i] = 8;
+    for(; i < 256; i++)
+      l[i] = 9;
+    for(; i < 280; i++)
+      l[i] = 7;
+    for(; i < 288; i++)          /* make a complete, but wrong code set */
+      l[i] = 8;
+    ZIP(fixed_bl) = 7;
+    if((i = fdi_Ziphuft_build(l, 288, 257, Zipcplens, Zipcplext, &fixed_tl, &ZIP(fixed_bl), decomp_state)))
+      return i;
+
+    /* distance table */
+    for(i = 0; i < 30; i++)      /* make an incomplete code set */
+      l[i] = 5;
+    ZIP(fixed_bd) = 5;
+    if((i = fdi_Ziphuft_build(l, 30, 0, Zipcpdist, Zipcpdext, &fixed_td, &ZIP(fixed_bd), decomp_state)) > 1)
+    {
+      fdi_Ziphuft_free(CAB(fdi), fixed_tl);
+      return i;
+    }
+    ZIP(fixed_tl) = fixed_tl;
+    ZIP(fixed_td) = fixed_td;
   }
 
   /* decompress until an end-of-block code */
-  i = fdi_Zipinflate_codes(fixed_tl, fixed_td, fixed_bl, fixed_bd, decomp_state);
+  return fdi_Zipinflate_codes(ZIP(fixed_tl), ZIP(fixed_td), ZIP(fixed_bl), ZIP(fixed_bd), decomp_state);
+}
 
-  fdi_Ziphuft_free(CAB(fdi), fixed_td);
-  fdi_Ziphuft_free(CAB(fdi), fixed_tl);
-  return i;
+/******************************************************
+ * fdi_Zipinflate_free_fixed (internal)
+ */
+static void fdi_Zipinflate_free_fixed(fdi_decomp_state *decomp_state)
+{
+  if (ZIP(fixed_tl)) fdi_Ziphuft_free(CAB(fdi), ZIP(fixed_tl));
+  if (ZIP(fixed_td)) fdi_Ziphuft_free(CAB(fdi), ZIP(fixed_td));
+  ZIP(fixed_tl) = ZIP(fixed_td) = NULL;
 }
 
 /**************************************************************
@@ -1578,14 +1607,15 @@ static int QTMfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
         if (copy_length < match_length) {
           match_length -= copy_length;
           window_posn += copy_length;
-          while (copy_length-- > 0) *rundest++ = *runsrc++;
+          fdi_copy_match(rundest, runsrc, copy_length);
+          rundest += copy_length;
           runsrc = window;
         }
       }
       window_posn += match_length;
 
       /* copy match data - no worries about destination wraps */
-      while (match_length-- > 0) *rundest++ = *runsrc++;
+      fdi_copy_match(rundest, runsrc, match_length);
     }
   } /* while (togo > 0) */
 
@@ -1816,14 +1846,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_copy_match(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_copy_match(rundest, runsrc, match_length);
           }
         }
         break;
@@ -1905,14 +1936,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_copy_match(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_copy_match(rundest, runsrc, match_length);
           }
         }
         break;
@@ -2252,6 +2284,9 @@ static int fdi_decomp(const struct fdi_file *fi, int savemode, fdi_decomp_state
 static void free_decompression_temps(FDI_Int *fdi, const struct fdi_folder *fol,
   fdi_decomp_state *decomp_state)
 {
+  if (CAB(decompress) == ZIPfdi_decomp)
+    fdi_Zipinflate_free_fixed(decomp_state);
+
   switch (fol->comp_type & cffoldCOMPTYPE_MASK) {
   case cffoldCOMPTYPE_LZX:
     if (LZX(window)) {
@@ -2728,6 +2763,8 @@ BOOL __cdecl FDICopy(
         TRACE("Resetting folder for file %s.\n", debugstr_a(file->filename));
 
         /* free stuff for the old decompressor */
+        if (CAB(decompress) == ZIPfdi_decomp)
+          fdi_Zipinflate_free_fixed(decomp_state);
         switch (ct2) {
         case cffoldCOMPTYPE_LZX:
           if (LZX(window)) {
@@ -2755,6 +2792,7 @@ BOOL __cdecl FDICopy(
           break;
         case cffoldCOMPTYPE_MSZIP:
           CAB(decompress) = ZIPfdi_decomp;
+          ZIP(fixed_tl) = ZIP(fixed_td) = NULL;
           break;
         case cffoldCOMPTYPE_QUANTUM:
           CAB(decompress) = QTMfdi_decomp;
@@ -650,6 +650,212 @@ static void test_FDICopy(void)
     DeleteFileA(name);
 }
 
+static INT_PTR __cdecl copy_to_file(FDINOTIFICATIONTYPE fdint, PFDINOTIFICATION pfdin)
+{
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        return (INT_PTR)CreateFileA("large.out", GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                    FILE_ATTRIBUTE_NORMAL, NULL);
+    case fdintCLOSE_FILE_INFO:
+        CloseHandle((HANDLE)pfdin->hf);
+        return TRUE;
+    default:
+        return 0;
+    }
+}
+
+static void test_FDICopy_data(void)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog. ";
+    static char large_txt[] = "large.txt", name[] = "large.cab";
+    char path[MAX_PATH], *data, *out;
+    DWORD size = 300000, written, read, i, seed = 0x1234;
+    CCAB cabParams;
+    HANDLE file;
+    HFCI hfci;
+    HFDI hfdi;
+    ERF erf;
+    BOOL ret;
+
+    /* mix runs, repeated text and incompressible data so that stored,
+     * fixed and dynamic blocks as well as window wraps are exercised */
+    data = HeapAlloc(GetProcessHeap(), 0, size);
+    out = HeapAlloc(GetProcessHeap(), 0, size);
+    for (i = 0; i < size; i++)
+    {
+        if ((i / 4096) % 5 == 0) data[i] = 'a';
+        else if ((i / 4096) % 5 == 3)
+        {
+            seed = seed * 1103515245 + 12345;
+            data[i] = seed >> 16;
+        }
+        else data[i] = text[(i + i / 9000) % (sizeof(text) - 1)];
+    }
+
+    file = CreateFileA(large_txt, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "Failed to create %s\n", large_txt);
+    WriteFile(file, data, size, &written, NULL);
+    CloseHandle(file);
+
+    set_cab_parameters(&cabParams);
+    lstrcpyA(cabParams.szCab, name);
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, NULL);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+    add_file(hfci, large_txt);
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+    ok(ret, "Failed to flush the cabinet\n");
+    FCIDestroy(hfci);
+
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+
+    hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                     fdi_write, fdi_close, fdi_seek,
+                     cpuUNKNOWN, &erf);
+    ret = FDICopy(hfdi, name, path, 0, copy_to_file, NULL, 0);
+    ok(ret == TRUE, "Expected TRUE, got %d\n", ret);
+    FDIDestroy(hfdi);
+
+    file = CreateFileA("large.out", GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "Failed to open extracted file\n");
+    read = 0;
+    ReadFile(file, out, size, &read, NULL);
+    CloseHandle(file);
+    ok(read == size, "Expected %u bytes, got %u\n", size, read);
+    ok(!memcmp(data, out, size), "Extracted data differs\n");
+
+    HeapFree(GetProcessHeap(), 0, data);
+    HeapFree(GetProcessHeap(), 0, out);
+    DeleteFileA("large.out");
+    DeleteFileA(large_txt);
+    DeleteFileA(name);
+}
+
+
+static INT_PTR __cdecl copy_to_out_file(FDINOTIFICATIONTYPE fdint, PFDINOTIFICATION pfdin)
+{
+    char name[MAX_PATH];
+
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        lstrcpyA(name, pfdin->psz1);
+        lstrcatA(name, ".out");
+        return (INT_PTR)CreateFileA(name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                    FILE_ATTRIBUTE_NORMAL, NULL);
+    case fdintCLOSE_FILE_INFO:
+        CloseHandle((HANDLE)pfdin->hf);
+        return TRUE;
+    default:
+        return 0;
+    }
+}
+
+static void test_FDICopy_blocks(void)
+{
+    /* FCI compresses up to 16 blocks of 32k at a time; use more blocks than
+     * that, split over several folders and files that end inside a batch,
+     * at a batch boundary and inside a partial block */
+    static const struct
+    {
+        char name[16];
+        DWORD size;
+        BOOL flush_folder;
+    }
+    files[] =
+    {
+        { "blocks1.txt", 5 * 32768 + 100, FALSE },
+        { "blocks2.txt", 17 * 32768 - 100, TRUE },
+        { "blocks3.txt", 40000, FALSE },
+        { "blocks4.txt", 16 * 32768, FALSE },
+        { "blocks5.txt", 7, TRUE },
+        { "blocks6.txt", 20 * 32768 + 333, FALSE },
+    };
+    static const char text[] = "Pack my box with five dozen liquor jugs. ";
+    static char name[] = "blocks.cab";
+    char path[MAX_PATH], out_name[MAX_PATH], *data, *out;
+    DWORD written, read, i, j, seed = 0x4321;
+    CCAB cabParams;
+    HANDLE file;
+    HFCI hfci;
+    HFDI hfdi;
+    ERF erf;
+    BOOL ret;
+
+    set_cab_parameters(&cabParams);
+    lstrcpyA(cabParams.szCab, name);
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, NULL);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        data = HeapAlloc(GetProcessHeap(), 0, files[i].size);
+        for (j = 0; j < files[i].size; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            if ((j / 10000) % 3 == 1) data[j] = seed >> 16;
+            else data[j] = text[(j + i) % (sizeof(text) - 1)];
+        }
+        file = CreateFileA(files[i].name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        ok(file != INVALID_HANDLE_VALUE, "Failed to create %s\n", files[i].name);
+        WriteFile(file, data, files[i].size, &written, NULL);
+        CloseHandle(file);
+        HeapFree(GetProcessHeap(), 0, data);
+
+        add_file(hfci, (char *)files[i].name);
+        if (files[i].flush_folder)
+        {
+            ret = FCIFlushFolder(hfci, get_next_cabinet, progress);
+            ok(ret, "Failed to flush the folder\n");
+        }
+    }
+
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+    ok(ret, "Failed to flush the cabinet\n");
+    FCIDestroy(hfci);
+
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+
+    hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                     fdi_write, fdi_close, fdi_seek,
+                     cpuUNKNOWN, &erf);
+    ret = FDICopy(hfdi, name, path, 0, copy_to_out_file, NULL, 0);
+    ok(ret == TRUE, "Expected TRUE, got %d\n", ret);
+    FDIDestroy(hfdi);
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        data = HeapAlloc(GetProcessHeap(), 0, files[i].size);
+        out = HeapAlloc(GetProcessHeap(), 0, files[i].size + 1);
+
+        file = CreateFileA(files[i].name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        ReadFile(file, data, files[i].size, &read, NULL);
+        CloseHandle(file);
+
+        lstrcpyA(out_name, files[i].name);
+        lstrcatA(out_name, ".out");
+        file = CreateFileA(out_name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        ok(file != INVALID_HANDLE_VALUE, "Failed to open %s\n", out_name);
+        read = 0;
+        ReadFile(file, out, files[i].size + 1, &read, NULL);
+        CloseHandle(file);
+        ok(read == files[i].size, "%s: expected %u bytes, got %u\n", files[i].name, files[i].size, read);
+        ok(!memcmp(data, out, files[i].size), "%s: extracted data differs\n", files[i].name);
+
+        HeapFree(GetProcessHeap(), 0, data);
+        HeapFree(GetProcessHeap(), 0, out);
+        DeleteFileA(out_name);
+        DeleteFileA(files[i].name);
+    }
+    DeleteFileA(name);
+}
+
 
 START_TEST(fdi)
 {
@@ -657,4 +863,6 @@ START_TEST(fdi)
     test_FDIDestroy();
     test_FDIIsCabinet();
     test_FDICopy();
+    test_FDICopy_data();
+    test_FDICopy_blocks();
 }
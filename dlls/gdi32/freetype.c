@@ -26,6 +26,7 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <errno.h>
 #ifdef HAVE_SYS_STAT_H
 # include <sys/stat.h>
 #endif
@@ -88,6 +89,7 @@
 #include "wine/unicode.h"
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #include "resource.h"
 
@@ -288,6 +290,8 @@ typedef struct tagFace {
 
 typedef struct tagFamily {
     struct list entry;
+    struct list name_entry;     /* entry in family_name_table */
+    struct list english_entry;  /* entry in family_english_table, if EnglishName is set */
     unsigned int refcount;
     WCHAR *FamilyName;
     WCHAR *EnglishName;
@@ -331,6 +335,12 @@ struct tagGdiFont {
     DWORD total_kern_pairs;
     KERNINGPAIR *kern_pairs;
     struct list child_fonts;
+    struct list *glyph_cache;  /* rendered glyphs hash table, allocated on first use */
+    struct list glyph_lru;
+    DWORD glyph_cache_size;
+    DWORD glyph_cache_hits;
+    DWORD glyph_cache_misses;
+    CRITICAL_SECTION cs;  /* protects the members above as well as ft_face and child fonts state */
 
     /* the following members can be accessed without locking, they are never modified after creation */
     FT_Face ft_face;
@@ -379,7 +389,25 @@ struct enum_charset_list {
 #define GM_BLOCK_SIZE 128
 #define FONT_GM(font,idx) (&(font)->gm[(idx) / GM_BLOCK_SIZE][(idx) % GM_BLOCK_SIZE])
 
-static struct list gdi_font_list = LIST_INIT(gdi_font_list);
+/* GetGlyphOutline results, keyed by glyph, format and transform */
+struct glyph_cache_entry
+{
+    struct list  entry;      /* entry in the hash bucket */
+    struct list  lru_entry;
+    UINT         glyph;
+    UINT         format;
+    MAT2         matrix;
+    GLYPHMETRICS gm;
+    DWORD        needed;     /* get_glyph_outline() return value */
+    BYTE        *data;       /* glyph data, NULL until it has been retrieved */
+};
+
+#define GLYPH_CACHE_HASH_SIZE 64
+#define GLYPH_CACHE_MAX_SIZE  (256 * 1024)  /* per font, including the entries */
+
+/* GdiFont instances are looked up by their FONT_DESC hash */
+#define GDI_FONT_TABLE_SIZE 256
+static struct list gdi_font_table[GDI_FONT_TABLE_SIZE];
 static struct list unused_gdi_font_list = LIST_INIT(unused_gdi_font_list);
 static unsigned int unused_font_count;
 #define UNUSED_CACHE_SIZE 10
@@ -389,6 +417,11 @@ static struct list font_subst_list = LIST_INIT(font_subst_list);
 
 static struct list font_list = LIST_INIT(font_list);
 
+/* families indexed by case folded FamilyName and EnglishName */
+#define FAMILY_TABLE_SIZE 1024
+static struct list family_name_table[FAMILY_TABLE_SIZE];
+static struct list family_english_table[FAMILY_TABLE_SIZE];
+
 struct freetype_physdev
 {
     struct gdi_physdev dev;
@@ -492,20 +525,7 @@ typedef struct tagFontSubst {
 static const WCHAR wine_fonts_key[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\',
                                        'F','o','n','t','s',0};
 static const WCHAR wine_fonts_cache_key[] = {'C','a','c','h','e',0};
-static const WCHAR english_name_value[] = {'E','n','g','l','i','s','h',' ','N','a','m','e',0};
-static const WCHAR face_index_value[] = {'I','n','d','e','x',0};
-static const WCHAR face_ntmflags_value[] = {'N','t','m','f','l','a','g','s',0};
-static const WCHAR face_version_value[] = {'V','e','r','s','i','o','n',0};
-static const WCHAR face_height_value[] = {'H','e','i','g','h','t',0};
-static const WCHAR face_width_value[] = {'W','i','d','t','h',0};
-static const WCHAR face_size_value[] = {'S','i','z','e',0};
-static const WCHAR face_x_ppem_value[] = {'X','p','p','e','m',0};
-static const WCHAR face_y_ppem_value[] = {'Y','p','p','e','m',0};
-static const WCHAR face_flags_value[] = {'F','l','a','g','s',0};
-static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a','l',' ','L','e','a','d','i','n','g',0};
-static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
-static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
-static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_cache_serial_value[] = {'S','e','r','i','a','l',0};
 
 
 struct font_mapping
@@ -521,7 +541,6 @@ struct font_mapping
 static struct list mappings_list = LIST_INIT( mappings_list );
 
 static UINT default_aa_flags;
-static HKEY hkey_font_cache;
 
 static CRITICAL_SECTION freetype_cs;
 static CRITICAL_SECTION_DEBUG critsect_debug =
@@ -532,7 +551,21 @@ static CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static CRITICAL_SECTION freetype_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* Lock ordering is freetype_cs -> GdiFont.cs -> library_cs. freetype_cs protects
+ * the font lists and the GdiFont cache, each GdiFont protects its own state and
+ * FT_Face, and library_cs serializes the FT_Library shared state: face creation
+ * and destruction, the rasterizer and the font file mappings. */
+static CRITICAL_SECTION library_cs;
+static CRITICAL_SECTION_DEBUG library_critsect_debug =
+{
+    0, 0, &library_cs,
+    { &library_critsect_debug.ProcessLocksList, &library_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": library_cs") }
+};
+static CRITICAL_SECTION library_cs = { &library_critsect_debug, -1, 0, 0, 0, 0 };
+
 static const WCHAR font_mutex_nameW[] = {'_','_','W','I','N','E','_','F','O','N','T','_','M','U','T','E','X','_','_','\0'};
+static HANDLE font_mutex;
 
 static const WCHAR szDefaultFallbackLink[] = {'M','i','c','r','o','s','o','f','t',' ','S','a','n','s',' ','S','e','r','i','f',0};
 static BOOL use_default_fallback = FALSE;
@@ -541,7 +574,6 @@ static BOOL get_glyph_index_linked(GdiFont *font, UINT c, GdiFont **linked_font,
 static BOOL get_outline_text_metrics(GdiFont *font);
 static BOOL get_bitmap_text_metrics(GdiFont *font);
 static BOOL get_text_metrics(GdiFont *font, LPTEXTMETRICW ptm);
-static void remove_face_from_cache( Face *face );
 
 static const WCHAR system_link[] = {'S','o','f','t','w','a','r','e','\\','M','i','c','r','o','s','o','f','t','\\',
                                     'W','i','n','d','o','w','s',' ','N','T','\\',
@@ -985,11 +1017,47 @@ static Face *find_face_from_filename(const WCHAR *file_name, const WCHAR *face_n
     return NULL;
 }
 
+static void init_lookup_tables(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < FAMILY_TABLE_SIZE; i++)
+    {
+        list_init( &family_name_table[i] );
+        list_init( &family_english_table[i] );
+    }
+    for (i = 0; i < GDI_FONT_TABLE_SIZE; i++)
+        list_init( &gdi_font_table[i] );
+}
+
+static unsigned int family_name_hash(const WCHAR *name)
+{
+    unsigned int hash = 0;
+
+    /* same folding as strcmpiW */
+    while (*name) hash = hash * 31 + tolowerW( *name++ );
+    return hash & (FAMILY_TABLE_SIZE - 1);
+}
+
+static void add_family_to_tables(Family *family)
+{
+    list_add_tail( &family_name_table[family_name_hash( family->FamilyName )], &family->name_entry );
+    if (family->EnglishName)
+        list_add_tail( &family_english_table[family_name_hash( family->EnglishName )], &family->english_entry );
+}
+
+static void remove_family_from_tables(Family *family)
+{
+    list_remove( &family->name_entry );
+    if (family->EnglishName)
+        list_remove( &family->english_entry );
+}
+
 static Family *find_family_from_name(const WCHAR *name)
 {
     Family *family;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(family, &family_name_table[family_name_hash( name )], Family, name_entry)
     {
         if(!strcmpiW(family->FamilyName, name))
             return family;
@@ -1002,11 +1070,12 @@ static Family *find_family_from_any_name(const WCHAR *name)
 {
     Family *family;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    if ((family = find_family_from_name(name)))
+        return family;
+
+    LIST_FOR_EACH_ENTRY(family, &family_english_table[family_name_hash( name )], Family, english_entry)
     {
-        if(!strcmpiW(family->FamilyName, name))
-            return family;
-        if(family->EnglishName && !strcmpiW(family->EnglishName, name))
+        if(!strcmpiW(family->EnglishName, name))
             return family;
     }
 
@@ -1421,6 +1490,7 @@ static void release_family( Family *family )
     if (--family->refcount) return;
     assert( list_empty( &family->faces ));
     list_remove( &family->entry );
+    remove_family_from_tables( family );
     HeapFree( GetProcessHeap(), 0, family->FamilyName );
     HeapFree( GetProcessHeap(), 0, family->EnglishName );
     HeapFree( GetProcessHeap(), 0, family );
@@ -1431,7 +1501,6 @@ static void release_face( Face *face )
     if (--face->refcount) return;
     if (face->family)
     {
-        if (face->flags & ADDFONT_ADD_TO_CACHE) remove_face_from_cache( face );
         list_remove( &face->entry );
         release_family( face->family );
     }
@@ -1526,6 +1595,7 @@ static Family *create_family( WCHAR *name, WCHAR *english_name )
     list_init( &family->faces );
     family->replacement = &family->faces;
     list_add_tail( &font_list, &family->entry );
+    add_family_to_tables( family );
 
     return family;
 }
@@ -1543,174 +1613,6 @@ static LONG reg_load_dword(HKEY hkey, const WCHAR *value, DWORD *data)
     return ERROR_SUCCESS;
 }
 
-static inline LONG reg_save_dword(HKEY hkey, const WCHAR *value, DWORD data)
-{
-    return RegSetValueExW(hkey, value, 0, REG_DWORD, (BYTE*)&data, sizeof(DWORD));
-}
-
-static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size)
-{
-    DWORD needed, strike_index = 0;
-    HKEY hkey_strike;
-
-    /* If we have a File Name key then this is a real font, not just the parent
-       key of a bunch of non-scalable strikes */
-    needed = buffer_size;
-    if (RegQueryValueExW(hkey_face, face_file_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
-    {
-        Face *face;
-        face = HeapAlloc(GetProcessHeap(), 0, sizeof(*face));
-        face->cached_enum_data = NULL;
-        face->family = NULL;
-
-        face->refcount = 1;
-        face->file = strdupW( buffer );
-        face->StyleName = strdupW(face_name);
-
-        needed = buffer_size;
-        if(RegQueryValueExW(hkey_face, face_full_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
-            face->FullName = strdupW( buffer );
-        else
-            face->FullName = NULL;
-
-        reg_load_dword(hkey_face, face_index_value, (DWORD*)&face->face_index);
-        reg_load_dword(hkey_face, face_ntmflags_value, &face->ntmFlags);
-        reg_load_dword(hkey_face, face_version_value, (DWORD*)&face->font_version);
-        reg_load_dword(hkey_face, face_flags_value, (DWORD*)&face->flags);
-
-        needed = sizeof(face->fs);
-        RegQueryValueExW(hkey_face, face_font_sig_value, NULL, NULL, (BYTE*)&face->fs, &needed);
-
-        if(reg_load_dword(hkey_face, face_height_value, (DWORD*)&face->size.height) != ERROR_SUCCESS)
-        {
-            face->scalable = TRUE;
-            memset(&face->size, 0, sizeof(face->size));
-        }
-        else
-        {
-            face->scalable = FALSE;
-            reg_load_dword(hkey_face, face_width_value, (DWORD*)&face->size.width);
-            reg_load_dword(hkey_face, face_size_value, (DWORD*)&face->size.size);
-            reg_load_dword(hkey_face, face_x_ppem_value, (DWORD*)&face->size.x_ppem);
-            reg_load_dword(hkey_face, face_y_ppem_value, (DWORD*)&face->size.y_ppem);
-            reg_load_dword(hkey_face, face_internal_leading_value, (DWORD*)&face->size.internal_leading);
-
-            TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
-                  face->size.height, face->size.width, face->size.size >> 6,
-                  face->size.x_ppem >> 6, face->size.y_ppem >> 6);
-        }
-
-        TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-              face->fs.fsCsb[0], face->fs.fsCsb[1],
-              face->fs.fsUsb[0], face->fs.fsUsb[1],
-              face->fs.fsUsb[2], face->fs.fsUsb[3]);
-
-        if (insert_face_in_family_list(face, family))
-            TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
-
-        release_face( face );
-    }
-
-    /* load bitmap strikes */
-
-    needed = buffer_size;
-    while (!RegEnumKeyExW(hkey_face, strike_index++, buffer, &needed, NULL, NULL, NULL, NULL))
-    {
-        if (!RegOpenKeyExW(hkey_face, buffer, 0, KEY_ALL_ACCESS, &hkey_strike))
-        {
-            load_face(hkey_strike, face_name, family, buffer, buffer_size);
-            RegCloseKey(hkey_strike);
-        }
-        needed = buffer_size;
-    }
-}
-
-/* move vertical fonts after their horizontal counterpart */
-/* assumes that font_list is already sorted by family name */
-static void reorder_vertical_fonts(void)
-{
-    Family *family, *next, *vert_family;
-    struct list *ptr, *vptr;
-    struct list vertical_families = LIST_INIT( vertical_families );
-
-    LIST_FOR_EACH_ENTRY_SAFE( family, next, &font_list, Family, entry )
-    {
-        if (family->FamilyName[0] != '@') continue;
-        list_remove( &family->entry );
-        list_add_tail( &vertical_families, &family->entry );
-    }
-
-    ptr = list_head( &font_list );
-    vptr = list_head( &vertical_families );
-    while (ptr && vptr)
-    {
-        family = LIST_ENTRY( ptr, Family, entry );
-        vert_family = LIST_ENTRY( vptr, Family, entry );
-        if (strcmpiW( family->FamilyName, vert_family->FamilyName + 1 ) > 0)
-        {
-            list_remove( vptr );
-            list_add_before( ptr, vptr );
-            vptr = list_head( &vertical_families );
-        }
-        else ptr = list_next( &font_list, ptr );
-    }
-    list_move_tail( &font_list, &vertical_families );
-}
-
-static void load_font_list_from_cache(HKEY hkey_font_cache)
-{
-    DWORD size, family_index = 0;
-    Family *family;
-    HKEY hkey_family;
-    WCHAR buffer[4096];
-
-    size = sizeof(buffer);
-    while (!RegEnumKeyExW(hkey_font_cache, family_index++, buffer, &size, NULL, NULL, NULL, NULL))
-    {
-        WCHAR *english_family = NULL;
-        WCHAR *family_name = strdupW( buffer );
-        DWORD face_index = 0;
-
-        RegOpenKeyExW(hkey_font_cache, family_name, 0, KEY_ALL_ACCESS, &hkey_family);
-        TRACE("opened family key %s\n", debugstr_w(family_name));
-        size = sizeof(buffer);
-        if (!RegQueryValueExW(hkey_family, english_name_value, NULL, NULL, (BYTE *)buffer, &size))
-            english_family = strdupW( buffer );
-
-        family = create_family(family_name, english_family);
-
-        if(english_family)
-        {
-            FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
-            subst->from.name = strdupW(english_family);
-            subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
-            subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
-        }
-
-        size = sizeof(buffer);
-        while (!RegEnumKeyExW(hkey_family, face_index++, buffer, &size, NULL, NULL, NULL, NULL))
-        {
-            WCHAR *face_name = strdupW( buffer );
-            HKEY hkey_face;
-
-            if (!RegOpenKeyExW(hkey_family, face_name, 0, KEY_ALL_ACCESS, &hkey_face))
-            {
-                load_face(hkey_face, face_name, family, buffer, sizeof(buffer));
-                RegCloseKey(hkey_face);
-            }
-            HeapFree( GetProcessHeap(), 0, face_name );
-            size = sizeof(buffer);
-        }
-        RegCloseKey(hkey_family);
-        release_family( family );
-        size = sizeof(buffer);
-    }
-
-    reorder_vertical_fonts();
-}
-
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
 {
     LONG ret;
@@ -1731,77 +1633,6 @@ static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
     return ret;
 }
 
-static void add_face_to_cache(Face *face)
-{
-    HKEY hkey_family, hkey_face;
-    WCHAR *face_key_name;
-
-    RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
-                    NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
-    if(face->family->EnglishName)
-        RegSetValueExW(hkey_family, english_name_value, 0, REG_SZ, (BYTE*)face->family->EnglishName,
-                       (strlenW(face->family->EnglishName) + 1) * sizeof(WCHAR));
-
-    if(face->scalable)
-        face_key_name = face->StyleName;
-    else
-    {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
-    }
-    RegCreateKeyExW(hkey_family, face_key_name, 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL,
-                    &hkey_face, NULL);
-    if(!face->scalable)
-        HeapFree(GetProcessHeap(), 0, face_key_name);
-
-    RegSetValueExW(hkey_face, face_file_name_value, 0, REG_SZ, (BYTE *)face->file,
-                   (strlenW(face->file) + 1) * sizeof(WCHAR));
-    if (face->FullName)
-        RegSetValueExW(hkey_face, face_full_name_value, 0, REG_SZ, (BYTE*)face->FullName,
-                       (strlenW(face->FullName) + 1) * sizeof(WCHAR));
-
-    reg_save_dword(hkey_face, face_index_value, face->face_index);
-    reg_save_dword(hkey_face, face_ntmflags_value, face->ntmFlags);
-    reg_save_dword(hkey_face, face_version_value, face->font_version);
-    if (face->flags) reg_save_dword(hkey_face, face_flags_value, face->flags);
-
-    RegSetValueExW(hkey_face, face_font_sig_value, 0, REG_BINARY, (BYTE*)&face->fs, sizeof(face->fs));
-
-    if(!face->scalable)
-    {
-        reg_save_dword(hkey_face, face_height_value, face->size.height);
-        reg_save_dword(hkey_face, face_width_value, face->size.width);
-        reg_save_dword(hkey_face, face_size_value, face->size.size);
-        reg_save_dword(hkey_face, face_x_ppem_value, face->size.x_ppem);
-        reg_save_dword(hkey_face, face_y_ppem_value, face->size.y_ppem);
-        reg_save_dword(hkey_face, face_internal_leading_value, face->size.internal_leading);
-    }
-    RegCloseKey(hkey_face);
-    RegCloseKey(hkey_family);
-}
-
-static void remove_face_from_cache( Face *face )
-{
-    HKEY hkey_family;
-
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
-
-    if (face->scalable)
-    {
-        RegDeleteKeyW( hkey_family, face->StyleName );
-    }
-    else
-    {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        WCHAR *face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
-        RegDeleteKeyW( hkey_family, face_key_name );
-        HeapFree(GetProcessHeap(), 0, face_key_name);
-    }
-    RegCloseKey(hkey_family);
-}
-
 static WCHAR *prepend_at(WCHAR *family)
 {
     WCHAR *str;
@@ -1840,14 +1671,10 @@ static void get_family_names( FT_Face ft_face, WCHAR **name, WCHAR **english, BO
     }
 }
 
-static Family *get_family( FT_Face ft_face, BOOL vertical )
+/* takes ownership of the names */
+static Family *find_or_create_family( WCHAR *name, WCHAR *english_name )
 {
-    Family *family;
-    WCHAR *name, *english_name;
-
-    get_family_names( ft_face, &name, &english_name, vertical );
-
-    family = find_family_from_name( name );
+    Family *family = find_family_from_name( name );
 
     if (!family)
     {
@@ -1872,6 +1699,14 @@ static Family *get_family( FT_Face ft_face, BOOL vertical )
     return family;
 }
 
+static Family *get_family( FT_Face ft_face, BOOL vertical )
+{
+    WCHAR *name, *english_name;
+
+    get_family_names( ft_face, &name, &english_name, vertical );
+    return find_or_create_family( name, english_name );
+}
+
 static inline FT_Fixed get_font_version( FT_Face ft_face )
 {
     FT_Fixed version = 0;
@@ -1985,87 +1820,677 @@ static inline void get_fontsig( FT_Face ft_face, FONTSIGNATURE *fs )
     }
 }
 
-static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          DWORD flags )
+static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file, void *font_data_ptr, DWORD font_data_size,
+                          DWORD flags )
+{
+    struct stat st;
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    face->refcount = 1;
+    face->StyleName = get_face_name( ft_face, TT_NAME_ID_FONT_SUBFAMILY, GetSystemDefaultLangID() );
+    if (!face->StyleName) face->StyleName = towstr( CP_ACP, ft_face->style_name );
+
+    face->FullName = get_face_name( ft_face, TT_NAME_ID_FULL_NAME, GetSystemDefaultLangID() );
+    if (flags & ADDFONT_VERTICAL_FONT)
+        face->FullName = prepend_at( face->FullName );
+
+    face->dev = 0;
+    face->ino = 0;
+    if (file)
+    {
+        face->file = towstr( CP_UNIXCP, file );
+        face->font_data_ptr = NULL;
+        face->font_data_size = 0;
+        if (!stat( file, &st ))
+        {
+            face->dev = st.st_dev;
+            face->ino = st.st_ino;
+        }
+    }
+    else
+    {
+        face->file = NULL;
+        face->font_data_ptr = font_data_ptr;
+        face->font_data_size = font_data_size;
+    }
+
+    face->face_index = face_index;
+    get_fontsig( ft_face, &face->fs );
+    face->ntmFlags = get_ntm_flags( ft_face );
+    face->font_version = get_font_version( ft_face );
+
+    if (FT_IS_SCALABLE( ft_face ))
+    {
+        memset( &face->size, 0, sizeof(face->size) );
+        face->scalable = TRUE;
+    }
+    else
+    {
+        get_bitmap_size( ft_face, &face->size );
+        face->scalable = FALSE;
+    }
+
+    if (!HIWORD( flags )) flags |= ADDFONT_AA_FLAGS( default_aa_flags );
+    face->flags  = flags;
+    face->family = NULL;
+    face->cached_enum_data = NULL;
+
+    TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
+          face->fs.fsCsb[0], face->fs.fsCsb[1],
+          face->fs.fsUsb[0], face->fs.fsUsb[1],
+          face->fs.fsUsb[2], face->fs.fsUsb[3]);
+
+    return face;
+}
+
+static void add_face_to_family( Face *face, Family *family )
+{
+    if (insert_face_in_family_list( face, family ))
+        TRACE("Added font %s %s\n", debugstr_w(family->FamilyName),
+              debugstr_w(face->StyleName));
+    release_face( face );
+    release_family( family );
+}
+
+/* On-disk font catalog
+ *
+ * The metadata of every font file added with ADDFONT_ADD_TO_CACHE is stored
+ * in a binary catalog in the prefix, looked up by unix file name and checked
+ * against the file mtime and size, so that unchanged files don't need to be
+ * opened with FreeType again.  The first process of a session rebuilds the
+ * catalog while scanning the font directories; later processes simply replay
+ * it in order, which gives them the same font list without touching the font
+ * files.  The volatile registry cache key records the serial of the catalog
+ * that belongs to the current session.
+ *
+ * The catalog is only accessed while holding the font mutex. */
+
+#define FONT_CACHE_MAGIC   0x46434e57  /* "WNCF" */
+#define FONT_CACHE_VERSION 1
+#define FONT_CACHE_ALIGN(size) (((size) + 7) & ~7)
+
+struct font_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;          /* size of the whole catalog */
+    DWORD serial;        /* serial of the session that wrote it */
+    LCID  lcid;          /* locale used to retrieve the names */
+    DWORD ft_version;    /* FreeType version used to scan the files */
+    DWORD count;         /* number of file records */
+    DWORD reserved;
+};
+
+struct font_cache_file
+{
+    DWORD     size;        /* size of the record, including name and faces */
+    DWORD     flags;       /* AddFontToList() flags */
+    ULONGLONG mtime;
+    ULONGLONG file_size;
+    INT       ret;         /* AddFontToList() return value */
+    DWORD     face_count;
+    DWORD     name_len;    /* length of the unix file name, including the null */
+    DWORD     reserved;
+    /* followed by the file name and the face records, 8-byte aligned */
+};
+
+enum font_cache_name
+{
+    CACHE_FAMILY_NAME,
+    CACHE_ENGLISH_NAME,
+    CACHE_STYLE_NAME,
+    CACHE_FULL_NAME,
+    CACHE_NAME_COUNT
+};
+
+struct font_cache_face
+{
+    DWORD         size;
+    DWORD         face_index;
+    DWORD         flags;       /* ADDFONT_VERTICAL_FONT */
+    DWORD         ntm_flags;
+    DWORD         font_version;
+    DWORD         scalable;
+    FONTSIGNATURE fs;
+    INT           height;
+    INT           width;
+    INT           internal_leading;
+    INT           bitmap_size;
+    INT           x_ppem;
+    INT           y_ppem;
+    WORD          name_len[CACHE_NAME_COUNT];  /* in WCHARs including the null, 0 if missing */
+    /* followed by the names */
+};
+
+struct font_cache_entry
+{
+    struct list                   entry;
+    struct wine_rb_entry          rb_entry;   /* indexed by file name and LOWORD(flags) */
+    DWORD                         flags;
+    const struct font_cache_file *file;
+    BOOL                          allocated;  /* record was built by this process */
+};
+
+struct font_cache
+{
+    void                          *data;     /* mapping of the catalog file */
+    size_t                         size;
+    DWORD                          serial;
+    DWORD                          count;
+    const struct font_cache_file **files;    /* records in catalog order */
+    const struct font_cache_file **index;    /* records sorted by file name */
+    struct list                    entries;  /* records to write back */
+    struct wine_rb_tree            entry_tree;
+    DWORD                          entry_count;
+    BOOL                           dirty;
+};
+
+/* catalog being updated by AddFontToList, if any */
+static struct font_cache *font_cache;
+static DWORD font_cache_serial;
+
+static inline const char *cache_file_name( const struct font_cache_file *file )
+{
+    return (const char *)(file + 1);
+}
+
+struct font_cache_key
+{
+    const char *name;
+    WORD        flags;
+};
+
+static void *font_cache_rb_alloc( size_t size )
+{
+    return HeapAlloc( GetProcessHeap(), 0, size );
+}
+
+static void *font_cache_rb_realloc( void *ptr, size_t size )
+{
+    return HeapReAlloc( GetProcessHeap(), 0, ptr, size );
+}
+
+static void font_cache_rb_free( void *ptr )
+{
+    HeapFree( GetProcessHeap(), 0, ptr );
+}
+
+static int font_cache_rb_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct font_cache_key *k = key;
+    const struct font_cache_entry *e = WINE_RB_ENTRY_VALUE( entry, const struct font_cache_entry, rb_entry );
+
+    if (k->flags != LOWORD(e->flags)) return k->flags < LOWORD(e->flags) ? -1 : 1;
+    return strcmp( k->name, cache_file_name( e->file ) );
+}
+
+static const struct wine_rb_functions font_cache_rb_functions =
+{
+    font_cache_rb_alloc,
+    font_cache_rb_realloc,
+    font_cache_rb_free,
+    font_cache_rb_compare,
+};
+
+static inline const struct font_cache_face *cache_first_face( const struct font_cache_file *file )
+{
+    return (const struct font_cache_face *)((const BYTE *)(file + 1) + FONT_CACHE_ALIGN( file->name_len ));
+}
+
+static inline const struct font_cache_face *cache_next_face( const struct font_cache_face *face )
+{
+    return (const struct font_cache_face *)((const BYTE *)face + face->size);
+}
+
+static WCHAR *cache_face_name( const struct font_cache_face *face, enum font_cache_name name )
+{
+    const WCHAR *str = (const WCHAR *)(face + 1);
+    int i;
+
+    if (!face->name_len[name]) return NULL;
+    for (i = 0; i < name; i++) str += face->name_len[i];
+    return strdupW( str );
+}
+
+static char *get_font_cache_path(void)
+{
+    static const char cache_name[] = "/fonts.cache";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if ((path = HeapAlloc( GetProcessHeap(), 0, strlen( config_dir ) + sizeof(cache_name) )))
+    {
+        strcpy( path, config_dir );
+        strcat( path, cache_name );
+    }
+    return path;
+}
+
+static BOOL validate_cache_face( const struct font_cache_face *face, DWORD avail )
+{
+    const WCHAR *str = (const WCHAR *)(face + 1);
+    DWORD len = sizeof(*face);
+    int i;
+
+    if (avail < sizeof(*face) || face->size > avail || face->size % 8) return FALSE;
+    for (i = 0; i < CACHE_NAME_COUNT; i++)
+    {
+        if (!face->name_len[i]) continue;
+        len += face->name_len[i] * sizeof(WCHAR);
+        if (len > face->size) return FALSE;
+        str += face->name_len[i];
+        if (str[-1]) return FALSE;
+    }
+    return face->name_len[CACHE_FAMILY_NAME] && face->name_len[CACHE_STYLE_NAME];
+}
+
+static BOOL validate_cache_file( const struct font_cache_file *file, DWORD avail )
+{
+    const struct font_cache_face *face;
+    DWORD i, pos;
+
+    if (avail < sizeof(*file) || file->size > avail || file->size < sizeof(*file) || file->size % 8)
+        return FALSE;
+    if (!file->name_len || file->name_len > file->size - sizeof(*file)) return FALSE;
+    if (cache_file_name( file )[file->name_len - 1]) return FALSE;
+
+    pos = sizeof(*file) + FONT_CACHE_ALIGN( file->name_len );
+    for (i = 0; i < file->face_count; i++)
+    {
+        if (pos > file->size) return FALSE;
+        face = (const struct font_cache_face *)((const BYTE *)file + pos);
+        if (!validate_cache_face( face, file->size - pos )) return FALSE;
+        pos += face->size;
+    }
+    return TRUE;
+}
+
+static int compare_cache_files( const void *p1, const void *p2 )
+{
+    const struct font_cache_file * const *file1 = p1, * const *file2 = p2;
+
+    return strcmp( cache_file_name( *file1 ), cache_file_name( *file2 ));
+}
+
+/* map the catalog; the returned cache has no data if there is no valid catalog */
+static struct font_cache *open_font_cache(void)
+{
+    const struct font_cache_header *header;
+    struct font_cache *cache;
+    struct stat st;
+    char *path;
+    DWORD i, pos;
+    int fd;
+
+    if (!(cache = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+    list_init( &cache->entries );
+    if (wine_rb_init( &cache->entry_tree, &font_cache_rb_functions ) == -1)
+    {
+        HeapFree( GetProcessHeap(), 0, cache );
+        return NULL;
+    }
+
+    if (!(path = get_font_cache_path())) return cache;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return cache;
+
+    if (!fstat( fd, &st ) && st.st_size >= sizeof(*header) && st.st_size < 0x40000000)
+    {
+        cache->data = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+        if (cache->data == MAP_FAILED) cache->data = NULL;
+        else cache->size = st.st_size;
+    }
+    close( fd );
+    if (!cache->data) return cache;
+
+    header = cache->data;
+    if (header->magic != FONT_CACHE_MAGIC || header->version != FONT_CACHE_VERSION ||
+        header->size != cache->size || header->lcid != GetSystemDefaultLCID() ||
+        header->ft_version != FT_SimpleVersion ||
+        header->count > (cache->size - sizeof(*header)) / sizeof(struct font_cache_file))
+        goto invalid;
+
+    if (!(cache->files = HeapAlloc( GetProcessHeap(), 0, header->count * sizeof(*cache->files) )) ||
+        !(cache->index = HeapAlloc( GetProcessHeap(), 0, header->count * sizeof(*cache->index) )))
+        goto invalid;
+
+    for (i = 0, pos = sizeof(*header); i < header->count; i++)
+    {
+        const struct font_cache_file *file = (const struct font_cache_file *)((const BYTE *)cache->data + pos);
+
+        if (!validate_cache_file( file, cache->size - pos )) goto invalid;
+        cache->files[i] = cache->index[i] = file;
+        pos += file->size;
+    }
+    cache->count = header->count;
+    cache->serial = header->serial;
+    qsort( cache->index, cache->count, sizeof(*cache->index), compare_cache_files );
+
+    TRACE("loaded %u font files from the catalog\n", cache->count);
+    return cache;
+
+invalid:
+    WARN("ignoring invalid font catalog\n");
+    HeapFree( GetProcessHeap(), 0, cache->files );
+    HeapFree( GetProcessHeap(), 0, cache->index );
+    cache->files = cache->index = NULL;
+    munmap( cache->data, cache->size );
+    cache->data = NULL;
+    cache->size = 0;
+    return cache;
+}
+
+static void remove_font_cache_entry( struct font_cache *cache, struct font_cache_entry *entry )
+{
+    struct font_cache_key key;
+
+    key.name = cache_file_name( entry->file );
+    key.flags = LOWORD(entry->flags);
+    wine_rb_remove( &cache->entry_tree, &key );
+    list_remove( &entry->entry );
+    cache->entry_count--;
+    if (entry->allocated) HeapFree( GetProcessHeap(), 0, (void *)entry->file );
+    HeapFree( GetProcessHeap(), 0, entry );
+}
+
+/* a file keeps a single record per LOWORD(flags), a new scan of it replaces the old one */
+static void add_font_cache_entry( struct font_cache *cache, const struct font_cache_file *file,
+                                  DWORD flags, BOOL allocated )
+{
+    struct font_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    struct font_cache_key key;
+
+    key.name = cache_file_name( file );
+    key.flags = LOWORD(flags);
+    if ((rb_entry = wine_rb_get( &cache->entry_tree, &key )))
+    {
+        entry = WINE_RB_ENTRY_VALUE( rb_entry, struct font_cache_entry, rb_entry );
+        if (entry->file == file) return;
+        if (entry->allocated) HeapFree( GetProcessHeap(), 0, (void *)entry->file );
+        entry->flags = flags;
+        entry->file = file;
+        entry->allocated = allocated;
+        cache->dirty = TRUE;
+        return;
+    }
+
+    if (!(entry = HeapAlloc( GetProcessHeap(), 0, sizeof(*entry) )))
+    {
+        if (allocated) HeapFree( GetProcessHeap(), 0, (void *)file );
+        return;
+    }
+    entry->flags = flags;
+    entry->file = file;
+    entry->allocated = allocated;
+    if (wine_rb_put( &cache->entry_tree, &key, &entry->rb_entry ) == -1)
+    {
+        if (allocated) HeapFree( GetProcessHeap(), 0, (void *)file );
+        HeapFree( GetProcessHeap(), 0, entry );
+        return;
+    }
+    list_add_tail( &cache->entries, &entry->entry );
+    cache->entry_count++;
+    if (allocated) cache->dirty = TRUE;
+}
+
+static void close_font_cache( struct font_cache *cache )
+{
+    struct font_cache_entry *entry, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &cache->entries, struct font_cache_entry, entry )
+        remove_font_cache_entry( cache, entry );
+    wine_rb_destroy( &cache->entry_tree, NULL, NULL );
+    HeapFree( GetProcessHeap(), 0, cache->files );
+    HeapFree( GetProcessHeap(), 0, cache->index );
+    if (cache->data) munmap( cache->data, cache->size );
+    HeapFree( GetProcessHeap(), 0, cache );
+}
+
+static BOOL write_all( int fd, const void *data, size_t size )
+{
+    while (size)
+    {
+        ssize_t ret = write( fd, data, size );
+        if (ret <= 0) return FALSE;
+        data = (const char *)data + ret;
+        size -= ret;
+    }
+    return TRUE;
+}
+
+/* write the catalog entries to a new file and atomically replace the old one,
+ * processes that still have it mapped keep seeing the previous version */
+static BOOL write_font_cache( struct font_cache *cache )
+{
+    struct font_cache_header header;
+    struct font_cache_entry *entry, *next;
+    struct font_cache_file file;
+    struct stat st;
+    char *path, *tmp_path;
+    BOOL ret = FALSE;
+    int fd;
+
+    header.magic      = FONT_CACHE_MAGIC;
+    header.version    = FONT_CACHE_VERSION;
+    header.size       = sizeof(header);
+    header.serial     = cache->serial;
+    header.lcid       = GetSystemDefaultLCID();
+    header.ft_version = FT_SimpleVersion;
+    header.count      = 0;
+    header.reserved   = 0;
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &cache->entries, struct font_cache_entry, entry )
+    {
+        /* don't carry over records of fonts that were deleted */
+        if (stat( cache_file_name( entry->file ), &st ) == -1 && errno == ENOENT)
+        {
+            TRACE("dropping %s\n", debugstr_a(cache_file_name( entry->file )));
+            remove_font_cache_entry( cache, entry );
+            continue;
+        }
+        header.size += entry->file->size;
+        header.count++;
+    }
+
+    if (!(path = get_font_cache_path())) return FALSE;
+    if (!(tmp_path = HeapAlloc( GetProcessHeap(), 0, strlen( path ) + 10 )))
+    {
+        HeapFree( GetProcessHeap(), 0, path );
+        return FALSE;
+    }
+    sprintf( tmp_path, "%s.%08x", path, GetCurrentProcessId() );
+
+    if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) != -1)
+    {
+        ret = write_all( fd, &header, sizeof(header) );
+        LIST_FOR_EACH_ENTRY( entry, &cache->entries, struct font_cache_entry, entry )
+        {
+            if (!ret) break;
+            file = *entry->file;
+            file.flags = entry->flags;
+            ret = write_all( fd, &file, sizeof(file) ) &&
+                  write_all( fd, entry->file + 1, entry->file->size - sizeof(file) );
+        }
+        if (close( fd )) ret = FALSE;
+        if (ret && rename( tmp_path, path )) ret = FALSE;
+        if (!ret) unlink( tmp_path );
+    }
+    if (ret) TRACE("wrote %u font files to %s\n", header.count, debugstr_a(path));
+    else WARN("failed to write the font catalog %s\n", debugstr_a(path));
+
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    HeapFree( GetProcessHeap(), 0, path );
+    return ret;
+}
+
+static const struct font_cache_file *find_cache_file( const struct font_cache *cache, const char *name,
+                                                      const struct stat *st, DWORD flags )
+{
+    int min = 0, max = cache->count - 1, pos = 0, res;
+
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        if (!(res = strcmp( name, cache_file_name( cache->index[pos] )))) break;
+        if (res < 0) max = pos - 1;
+        else min = pos + 1;
+    }
+    if (min > max) return NULL;
+
+    /* the same file may have been scanned both with and without bitmap support */
+    while (pos > 0 && !strcmp( name, cache_file_name( cache->index[pos - 1] ))) pos--;
+    for ( ; pos < (int)cache->count && !strcmp( name, cache_file_name( cache->index[pos] )); pos++)
+    {
+        const struct font_cache_file *file = cache->index[pos];
+
+        if (file->mtime == st->st_mtime && file->file_size == st->st_size &&
+            (file->flags & ADDFONT_ALLOW_BITMAP) == (flags & ADDFONT_ALLOW_BITMAP))
+            return file;
+    }
+    return NULL;
+}
+
+static struct font_cache_file *new_cache_file( const char *name, const struct stat *st, DWORD flags )
 {
-    struct stat st;
-    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+    DWORD len = strlen( name ) + 1, size = sizeof(struct font_cache_file) + FONT_CACHE_ALIGN( len );
+    struct font_cache_file *file;
 
-    face->refcount = 1;
-    face->StyleName = get_face_name( ft_face, TT_NAME_ID_FONT_SUBFAMILY, GetSystemDefaultLangID() );
-    if (!face->StyleName) face->StyleName = towstr( CP_ACP, ft_face->style_name );
+    if (!(file = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size ))) return NULL;
+    file->size = size;
+    file->flags = flags;
+    file->mtime = st->st_mtime;
+    file->file_size = st->st_size;
+    file->name_len = len;
+    memcpy( file + 1, name, len );
+    return file;
+}
 
-    face->FullName = get_face_name( ft_face, TT_NAME_ID_FULL_NAME, GetSystemDefaultLangID() );
-    if (flags & ADDFONT_VERTICAL_FONT)
-        face->FullName = prepend_at( face->FullName );
+/* append a face record; the cache file record is dropped if we run out of memory */
+static void add_face_to_cache_file( struct font_cache_file **file, const Face *face, const Family *family )
+{
+    const WCHAR *names[CACHE_NAME_COUNT];
+    struct font_cache_face *cache_face;
+    struct font_cache_file *new_file;
+    DWORD size = sizeof(*cache_face), len[CACHE_NAME_COUNT];
+    WCHAR *str;
+    int i;
 
-    face->dev = 0;
-    face->ino = 0;
-    if (file)
+    names[CACHE_FAMILY_NAME]  = family->FamilyName;
+    names[CACHE_ENGLISH_NAME] = family->EnglishName;
+    names[CACHE_STYLE_NAME]   = face->StyleName;
+    names[CACHE_FULL_NAME]    = face->FullName;
+    for (i = 0; i < CACHE_NAME_COUNT; i++)
     {
-        face->file = towstr( CP_UNIXCP, file );
-        face->font_data_ptr = NULL;
-        face->font_data_size = 0;
-        if (!stat( file, &st ))
-        {
-            face->dev = st.st_dev;
-            face->ino = st.st_ino;
-        }
+        len[i] = names[i] ? strlenW( names[i] ) + 1 : 0;
+        size += len[i] * sizeof(WCHAR);
     }
-    else
+    size = FONT_CACHE_ALIGN( size );
+
+    if (!(new_file = HeapReAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, *file, (*file)->size + size )))
     {
-        face->file = NULL;
-        face->font_data_ptr = font_data_ptr;
-        face->font_data_size = font_data_size;
+        HeapFree( GetProcessHeap(), 0, *file );
+        *file = NULL;
+        return;
     }
 
-    face->face_index = face_index;
-    get_fontsig( ft_face, &face->fs );
-    face->ntmFlags = get_ntm_flags( ft_face );
-    face->font_version = get_font_version( ft_face );
+    cache_face = (struct font_cache_face *)((BYTE *)new_file + new_file->size);
+    cache_face->size             = size;
+    cache_face->face_index       = face->face_index;
+    cache_face->flags            = face->flags & ADDFONT_VERTICAL_FONT;
+    cache_face->ntm_flags        = face->ntmFlags;
+    cache_face->font_version     = face->font_version;
+    cache_face->scalable         = face->scalable;
+    cache_face->fs               = face->fs;
+    cache_face->height           = face->size.height;
+    cache_face->width            = face->size.width;
+    cache_face->internal_leading = face->size.internal_leading;
+    cache_face->bitmap_size      = face->size.size;
+    cache_face->x_ppem           = face->size.x_ppem;
+    cache_face->y_ppem           = face->size.y_ppem;
 
-    if (FT_IS_SCALABLE( ft_face ))
-    {
-        memset( &face->size, 0, sizeof(face->size) );
-        face->scalable = TRUE;
-    }
-    else
+    str = (WCHAR *)(cache_face + 1);
+    for (i = 0; i < CACHE_NAME_COUNT; i++)
     {
-        get_bitmap_size( ft_face, &face->size );
-        face->scalable = FALSE;
+        cache_face->name_len[i] = len[i];
+        memcpy( str, names[i], len[i] * sizeof(WCHAR) );
+        str += len[i];
     }
 
+    new_file->size += size;
+    new_file->face_count++;
+    *file = new_file;
+}
+
+static Face *create_face_from_cache( const struct font_cache_face *cache_face, const char *file,
+                                     const struct stat *st, DWORD flags )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    face->refcount = 1;
+    face->StyleName = cache_face_name( cache_face, CACHE_STYLE_NAME );
+    face->FullName = cache_face_name( cache_face, CACHE_FULL_NAME );
+    face->file = towstr( CP_UNIXCP, file );
+    face->dev = st->st_dev;
+    face->ino = st->st_ino;
+    face->font_data_ptr = NULL;
+    face->font_data_size = 0;
+    face->face_index = cache_face->face_index;
+    face->fs = cache_face->fs;
+    face->ntmFlags = cache_face->ntm_flags;
+    face->font_version = cache_face->font_version;
+    face->scalable = cache_face->scalable;
+    face->size.height = cache_face->height;
+    face->size.width = cache_face->width;
+    face->size.size = cache_face->bitmap_size;
+    face->size.x_ppem = cache_face->x_ppem;
+    face->size.y_ppem = cache_face->y_ppem;
+    face->size.internal_leading = cache_face->internal_leading;
+
+    flags |= cache_face->flags;
     if (!HIWORD( flags )) flags |= ADDFONT_AA_FLAGS( default_aa_flags );
     face->flags  = flags;
     face->family = NULL;
     face->cached_enum_data = NULL;
+    return face;
+}
 
-    TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-          face->fs.fsCsb[0], face->fs.fsCsb[1],
-          face->fs.fsUsb[0], face->fs.fsUsb[1],
-          face->fs.fsUsb[2], face->fs.fsUsb[3]);
+static INT add_faces_from_cache( const struct font_cache_file *file, const char *name,
+                                 const struct stat *st, DWORD flags )
+{
+    const struct font_cache_face *cache_face = cache_first_face( file );
+    DWORD i;
 
-    return face;
+    TRACE("Loading font file %s from the catalog\n", debugstr_a(name));
+
+    for (i = 0; i < file->face_count; i++, cache_face = cache_next_face( cache_face ))
+    {
+        Face *face = create_face_from_cache( cache_face, name, st, flags );
+        Family *family = find_or_create_family( cache_face_name( cache_face, CACHE_FAMILY_NAME ),
+                                                cache_face_name( cache_face, CACHE_ENGLISH_NAME ));
+        add_face_to_family( face, family );
+    }
+    return file->ret;
 }
 
 static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          FT_Long face_index, DWORD flags )
+                          FT_Long face_index, DWORD flags, struct font_cache_file **cache_file )
 {
     Face *face;
     Family *family;
 
     face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
     family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
-    if (insert_face_in_family_list( face, family ))
-    {
-        if (flags & ADDFONT_ADD_TO_CACHE)
-            add_face_to_cache( face );
+    if (cache_file && *cache_file) add_face_to_cache_file( cache_file, face, family );
+    add_face_to_family( face, family );
+}
 
-        TRACE("Added font %s %s\n", debugstr_w(family->FamilyName),
-              debugstr_w(face->StyleName));
-    }
-    release_face( face );
-    release_family( family );
+static void done_ft_face( FT_Face ft_face )
+{
+    EnterCriticalSection( &library_cs );
+    pFT_Done_Face( ft_face );
+    LeaveCriticalSection( &library_cs );
 }
 
 static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_data_size,
@@ -2078,12 +2503,16 @@ static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_da
     if (file)
     {
         TRACE("Loading font file %s index %ld\n", debugstr_a(file), face_index);
+        EnterCriticalSection( &library_cs );
         err = pFT_New_Face(library, file, face_index, &ft_face);
+        LeaveCriticalSection( &library_cs );
     }
     else
     {
         TRACE("Loading font from ptr %p size %d, index %ld\n", font_data_ptr, font_data_size, face_index);
+        EnterCriticalSection( &library_cs );
         err = pFT_New_Memory_Face(library, font_data_ptr, font_data_size, face_index, &ft_face);
+        LeaveCriticalSection( &library_cs );
     }
 
     if (err != 0)
@@ -2140,7 +2569,7 @@ static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_da
 
     return ft_face;
 fail:
-    pFT_Done_Face( ft_face );
+    done_ft_face( ft_face );
     return NULL;
 }
 
@@ -2148,6 +2577,8 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
 {
     FT_Face ft_face;
     FT_Long face_index = 0, num_faces;
+    struct font_cache_file *cache_file = NULL;
+    struct stat st;
     INT ret = 0;
 
     /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
@@ -2174,33 +2605,126 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
     }
 #endif /* HAVE_CARBON_CARBON_H */
 
+    if (file && (flags & ADDFONT_ADD_TO_CACHE) && font_cache && !stat( file, &st ))
+    {
+        const struct font_cache_file *cached;
+
+        if ((cached = find_cache_file( font_cache, file, &st, flags )))
+        {
+            ret = add_faces_from_cache( cached, file, &st, flags );
+            add_font_cache_entry( font_cache, cached, flags, FALSE );
+            return ret;
+        }
+        cache_file = new_cache_file( file, &st, flags );
+    }
+
     do {
         ft_face = new_ft_face( file, font_data_ptr, font_data_size, face_index, flags & ADDFONT_ALLOW_BITMAP );
-        if (!ft_face) return 0;
+        if (!ft_face)
+        {
+            ret = 0;
+            break;
+        }
 
         if(ft_face->family_name[0] == '.') /* Ignore fonts with names beginning with a dot */
         {
             TRACE("Ignoring %s since its family name begins with a dot\n", debugstr_a(file));
-            pFT_Done_Face(ft_face);
-            return 0;
+            done_ft_face( ft_face );
+            ret = 0;
+            break;
         }
 
-        AddFaceToList(ft_face, file, font_data_ptr, font_data_size, face_index, flags);
+        AddFaceToList(ft_face, file, font_data_ptr, font_data_size, face_index, flags, &cache_file);
         ++ret;
 
         if (FT_HAS_VERTICAL(ft_face))
         {
             AddFaceToList(ft_face, file, font_data_ptr, font_data_size, face_index,
-                          flags | ADDFONT_VERTICAL_FONT);
+                          flags | ADDFONT_VERTICAL_FONT, &cache_file);
             ++ret;
         }
 
 	num_faces = ft_face->num_faces;
-	pFT_Done_Face(ft_face);
+	done_ft_face( ft_face );
     } while(num_faces > ++face_index);
+
+    if (cache_file)
+    {
+        cache_file->ret = ret;
+        add_font_cache_entry( font_cache, cache_file, flags, TRUE );
+    }
+    return ret;
+}
+
+/* replay the catalog of the current session */
+static void load_font_list_from_cache( struct font_cache *cache )
+{
+    DWORD i;
+
+    for (i = 0; i < cache->count; i++)
+        AddFontToList( cache_file_name( cache->files[i] ), NULL, 0, cache->files[i]->flags );
+}
+
+/* other processes may have updated the catalog since we loaded it,
+ * so runtime changes always start from the current file */
+static struct font_cache *open_session_font_cache(void)
+{
+    struct font_cache *cache;
+    DWORD i;
+
+    if (!(cache = open_font_cache())) return NULL;
+    if (!cache->data || cache->serial != font_cache_serial)
+    {
+        close_font_cache( cache );
+        return NULL;
+    }
+    for (i = 0; i < cache->count; i++)
+        add_font_cache_entry( cache, cache->files[i], cache->files[i]->flags, FALSE );
+    return cache;
+}
+
+static INT add_shared_font_resource( const char *file, DWORD flags )
+{
+    DWORD count = 0;
+    INT ret;
+
+    WaitForSingleObject( font_mutex, INFINITE );
+    if ((font_cache = open_session_font_cache())) count = font_cache->entry_count;
+
+    ret = AddFontToList( file, NULL, 0, flags );
+
+    if (font_cache)
+    {
+        if (font_cache->dirty || font_cache->entry_count != count) write_font_cache( font_cache );
+        close_font_cache( font_cache );
+        font_cache = NULL;
+    }
+    ReleaseMutex( font_mutex );
     return ret;
 }
 
+static void remove_shared_font_resource( const char *file, DWORD flags )
+{
+    struct font_cache *cache;
+    struct font_cache_entry *entry, *next;
+    BOOL removed = FALSE;
+
+    WaitForSingleObject( font_mutex, INFINITE );
+    if ((cache = open_session_font_cache()))
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( entry, next, &cache->entries, struct font_cache_entry, entry )
+        {
+            if (LOWORD(entry->flags) != LOWORD(flags)) continue;
+            if (strcmp( cache_file_name( entry->file ), file )) continue;
+            remove_font_cache_entry( cache, entry );
+            removed = TRUE;
+        }
+        if (removed) write_font_cache( cache );
+        close_font_cache( cache );
+    }
+    ReleaseMutex( font_mutex );
+}
+
 static int remove_font_resource( const char *file, DWORD flags )
 {
     Family *family, *family_next;
@@ -2285,15 +2809,11 @@ static void LoadReplaceList(void)
                 Family * const family = find_family_from_any_name(data);
                 if (family != NULL)
                 {
-                    Family * const new_family = HeapAlloc(GetProcessHeap(), 0, sizeof(*new_family));
+                    Family * const new_family = create_family(strdupW(value), NULL);
                     if (new_family != NULL)
                     {
                         TRACE("mapping %s to %s\n", debugstr_w(data), debugstr_w(value));
-                        new_family->FamilyName = strdupW(value);
-                        new_family->EnglishName = NULL;
-                        list_init(&new_family->faces);
                         new_family->replacement = &family->faces;
-                        list_add_tail(&font_list, &new_family->entry);
                     }
                 }
                 else
@@ -3117,8 +3637,10 @@ INT WineEngAddFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
         {
             DWORD addfont_flags = ADDFONT_ALLOW_BITMAP | ADDFONT_ADD_RESOURCE;
 
-            if(!(flags & FR_PRIVATE)) addfont_flags |= ADDFONT_ADD_TO_CACHE;
-            ret = AddFontToList(unixname, NULL, 0, addfont_flags);
+            if(!(flags & FR_PRIVATE))
+                ret = add_shared_font_resource(unixname, addfont_flags | ADDFONT_ADD_TO_CACHE);
+            else
+                ret = AddFontToList(unixname, NULL, 0, addfont_flags);
             HeapFree(GetProcessHeap(), 0, unixname);
         }
         if (!ret && !strchrW(file, '\\')) {
@@ -3199,6 +3721,8 @@ BOOL WineEngRemoveFontResourceEx(LPCWSTR file, DWORD flags, PVOID pdv)
 
             if(!(flags & FR_PRIVATE)) addfont_flags |= ADDFONT_ADD_TO_CACHE;
             ret = remove_font_resource( unixname, addfont_flags );
+            if (ret && (addfont_flags & ADDFONT_ADD_TO_CACHE))
+                remove_shared_font_resource( unixname, addfont_flags );
             HeapFree(GetProcessHeap(), 0, unixname);
         }
         if (!ret && !strchrW(file, '\\'))
@@ -3306,7 +3830,7 @@ static BOOL get_fontdir( const char *unix_name, struct fontdir *fd )
     if (!ft_face) return FALSE;
     face = create_face( ft_face, 0, unix_name, NULL, 0, 0 );
     get_family_names( ft_face, &name, &english_name, FALSE );
-    pFT_Done_Face( ft_face );
+    done_ft_face( ft_face );
 
     GetEnumStructs( face, name, &elf, &ntm, &type );
     release_face( face );
@@ -4097,17 +4621,12 @@ static void init_font_list(void)
 
 static BOOL move_to_front(const WCHAR *name)
 {
-    Family *family, *cursor2;
-    LIST_FOR_EACH_ENTRY_SAFE(family, cursor2, &font_list, Family, entry)
-    {
-        if(!strcmpiW(family->FamilyName, name))
-        {
-            list_remove(&family->entry);
-            list_add_head(&font_list, &family->entry);
-            return TRUE;
-        }
-    }
-    return FALSE;
+    Family *family = find_family_from_name(name);
+
+    if (!family) return FALSE;
+    list_remove(&family->entry);
+    list_add_head(&font_list, &family->entry);
+    return TRUE;
 }
 
 static BOOL set_default(const WCHAR **name_list)
@@ -4135,12 +4654,15 @@ static void reorder_font_list(void)
  */
 BOOL WineEngInit(void)
 {
-    DWORD disposition;
-    HANDLE font_mutex;
+    DWORD disposition = 0, serial;
+    HKEY hkey_font_cache = 0;
+    BOOL scan = TRUE;
 
     /* update locale dependent font info in registry */
     update_font_info();
 
+    init_lookup_tables();
+
     if(!init_freetype()) return FALSE;
 
 #ifdef SONAME_LIBFONTCONFIG
@@ -4155,11 +4677,37 @@ BOOL WineEngInit(void)
     WaitForSingleObject(font_mutex, INFINITE);
 
     create_font_cache_key(&hkey_font_cache, &disposition);
+    font_cache = open_font_cache();
 
-    if(disposition == REG_CREATED_NEW_KEY)
-        init_font_list();
+    if (disposition != REG_CREATED_NEW_KEY && font_cache && font_cache->data &&
+        !reg_load_dword(hkey_font_cache, font_cache_serial_value, &serial) && serial == font_cache->serial)
+    {
+        load_font_list_from_cache(font_cache);
+        font_cache_serial = serial;
+        scan = FALSE;
+    }
     else
-        load_font_list_from_cache(hkey_font_cache);
+    {
+        if (font_cache)
+        {
+            font_cache->serial++;
+            font_cache->dirty = TRUE;
+        }
+        init_font_list();
+    }
+
+    if (font_cache)
+    {
+        if (font_cache->dirty && write_font_cache(font_cache))
+        {
+            font_cache_serial = font_cache->serial;
+            RegSetValueExW(hkey_font_cache, font_cache_serial_value, 0, REG_DWORD,
+                           (BYTE *)&font_cache_serial, sizeof(font_cache_serial));
+        }
+        close_font_cache(font_cache);
+        font_cache = NULL;
+    }
+    RegCloseKey(hkey_font_cache);
 
     reorder_font_list();
 
@@ -4168,7 +4716,7 @@ BOOL WineEngInit(void)
     DumpSubstList();
     LoadReplaceList();
 
-    if(disposition == REG_CREATED_NEW_KEY)
+    if (scan)
         update_reg_entries();
 
     init_system_links();
@@ -4292,7 +4840,9 @@ static FT_Face OpenFontFace(GdiFont *font, Face *face, LONG width, LONG height)
     if (face->file)
     {
         char *filename = strWtoA( CP_UNIXCP, face->file );
+        EnterCriticalSection( &library_cs );
         font->mapping = map_font_file( filename );
+        LeaveCriticalSection( &library_cs );
         HeapFree( GetProcessHeap(), 0, filename );
         if (!font->mapping)
         {
@@ -4308,7 +4858,9 @@ static FT_Face OpenFontFace(GdiFont *font, Face *face, LONG width, LONG height)
         data_size = face->font_data_size;
     }
 
+    EnterCriticalSection( &library_cs );
     err = pFT_New_Memory_Face(library, data_ptr, data_size, face->face_index, &ft_face);
+    LeaveCriticalSection( &library_cs );
     if(err) {
         ERR("FT_New_Face rets %d\n", err);
 	return 0;
@@ -4389,9 +4941,35 @@ static GdiFont *alloc_font(void)
     ret->total_kern_pairs = (DWORD)-1;
     ret->kern_pairs = NULL;
     list_init(&ret->child_fonts);
+    list_init(&ret->glyph_lru);
+    InitializeCriticalSection( &ret->cs );
+    ret->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": GdiFont.cs");
     return ret;
 }
 
+static void remove_glyph_cache_entry( GdiFont *font, struct glyph_cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    list_remove( &entry->lru_entry );
+    font->glyph_cache_size -= sizeof(*entry);
+    if (entry->data) font->glyph_cache_size -= entry->needed;
+    HeapFree( GetProcessHeap(), 0, entry->data );
+    HeapFree( GetProcessHeap(), 0, entry );
+}
+
+static void free_glyph_cache( GdiFont *font )
+{
+    struct glyph_cache_entry *entry, *next;
+
+    if (!font->glyph_cache) return;
+
+    TRACE("%p: glyph cache hits %u misses %u\n", font, font->glyph_cache_hits, font->glyph_cache_misses);
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &font->glyph_lru, struct glyph_cache_entry, lru_entry )
+        remove_glyph_cache_entry( font, entry );
+    HeapFree( GetProcessHeap(), 0, font->glyph_cache );
+    font->glyph_cache = NULL;
+}
+
 static void free_font(GdiFont *font)
 {
     CHILD_FONT *child, *child_next;
@@ -4406,8 +4984,13 @@ static void free_font(GdiFont *font)
         HeapFree(GetProcessHeap(), 0, child);
     }
 
-    if (font->ft_face) pFT_Done_Face(font->ft_face);
+    EnterCriticalSection( &library_cs );
+    if (font->ft_face) pFT_Done_Face( font->ft_face );
     if (font->mapping) unmap_font_file( font->mapping );
+    LeaveCriticalSection( &library_cs );
+    font->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &font->cs );
+    free_glyph_cache( font );
     HeapFree(GetProcessHeap(), 0, font->kern_pairs);
     HeapFree(GetProcessHeap(), 0, font->potm);
     HeapFree(GetProcessHeap(), 0, font->name);
@@ -4588,11 +5171,13 @@ static LONG load_VDMX(GdiFont *font, LONG height)
 static void dump_gdi_font_list(void)
 {
     GdiFont *font;
+    unsigned int i;
 
     TRACE("---------- Font Cache ----------\n");
-    LIST_FOR_EACH_ENTRY( font, &gdi_font_list, struct tagGdiFont, entry )
-        TRACE("font=%p ref=%u %s %d\n", font, font->refcount,
-              debugstr_w(font->font_desc.lf.lfFaceName), font->font_desc.lf.lfHeight);
+    for (i = 0; i < GDI_FONT_TABLE_SIZE; i++)
+        LIST_FOR_EACH_ENTRY( font, &gdi_font_table[i], struct tagGdiFont, entry )
+            TRACE("font=%p ref=%u %s %d\n", font, font->refcount,
+                  debugstr_w(font->font_desc.lf.lfFaceName), font->font_desc.lf.lfHeight);
 }
 
 static void grab_font( GdiFont *font )
@@ -4663,6 +5248,7 @@ static void calc_hash(FONT_DESC *pfd)
 
 static GdiFont *find_in_cache(HFONT hfont, const LOGFONTW *plf, const FMAT2 *pmat, BOOL can_use_bitmap)
 {
+    struct list *bucket;
     GdiFont *ret;
     FONT_DESC fd;
 
@@ -4670,14 +5256,14 @@ static GdiFont *find_in_cache(HFONT hfont, const LOGFONTW *plf, const FMAT2 *pma
     fd.matrix = *pmat;
     fd.can_use_bitmap = can_use_bitmap;
     calc_hash(&fd);
+    bucket = &gdi_font_table[fd.hash % GDI_FONT_TABLE_SIZE];
 
-    /* try the in-use list */
-    LIST_FOR_EACH_ENTRY( ret, &gdi_font_list, struct tagGdiFont, entry )
+    LIST_FOR_EACH_ENTRY( ret, bucket, struct tagGdiFont, entry )
     {
         if(fontcmp(ret, &fd)) continue;
         if(!can_use_bitmap && !FT_IS_SCALABLE(ret->ft_face)) continue;
         list_remove( &ret->entry );
-        list_add_head( &gdi_font_list, &ret->entry );
+        list_add_head( bucket, &ret->entry );
         grab_font( ret );
         return ret;
     }
@@ -4689,7 +5275,7 @@ static void add_to_cache(GdiFont *font)
     static DWORD cache_num = 1;
 
     font->cache_num = cache_num++;
-    list_add_head(&gdi_font_list, &font->entry);
+    list_add_head(&gdi_font_table[font->font_desc.hash % GDI_FONT_TABLE_SIZE], &font->entry);
     TRACE( "font %p\n", font );
 }
 
@@ -4825,7 +5411,10 @@ static BOOL freetype_CreateDC( PHYSDEV *dev, LPCWSTR driver, LPCWSTR device,
 static BOOL freetype_DeleteDC( PHYSDEV dev )
 {
     struct freetype_physdev *physdev = get_freetype_dev( dev );
+
+    EnterCriticalSection( &freetype_cs );
     release_font( physdev->font );
+    LeaveCriticalSection( &freetype_cs );
     HeapFree( GetProcessHeap(), 0, physdev );
     return TRUE;
 }
@@ -5047,7 +5636,9 @@ static HFONT freetype_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags )
 
     if (!hfont)  /* notification that the font has been changed by another driver */
     {
+        EnterCriticalSection( &freetype_cs );
         release_font( physdev->font );
+        LeaveCriticalSection( &freetype_cs );
         physdev->font = NULL;
         release_dc_ptr( dc );
         return 0;
@@ -5484,7 +6075,13 @@ done:
                 if (is_hinting_enabled())
                 {
                     WORD gasp_flags;
-                    if (get_gasp_flags( ret, &gasp_flags ) && !(gasp_flags & GASP_DOGRAY))
+                    BOOL has_gasp;
+
+                    /* a cached font may be in use by other threads */
+                    EnterCriticalSection( &ret->cs );
+                    has_gasp = get_gasp_flags( ret, &gasp_flags );
+                    LeaveCriticalSection( &ret->cs );
+                    if (has_gasp && !(gasp_flags & GASP_DOGRAY))
                     {
                         TRACE( "font %s %d aa disabled by GASP\n",
                                debugstr_w(lf.lfFaceName), lf.lfHeight );
@@ -6059,7 +6656,7 @@ static DWORD freetype_GetGlyphIndices( PHYSDEV dev, LPCWSTR lpstr, INT count, LP
     }
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     for(i = 0; i < count; i++)
     {
@@ -6076,7 +6673,7 @@ static DWORD freetype_GetGlyphIndices( PHYSDEV dev, LPCWSTR lpstr, INT count, LP
         else
             pgi[i] = get_GSUB_vert_glyph(physdev->font, pgi[i]);
     }
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return count;
 }
 
@@ -6562,7 +7159,9 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
 
 	    /* Note: FreeType will only set 'black' bits for us. */
 	    memset(buf, 0, needed);
+	    EnterCriticalSection( &library_cs );
 	    pFT_Outline_Get_Bitmap(library, &ft_face->glyph->outline, &ft_bitmap);
+	    LeaveCriticalSection( &library_cs );
 	    break;
 
 	default:
@@ -6618,7 +7217,9 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
 
             memset(ft_bitmap.buffer, 0, buflen);
 
+            EnterCriticalSection( &library_cs );
             pFT_Outline_Get_Bitmap(library, &ft_face->glyph->outline, &ft_bitmap);
+            LeaveCriticalSection( &library_cs );
 
             if (max_level != 255)
             {
@@ -6719,9 +7320,11 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
             if ( needsTransform )
                 pFT_Outline_Transform (&ft_face->glyph->outline, &transMatTategaki);
 
+            EnterCriticalSection( &library_cs );
             if ( pFT_Library_SetLcdFilter )
                 pFT_Library_SetLcdFilter( library, lcdfilter );
             pFT_Render_Glyph (ft_face->glyph, render_mode);
+            LeaveCriticalSection( &library_cs );
 
             src = ft_face->glyph->bitmap.buffer;
             src_pitch = ft_face->glyph->bitmap.pitch;
@@ -7498,12 +8101,141 @@ end:
 /*************************************************************
  * freetype_GetGlyphOutline
  */
+static BOOL is_cacheable_glyph_format( UINT format )
+{
+    switch (format & ~(GGO_GLYPH_INDEX | GGO_UNHINTED))
+    {
+    case GGO_BITMAP:
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_GRAY16_BITMAP:
+    case GGO_NATIVE:
+    case GGO_BEZIER:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static inline BOOL is_gray_format( UINT format )
+{
+    format &= ~(GGO_GLYPH_INDEX | GGO_UNHINTED);
+    return format != GGO_BITMAP && format != GGO_NATIVE && format != GGO_BEZIER;
+}
+
+static inline struct list *get_glyph_cache_bucket( GdiFont *font, UINT glyph, UINT format )
+{
+    return &font->glyph_cache[(glyph * 31 + format) % GLYPH_CACHE_HASH_SIZE];
+}
+
+static struct glyph_cache_entry *find_glyph_cache_entry( GdiFont *font, UINT glyph, UINT format,
+                                                         const MAT2 *matrix )
+{
+    struct glyph_cache_entry *entry;
+
+    if (!font->glyph_cache) return NULL;
+
+    LIST_FOR_EACH_ENTRY( entry, get_glyph_cache_bucket( font, glyph, format ), struct glyph_cache_entry, entry )
+    {
+        if (entry->glyph == glyph && entry->format == format &&
+            !memcmp( &entry->matrix, matrix, sizeof(*matrix) ))
+            return entry;
+    }
+    return NULL;
+}
+
+static struct glyph_cache_entry *add_glyph_cache_entry( GdiFont *font, UINT glyph, UINT format,
+                                                        const MAT2 *matrix, const GLYPHMETRICS *gm,
+                                                        DWORD needed )
+{
+    struct glyph_cache_entry *entry;
+    DWORD i;
+
+    if (!font->glyph_cache)
+    {
+        if (!(font->glyph_cache = HeapAlloc( GetProcessHeap(), 0,
+                                             GLYPH_CACHE_HASH_SIZE * sizeof(*font->glyph_cache) )))
+            return NULL;
+        for (i = 0; i < GLYPH_CACHE_HASH_SIZE; i++) list_init( &font->glyph_cache[i] );
+    }
+
+    if (!(entry = HeapAlloc( GetProcessHeap(), 0, sizeof(*entry) ))) return NULL;
+    entry->glyph  = glyph;
+    entry->format = format;
+    entry->matrix = *matrix;
+    entry->gm     = *gm;
+    entry->needed = needed;
+    entry->data   = NULL;
+    list_add_head( get_glyph_cache_bucket( font, glyph, format ), &entry->entry );
+    list_add_head( &font->glyph_lru, &entry->lru_entry );
+    font->glyph_cache_size += sizeof(*entry);
+    return entry;
+}
+
+/* drop the least recently used glyphs, but always keep the current one */
+static void trim_glyph_cache( GdiFont *font, struct glyph_cache_entry *current )
+{
+    struct list *ptr;
+
+    while (font->glyph_cache_size > GLYPH_CACHE_MAX_SIZE && (ptr = list_tail( &font->glyph_lru )))
+    {
+        struct glyph_cache_entry *entry = LIST_ENTRY( ptr, struct glyph_cache_entry, lru_entry );
+        if (entry == current) break;
+        remove_glyph_cache_entry( font, entry );
+    }
+}
+
+/* get_glyph_outline() with a cache of the rendered glyphs, callers (text
+ * rendering in particular) usually retrieve the same glyphs over and over */
+static DWORD get_cached_glyph_outline( GdiFont *font, UINT glyph, UINT format, LPGLYPHMETRICS lpgm,
+                                       DWORD buflen, LPVOID buf, const MAT2 *lpmat )
+{
+    struct glyph_cache_entry *entry;
+    DWORD ret;
+    ABC abc;
+
+    if (!is_cacheable_glyph_format( format ))
+        return get_glyph_outline( font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
+
+    if ((entry = find_glyph_cache_entry( font, glyph, format, lpmat )))
+    {
+        if (buf && buflen)
+        {
+            if (!entry->data || buflen < entry->needed) goto miss;
+            memcpy( buf, entry->data, entry->needed );
+            /* the grayscale renderer clears the whole buffer */
+            if (is_gray_format( format ))
+                memset( (BYTE *)buf + entry->needed, 0, buflen - entry->needed );
+        }
+        *lpgm = entry->gm;
+        list_remove( &entry->lru_entry );
+        list_add_head( &font->glyph_lru, &entry->lru_entry );
+        font->glyph_cache_hits++;
+        return entry->needed;
+    }
+
+miss:
+    font->glyph_cache_misses++;
+    ret = get_glyph_outline( font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
+    if (ret == GDI_ERROR) return ret;
+
+    if (!entry && !(entry = add_glyph_cache_entry( font, glyph, format, lpmat, lpgm, ret ))) return ret;
+
+    if (buf && buflen >= ret && !entry->data && ret <= GLYPH_CACHE_MAX_SIZE / 4 &&
+        (entry->data = HeapAlloc( GetProcessHeap(), 0, max( ret, 1 ) )))
+    {
+        memcpy( entry->data, buf, ret );
+        font->glyph_cache_size += ret;
+    }
+    trim_glyph_cache( font, entry );
+    return ret;
+}
+
 static DWORD freetype_GetGlyphOutline( PHYSDEV dev, UINT glyph, UINT format,
                                        LPGLYPHMETRICS lpgm, DWORD buflen, LPVOID buf, const MAT2 *lpmat )
 {
     struct freetype_physdev *physdev = get_freetype_dev( dev );
     DWORD ret;
-    ABC abc;
 
     if (!physdev->font)
     {
@@ -7512,9 +8244,9 @@ static DWORD freetype_GetGlyphOutline( PHYSDEV dev, UINT glyph, UINT format,
     }
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
-    ret = get_glyph_outline( physdev->font, glyph, format, lpgm, &abc, buflen, buf, lpmat );
-    LeaveCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
+    ret = get_cached_glyph_outline( physdev->font, glyph, format, lpgm, buflen, buf, lpmat );
+    LeaveCriticalSection( &physdev->font->cs );
     return ret;
 }
 
@@ -7533,9 +8265,9 @@ static BOOL freetype_GetTextMetrics( PHYSDEV dev, TEXTMETRICW *metrics )
     }
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
     ret = get_text_metrics( physdev->font, metrics );
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return ret;
 }
 
@@ -7558,7 +8290,7 @@ static UINT freetype_GetOutlineTextMetrics( PHYSDEV dev, UINT cbSize, OUTLINETEX
     if (!FT_IS_SCALABLE( physdev->font->ft_face )) return 0;
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     if (physdev->font->potm || get_outline_text_metrics( physdev->font ))
     {
@@ -7569,7 +8301,7 @@ static UINT freetype_GetOutlineTextMetrics( PHYSDEV dev, UINT cbSize, OUTLINETEX
         }
 	ret = physdev->font->potm->otmSize;
     }
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return ret;
 }
 
@@ -7659,12 +8391,12 @@ static BOOL freetype_GetCharWidth( PHYSDEV dev, UINT firstChar, UINT lastChar, L
     TRACE("%p, %d, %d, %p\n", physdev->font, firstChar, lastChar, buffer);
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
     for(c = firstChar; c <= lastChar; c++) {
         get_glyph_outline( physdev->font, c, GGO_METRICS, &gm, &abc, 0, NULL, &identity );
         buffer[c - firstChar] = abc.abcA + abc.abcB + abc.abcC;
     }
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return TRUE;
 }
 
@@ -7687,12 +8419,12 @@ static BOOL freetype_GetCharABCWidths( PHYSDEV dev, UINT firstChar, UINT lastCha
     TRACE("%p, %d, %d, %p\n", physdev->font, firstChar, lastChar, buffer);
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     for(c = firstChar; c <= lastChar; c++, buffer++)
         get_glyph_outline( physdev->font, c, GGO_METRICS, &gm, buffer, 0, NULL, &identity );
 
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return TRUE;
 }
 
@@ -7716,13 +8448,13 @@ static BOOL freetype_GetCharABCWidthsI( PHYSDEV dev, UINT firstChar, UINT count,
         return FALSE;
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     for(c = 0; c < count; c++, buffer++)
         get_glyph_outline( physdev->font, pgi ? pgi[c] : firstChar + c, GGO_METRICS | GGO_GLYPH_INDEX,
                            &gm, buffer, 0, NULL, &identity );
 
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return TRUE;
 }
 
@@ -7746,7 +8478,7 @@ static BOOL freetype_GetTextExtentExPoint( PHYSDEV dev, LPCWSTR wstr, INT count,
     TRACE("%p, %s, %d\n", physdev->font, debugstr_wn(wstr, count), count);
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     for (idx = pos = 0; idx < count; idx++)
     {
@@ -7755,7 +8487,7 @@ static BOOL freetype_GetTextExtentExPoint( PHYSDEV dev, LPCWSTR wstr, INT count,
         dxs[idx] = pos;
     }
 
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return TRUE;
 }
 
@@ -7779,7 +8511,7 @@ static BOOL freetype_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices, IN
     TRACE("%p, %p, %d\n", physdev->font, indices, count);
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
 
     for (idx = pos = 0; idx < count; idx++)
     {
@@ -7789,7 +8521,7 @@ static BOOL freetype_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices, IN
         dxs[idx] = pos;
     }
 
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return TRUE;
 }
 
@@ -7799,6 +8531,7 @@ static BOOL freetype_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices, IN
 static DWORD freetype_GetFontData( PHYSDEV dev, DWORD table, DWORD offset, LPVOID buf, DWORD cbData )
 {
     struct freetype_physdev *physdev = get_freetype_dev( dev );
+    DWORD ret;
 
     if (!physdev->font)
     {
@@ -7810,7 +8543,11 @@ static DWORD freetype_GetFontData( PHYSDEV dev, DWORD table, DWORD offset, LPVOI
           physdev->font, LOBYTE(LOWORD(table)), HIBYTE(LOWORD(table)),
           LOBYTE(HIWORD(table)), HIBYTE(HIWORD(table)), offset, buf, cbData);
 
-    return get_font_data( physdev->font, table, offset, buf, cbData );
+    GDI_CheckNotLock();
+    EnterCriticalSection( &physdev->font->cs );
+    ret = get_font_data( physdev->font, table, offset, buf, cbData );
+    LeaveCriticalSection( &physdev->font->cs );
+    return ret;
 }
 
 /*************************************************************
@@ -7927,7 +8664,10 @@ static DWORD freetype_GetFontUnicodeRanges( PHYSDEV dev, LPGLYPHSET glyphset )
         return dev->funcs->pGetFontUnicodeRanges( dev, glyphset );
     }
 
+    GDI_CheckNotLock();
+    EnterCriticalSection( &physdev->font->cs );
     num_ranges = get_font_unicode_ranges(physdev->font->ft_face, glyphset);
+    LeaveCriticalSection( &physdev->font->cs );
     size = sizeof(GLYPHSET) + sizeof(WCRANGE) * (num_ranges - 1);
     if (glyphset)
     {
@@ -7953,9 +8693,9 @@ static BOOL freetype_FontIsLinked( PHYSDEV dev )
     }
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &physdev->font->cs );
     ret = !list_empty(&physdev->font->child_fonts);
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &physdev->font->cs );
     return ret;
 }
 
@@ -8111,7 +8851,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
     }
 
     GDI_CheckNotLock();
-    EnterCriticalSection( &freetype_cs );
+    EnterCriticalSection( &font->cs );
     if (font->total_kern_pairs != (DWORD)-1)
     {
         if (cPairs && kern_pair)
@@ -8121,7 +8861,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
         }
         else cPairs = font->total_kern_pairs;
 
-        LeaveCriticalSection( &freetype_cs );
+        LeaveCriticalSection( &font->cs );
         return cPairs;
     }
 
@@ -8132,7 +8872,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
     if (length == GDI_ERROR)
     {
         TRACE("no kerning data in the font\n");
-        LeaveCriticalSection( &freetype_cs );
+        LeaveCriticalSection( &font->cs );
         return 0;
     }
 
@@ -8140,7 +8880,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
     if (!buf)
     {
         WARN("Out of memory\n");
-        LeaveCriticalSection( &freetype_cs );
+        LeaveCriticalSection( &font->cs );
         return 0;
     }
 
@@ -8152,7 +8892,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
     {
         WARN("Out of memory allocating a glyph index to char code map\n");
         HeapFree(GetProcessHeap(), 0, buf);
-        LeaveCriticalSection( &freetype_cs );
+        LeaveCriticalSection( &font->cs );
         return 0;
     }
 
@@ -8246,7 +8986,7 @@ static DWORD freetype_GetKerningPairs( PHYSDEV dev, DWORD cPairs, KERNINGPAIR *k
     }
     else cPairs = font->total_kern_pairs;
 
-    LeaveCriticalSection( &freetype_cs );
+    LeaveCriticalSection( &font->cs );
     return cPairs;
 }
 
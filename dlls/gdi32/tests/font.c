@@ -20,6 +20,7 @@
  */
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <assert.h>
 
 #include "windef.h"
@@ -4621,6 +4622,27 @@ static void test_GetGlyphOutline_metric_clipping(void)
     ReleaseDC(NULL, hdc);
 }
 
+static void check_font_installed_in_child(const char *name, BOOL expected)
+{
+    char **argv, cmdline[MAX_PATH * 2];
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" font %s %s", argv[0], expected ? "installed" : "not_installed", name);
+
+    memset(&si, 0, sizeof(si));
+    si.cb = sizeof(si);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess error %u\n", GetLastError());
+    if (!ret) return;
+
+    winetest_wait_child_process(pi.hProcess);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+}
+
 static void test_CreateScalableFontResource(void)
 {
     char ttf_name[MAX_PATH];
@@ -4702,6 +4724,9 @@ static void test_CreateScalableFontResource(void)
     ret = is_truetype_font_installed("wine_test");
     ok(ret, "font wine_test should be enumerated\n");
 
+    /* public font resources are visible to processes started afterwards */
+    check_font_installed_in_child("wine_test", TRUE);
+
     test_GetGlyphOutline_empty_contour();
     test_GetGlyphOutline_metric_clipping();
 
@@ -4715,6 +4740,8 @@ static void test_CreateScalableFontResource(void)
     ret = is_truetype_font_installed("wine_test");
     ok(!ret, "font wine_test should not be enumerated\n");
 
+    check_font_installed_in_child("wine_test", FALSE);
+
     ret = pRemoveFontResourceExA(fot_name, 0, 0);
     ok(!ret, "RemoveFontResourceEx() should fail\n");
 
@@ -5154,10 +5181,248 @@ static void test_vertical_order(void)
 }
 
 
+/* many font instances alive at once, reselecting any of them must give the same metrics */
+static void test_font_cache(void)
+{
+    static const char face_names[][LF_FACESIZE] = { "Arial", "aRIAL", "ARIAL" };
+    TEXTMETRICA tm;
+    HFONT hfont[300], old_font;
+    LONG height[300];
+    LOGFONTA lf;
+    int i, ret;
+    HDC hdc;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    hdc = CreateCompatibleDC(0);
+    old_font = GetCurrentObject(hdc, OBJ_FONT);
+
+    memset(&lf, 0, sizeof(lf));
+    for (i = 0; i < sizeof(hfont)/sizeof(hfont[0]); i++)
+    {
+        strcpy(lf.lfFaceName, face_names[i % 3]);
+        lf.lfHeight = -(8 + i / 3);
+        lf.lfWeight = (i % 2) ? FW_BOLD : FW_NORMAL;
+        hfont[i] = CreateFontIndirectA(&lf);
+        SelectObject(hdc, hfont[i]);
+
+        ret = GetTextMetricsA(hdc, &tm);
+        ok(ret, "%d: GetTextMetrics failed\n", i);
+        height[i] = tm.tmHeight;
+    }
+
+    for (i = sizeof(hfont)/sizeof(hfont[0]) - 1; i >= 0; i--)
+    {
+        SelectObject(hdc, hfont[i]);
+        GetTextMetricsA(hdc, &tm);
+        ok(tm.tmHeight == height[i], "%d: got height %d, expected %d\n", i, tm.tmHeight, height[i]);
+    }
+
+    SelectObject(hdc, old_font);
+    for (i = 0; i < sizeof(hfont)/sizeof(hfont[0]); i++)
+        DeleteObject(hfont[i]);
+    DeleteDC(hdc);
+}
+
+struct text_thread_data
+{
+    HFONT hfont;
+    SIZE extent;
+    GLYPHMETRICS gm[26];
+    DWORD bitmap_size[26];
+    DWORD bitmap_sum[26];
+};
+
+static const char thread_text[] = "The quick brown fox jumps over the lazy dog";
+
+static DWORD bitmap_checksum(const BYTE *buf, DWORD size)
+{
+    DWORD i, sum = 0;
+
+    for (i = 0; i < size; i++) sum = sum * 31 + buf[i];
+    return sum;
+}
+
+static DWORD WINAPI text_thread_proc(void *arg)
+{
+    static const MAT2 mat = { {0,1}, {0,0}, {0,0}, {0,1} };
+    struct text_thread_data *data = arg;
+    DWORD i, size, mismatches = 0;
+    GLYPHMETRICS gm;
+    BYTE buf[8192];
+    HFONT old_font;
+    SIZE extent;
+    HDC hdc;
+
+    hdc = CreateCompatibleDC(0);
+    old_font = SelectObject(hdc, data->hfont);
+
+    for (i = 0; i < 500; i++)
+    {
+        UINT ch = 'a' + i % 26;
+
+        if (!GetTextExtentPoint32A(hdc, thread_text, sizeof(thread_text) - 1, &extent) ||
+            extent.cx != data->extent.cx || extent.cy != data->extent.cy)
+            mismatches++;
+
+        size = GetGlyphOutlineA(hdc, ch, GGO_GRAY8_BITMAP, &gm, sizeof(buf), buf, &mat);
+        if (size != data->bitmap_size[i % 26] || memcmp(&gm, &data->gm[i % 26], sizeof(gm)) ||
+            (size != GDI_ERROR && bitmap_checksum(buf, size) != data->bitmap_sum[i % 26]))
+            mismatches++;
+    }
+
+    SelectObject(hdc, old_font);
+    DeleteDC(hdc);
+    return mismatches;
+}
+
+/* several DCs share the same cached font object, results must not depend on
+   how the threads interleave */
+static void test_multithreaded_text(void)
+{
+    static const MAT2 mat = { {0,1}, {0,0}, {0,0}, {0,1} };
+    struct text_thread_data data;
+    HANDLE threads[4];
+    HFONT old_font;
+    BYTE buf[8192];
+    LOGFONTA lf;
+    DWORD i, ret;
+    HDC hdc;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    memset(&lf, 0, sizeof(lf));
+    strcpy(lf.lfFaceName, "Arial");
+    lf.lfHeight = -13;
+    lf.lfQuality = ANTIALIASED_QUALITY;
+    data.hfont = CreateFontIndirectA(&lf);
+    ok(data.hfont != NULL, "CreateFontIndirect failed\n");
+
+    hdc = CreateCompatibleDC(0);
+    old_font = SelectObject(hdc, data.hfont);
+    ret = GetTextExtentPoint32A(hdc, thread_text, sizeof(thread_text) - 1, &data.extent);
+    ok(ret, "GetTextExtentPoint32 failed\n");
+    for (i = 0; i < 26; i++)
+    {
+        data.bitmap_size[i] = GetGlyphOutlineA(hdc, 'a' + i, GGO_GRAY8_BITMAP, &data.gm[i], sizeof(buf), buf, &mat);
+        ok(data.bitmap_size[i] != GDI_ERROR, "GetGlyphOutline failed for %c\n", 'a' + i);
+        data.bitmap_sum[i] = data.bitmap_size[i] == GDI_ERROR ? 0 : bitmap_checksum(buf, data.bitmap_size[i]);
+    }
+    SelectObject(hdc, old_font);
+    DeleteDC(hdc);
+
+    for (i = 0; i < sizeof(threads)/sizeof(threads[0]); i++)
+        threads[i] = CreateThread(NULL, 0, text_thread_proc, &data, 0, NULL);
+
+    for (i = 0; i < sizeof(threads)/sizeof(threads[0]); i++)
+    {
+        ret = WaitForSingleObject(threads[i], 30000);
+        ok(ret == WAIT_OBJECT_0, "thread %u didn't finish: %u\n", i, ret);
+        GetExitCodeThread(threads[i], &ret);
+        ok(ret == 0, "thread %u: got %u mismatched results\n", i, ret);
+        CloseHandle(threads[i]);
+    }
+
+    DeleteObject(data.hfont);
+}
+
+static void test_GetGlyphOutline_repeated(void)
+{
+    static const MAT2 identity = { {0,1}, {0,0}, {0,0}, {0,1} };
+    static const MAT2 scale = { {0,2}, {0,0}, {0,0}, {0,2} };
+    static const UINT formats[] = { GGO_BITMAP, GGO_GRAY8_BITMAP, GGO_NATIVE, GGO_BEZIER };
+    static const MAT2 *matrices[] = { &identity, &scale };
+    static BYTE buf1[16384], buf2[16384];
+    GLYPHMETRICS gm1, gm2;
+    HFONT hfont, old_font;
+    DWORD size1, size2;
+    LOGFONTA lf;
+    UINT f, m, i;
+    HDC hdc;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    memset(&lf, 0, sizeof(lf));
+    strcpy(lf.lfFaceName, "Arial");
+    lf.lfHeight = -24;
+    hfont = CreateFontIndirectA(&lf);
+    ok(hfont != NULL, "CreateFontIndirect failed\n");
+
+    hdc = CreateCompatibleDC(0);
+    old_font = SelectObject(hdc, hfont);
+
+    for (f = 0; f < sizeof(formats)/sizeof(formats[0]); f++)
+    {
+        for (m = 0; m < sizeof(matrices)/sizeof(matrices[0]); m++)
+        {
+            for (i = 0; i < 3; i++)
+            {
+                UINT ch = "AgW"[i];
+
+                memset(&gm1, 0xcc, sizeof(gm1));
+                size1 = GetGlyphOutlineA(hdc, ch, formats[f], &gm1, 0, NULL, matrices[m]);
+                ok(size1 != GDI_ERROR, "%u/%u/%c: GetGlyphOutline failed\n", formats[f], m, ch);
+                if (size1 == GDI_ERROR || size1 > sizeof(buf1)) continue;
+
+                memset(buf1, 0xcc, sizeof(buf1));
+                size1 = GetGlyphOutlineA(hdc, ch, formats[f], &gm1, sizeof(buf1), buf1, matrices[m]);
+
+                /* the same request again, and once more after a size query */
+                memset(buf2, 0xcc, sizeof(buf2));
+                memset(&gm2, 0xcc, sizeof(gm2));
+                size2 = GetGlyphOutlineA(hdc, ch, formats[f], &gm2, sizeof(buf2), buf2, matrices[m]);
+                ok(size1 == size2, "%u/%u/%c: got size %u, expected %u\n", formats[f], m, ch, size2, size1);
+                ok(!memcmp(&gm1, &gm2, sizeof(gm1)), "%u/%u/%c: glyph metrics differ\n", formats[f], m, ch);
+                ok(!memcmp(buf1, buf2, size1), "%u/%u/%c: glyph data differs\n", formats[f], m, ch);
+
+                memset(&gm2, 0xcc, sizeof(gm2));
+                size2 = GetGlyphOutlineA(hdc, ch, formats[f], &gm2, 0, NULL, matrices[m]);
+                ok(size1 == size2, "%u/%u/%c: got size %u, expected %u\n", formats[f], m, ch, size2, size1);
+                ok(!memcmp(&gm1, &gm2, sizeof(gm1)), "%u/%u/%c: glyph metrics differ\n", formats[f], m, ch);
+            }
+        }
+    }
+
+    /* hinted and unhinted outlines are different requests */
+    size1 = GetGlyphOutlineA(hdc, 'g', GGO_NATIVE, &gm1, sizeof(buf1), buf1, &scale);
+    size2 = GetGlyphOutlineA(hdc, 'g', GGO_NATIVE | GGO_UNHINTED, &gm2, sizeof(buf2), buf2, &scale);
+    ok(size1 != GDI_ERROR && size2 != GDI_ERROR, "GetGlyphOutline failed\n");
+    size2 = GetGlyphOutlineA(hdc, 'g', GGO_NATIVE, &gm2, sizeof(buf2), buf2, &scale);
+    ok(size1 == size2 && !memcmp(buf1, buf2, size1), "hinted outline changed\n");
+
+    SelectObject(hdc, old_font);
+    DeleteDC(hdc);
+    DeleteObject(hfont);
+}
+
 START_TEST(font)
 {
+    char **argv;
+    int argc;
+
     init();
 
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 4)
+    {
+        BOOL expected = !strcmp(argv[2], "installed");
+        ok(is_truetype_font_installed(argv[3]) == expected, "font %s should%s be enumerated\n",
+           argv[3], expected ? "" : " not");
+        return;
+    }
+
     test_stock_fonts();
     test_logfont();
     test_bitmap_font();
@@ -5212,6 +5477,9 @@ START_TEST(font)
     test_east_asian_font_selection();
     test_max_height();
     test_vertical_order();
+    test_font_cache();
+    test_multithreaded_text();
+    test_GetGlyphOutline_repeated();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
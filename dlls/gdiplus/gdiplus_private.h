@@ -177,6 +177,11 @@ struct GpGraphics{
     int temp_hbitmap_height;
     BYTE *temp_bits;
     HDC temp_hdc;
+    /* Reused by alpha blending to an HDC: */
+    HDC blend_hdc;
+    HBITMAP blend_hbitmap;
+    BYTE *blend_bits;
+    INT blend_width, blend_height;
 };
 
 struct GpBrush{
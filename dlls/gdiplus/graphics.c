@@ -353,6 +353,75 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return GdipGetRegionHRgn(graphics->clip, NULL, hrgn);
 }
 
+/* Multiply the two 8-bit channels held in the 0x00ff00ff lanes of x by
+ * alpha/255, rounding to nearest. */
+static inline DWORD mul_channel_pairs(DWORD x, DWORD alpha)
+{
+    x = (x & 0x00ff00ff) * alpha + 0x00800080;
+    return ((x + ((x >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
+static inline DWORD premultiply_argb(ARGB color)
+{
+    DWORD alpha = color >> 24;
+
+    return (alpha << 24) | (mul_channel_pairs((color >> 8) & 0xff, alpha) << 8) |
+        mul_channel_pairs(color, alpha);
+}
+
+/* SourceOver for premultiplied pixels; src must already be premultiplied. */
+static inline DWORD blend_premultiplied(DWORD dst, DWORD src)
+{
+    DWORD inv_alpha = 0xff - (src >> 24);
+
+    return src + (mul_channel_pairs(dst, inv_alpha) |
+        (mul_channel_pairs(dst >> 8, inv_alpha) << 8));
+}
+
+/* Composite a span of non-premultiplied ARGB pixels onto a row of a 32-bit
+ * bitmap. Runs of opaque pixels are copied, transparent pixels skipped. */
+static void blend_span_32bpp(PixelFormat format, DWORD *dst, const ARGB *src, INT count)
+{
+    INT x=0, run;
+
+    while (x < count)
+    {
+        for (run=x; run<count && (src[run]>>24) == 0xff; run++);
+
+        if (run != x)
+        {
+            if (format == PixelFormat32bppRGB)
+            {
+                for (; x<run; x++)
+                    dst[x] = src[x] & 0xffffff;
+            }
+            else
+            {
+                memcpy(&dst[x], &src[x], (run - x) * sizeof(DWORD));
+                x = run;
+            }
+            continue;
+        }
+
+        if ((src[x]>>24) != 0)
+        {
+            switch (format)
+            {
+            case PixelFormat32bppPARGB:
+                dst[x] = blend_premultiplied(dst[x], premultiply_argb(src[x]));
+                break;
+            case PixelFormat32bppARGB:
+                dst[x] = color_over(dst[x], src[x]);
+                break;
+            default: /* PixelFormat32bppRGB */
+                dst[x] = color_over(dst[x] | 0xff000000, src[x]) & 0xffffff;
+                break;
+            }
+        }
+        x++;
+    }
+}
+
 /* Draw non-premultiplied ARGB data to the given graphics object */
 static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride)
@@ -360,13 +429,50 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
     GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
     INT x, y;
 
-    for (x=0; x<src_width; x++)
+    /* The clipping region may extend past the bitmap. */
+    if (dst_x < 0)
+    {
+        src -= dst_x * 4;
+        src_width += dst_x;
+        dst_x = 0;
+    }
+    if (dst_y < 0)
+    {
+        src -= dst_y * src_stride;
+        src_height += dst_y;
+        dst_y = 0;
+    }
+    src_width = min(src_width, dst_bitmap->width - dst_x);
+    src_height = min(src_height, dst_bitmap->height - dst_y);
+
+    if (src_width <= 0 || src_height <= 0)
+        return Ok;
+
+    if (dst_bitmap->format == PixelFormat32bppARGB ||
+        dst_bitmap->format == PixelFormat32bppPARGB ||
+        dst_bitmap->format == PixelFormat32bppRGB)
     {
         for (y=0; y<src_height; y++)
         {
-            ARGB dst_color, src_color;
+            DWORD *dst_row = (DWORD*)(dst_bitmap->bits + dst_bitmap->stride * (y+dst_y)) + dst_x;
+            blend_span_32bpp(dst_bitmap->format, dst_row, (const ARGB*)(src + src_stride * y), src_width);
+        }
+
+        return Ok;
+    }
+
+    for (y=0; y<src_height; y++)
+    {
+        const ARGB *src_row = (const ARGB*)(src + src_stride * y);
+
+        for (x=0; x<src_width; x++)
+        {
+            ARGB dst_color, src_color = src_row[x];
+
+            if ((src_color>>24) == 0)
+                continue;
+
             GdipBitmapGetPixel(dst_bitmap, x+dst_x, y+dst_y, &dst_color);
-            src_color = ((ARGB*)(src + src_stride * y))[x];
             GdipBitmapSetPixel(dst_bitmap, x+dst_x, y+dst_y, color_over(dst_color, src_color));
         }
     }
@@ -374,42 +480,140 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
     return Ok;
 }
 
-static GpStatus alpha_blend_hdc_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
+/* Composite straight into the bits of a 32-bit DIB section selected into
+ * the target DC, within the DC's clip region. This gives the same result as
+ * GdiAlphaBlend of premultiplied data, without a temporary bitmap. Returns
+ * FALSE if the DC isn't a plain memory DC and has to go through GDI. */
+static BOOL alpha_blend_dib_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride)
 {
-    HDC hdc;
     HBITMAP hbitmap;
+    DIBSECTION dib;
+    HRGN hrgn, clip;
+    POINT origin;
+    RGNDATA *rgndata;
+    RECT *rects;
+    BYTE *bits;
+    INT height, stride, size, y;
+    DWORD i;
+
+    if (!graphics->alpha_hdc || GetObjectType(graphics->hdc) != OBJ_MEMDC ||
+        GetMapMode(graphics->hdc) != MM_TEXT || GetGraphicsMode(graphics->hdc) != GM_COMPATIBLE ||
+        GetLayout(graphics->hdc))
+        return FALSE;
+
+    hbitmap = GetCurrentObject(graphics->hdc, OBJ_BITMAP);
+    if (!hbitmap || GetObjectW(hbitmap, sizeof(dib), &dib) != sizeof(dib) ||
+        dib.dsBmih.biBitCount != 32 || dib.dsBmih.biCompression != BI_RGB || !dib.dsBm.bmBits)
+        return FALSE;
+
+    origin.x = dst_x;
+    origin.y = dst_y;
+    LPtoDP(graphics->hdc, &origin, 1);
+
+    height = dib.dsBm.bmHeight;
+    hrgn = CreateRectRgn(max(origin.x, 0), max(origin.y, 0),
+        min(origin.x + src_width, dib.dsBm.bmWidth), min(origin.y + src_height, height));
+    clip = CreateRectRgn(0, 0, 0, 0);
+    if (!hrgn || !clip)
+    {
+        DeleteObject(hrgn);
+        DeleteObject(clip);
+        return FALSE;
+    }
+    if (GetClipRgn(graphics->hdc, clip) == 1)
+        CombineRgn(hrgn, hrgn, clip, RGN_AND);
+    DeleteObject(clip);
+
+    size = GetRegionData(hrgn, 0, NULL);
+    rgndata = GdipAlloc(size);
+    if (!rgndata)
+    {
+        DeleteObject(hrgn);
+        return FALSE;
+    }
+    GetRegionData(hrgn, size, rgndata);
+    DeleteObject(hrgn);
+
+    /* pending GDI drawing to the bitmap must land before we touch its bits */
+    GdiFlush();
+
+    stride = dib.dsBm.bmWidthBytes;
+    rects = (RECT*)rgndata->Buffer;
+    for (i=0; i<rgndata->rdh.nCount; i++)
+    {
+        for (y=rects[i].top; y<rects[i].bottom; y++)
+        {
+            if (dib.dsBmih.biHeight > 0)
+                bits = (BYTE*)dib.dsBm.bmBits + stride * (height - 1 - y);
+            else
+                bits = (BYTE*)dib.dsBm.bmBits + stride * y;
+
+            blend_span_32bpp(PixelFormat32bppPARGB, (DWORD*)bits + rects[i].left,
+                (const ARGB*)(src + (rects[i].left - origin.x) * 4 + (y - origin.y) * src_stride),
+                rects[i].right - rects[i].left);
+        }
+    }
+
+    GdipFree(rgndata);
+    return TRUE;
+}
+
+static GpStatus alpha_blend_hdc_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
+    const BYTE *src, INT src_width, INT src_height, INT src_stride)
+{
     BITMAPINFOHEADER bih;
-    BYTE *temp_bits;
+    HBITMAP hbitmap;
+    INT y;
 
-    hdc = CreateCompatibleDC(0);
+    if (alpha_blend_dib_pixels(graphics, dst_x, dst_y, src, src_width, src_height, src_stride))
+        return Ok;
 
-    bih.biSize = sizeof(BITMAPINFOHEADER);
-    bih.biWidth = src_width;
-    bih.biHeight = -src_height;
-    bih.biPlanes = 1;
-    bih.biBitCount = 32;
-    bih.biCompression = BI_RGB;
-    bih.biSizeImage = 0;
-    bih.biXPelsPerMeter = 0;
-    bih.biYPelsPerMeter = 0;
-    bih.biClrUsed = 0;
-    bih.biClrImportant = 0;
-
-    hbitmap = CreateDIBSection(hdc, (BITMAPINFO*)&bih, DIB_RGB_COLORS,
-        (void**)&temp_bits, NULL, 0);
+    /* keep the temporary bitmap around, most fills are about the same size */
+    if (!graphics->blend_hdc || graphics->blend_width < src_width ||
+        graphics->blend_height < src_height)
+    {
+        if (!graphics->blend_hdc)
+            graphics->blend_hdc = CreateCompatibleDC(0);
+        if (!graphics->blend_hdc)
+            return OutOfMemory;
+
+        bih.biSize = sizeof(BITMAPINFOHEADER);
+        bih.biWidth = max(src_width, graphics->blend_width);
+        bih.biHeight = -max(src_height, graphics->blend_height);
+        bih.biPlanes = 1;
+        bih.biBitCount = 32;
+        bih.biCompression = BI_RGB;
+        bih.biSizeImage = 0;
+        bih.biXPelsPerMeter = 0;
+        bih.biYPelsPerMeter = 0;
+        bih.biClrUsed = 0;
+        bih.biClrImportant = 0;
+
+        hbitmap = CreateDIBSection(graphics->blend_hdc, (BITMAPINFO*)&bih, DIB_RGB_COLORS,
+            (void**)&graphics->blend_bits, NULL, 0);
+        if (!hbitmap)
+            return OutOfMemory;
+
+        SelectObject(graphics->blend_hdc, hbitmap);
+        DeleteObject(graphics->blend_hbitmap);
+        graphics->blend_hbitmap = hbitmap;
+        graphics->blend_width = bih.biWidth;
+        graphics->blend_height = -bih.biHeight;
+    }
 
     if (GetDeviceCaps(graphics->hdc, SHADEBLENDCAPS) == SB_NONE)
-        memcpy(temp_bits, src, src_width * src_height * 4);
+    {
+        for (y=0; y<src_height; y++)
+            memcpy(graphics->blend_bits + 4 * graphics->blend_width * y, src + src_stride * y,
+                   4 * src_width);
+    }
     else
-        convert_32bppARGB_to_32bppPARGB(src_width, src_height, temp_bits,
-                                        4 * src_width, src, src_stride);
+        convert_32bppARGB_to_32bppPARGB(src_width, src_height, graphics->blend_bits,
+                                        4 * graphics->blend_width, src, src_stride);
 
-    SelectObject(hdc, hbitmap);
     gdi_alpha_blend(graphics, dst_x, dst_y, src_width, src_height,
-                    hdc, 0, 0, src_width, src_height);
-    DeleteDC(hdc);
-    DeleteObject(hbitmap);
+                    graphics->blend_hdc, 0, 0, src_width, src_height);
 
     return Ok;
 }
@@ -1027,6 +1231,91 @@ static INT brush_can_fill_pixels(GpBrush *brush)
     }
 }
 
+/* Positions a line gradient is sampled at when filling large areas; fine
+ * enough that neighbouring entries differ by less than one color level. */
+#define LINE_GRADIENT_STEPS 1024
+
+/* Maps a texel coordinate into [0, size) for a tiled texture, setting
+ * *flipped if that tile is mirrored. */
+static INT wrap_texture_coord(INT coord, INT size, BOOL flip, BOOL *flipped)
+{
+    coord %= size * 2;
+    if (coord < 0) coord += size * 2;
+
+    *flipped = flip && coord >= size;
+    coord %= size;
+    return *flipped ? size - 1 - coord : coord;
+}
+
+/* Fills a span from row y of a texture starting at column x, one texel per
+ * pixel, copying whole runs up to the edge of each tile. */
+static void copy_texture_span(DWORD *dst, const ARGB *bits, INT width, INT height,
+    INT x, INT y, INT count, GDIPCONST GpImageAttributes *attributes)
+{
+    const ARGB *row;
+    BOOL flipped;
+    INT i, run;
+
+    if (attributes->wrap == WrapModeClamp)
+    {
+        if (y < 0 || y >= height)
+        {
+            for (i=0; i<count; i++)
+                dst[i] = attributes->outside_color;
+            return;
+        }
+
+        row = bits + y * width;
+        for (i=0; i<count; i++, x++)
+            dst[i] = (x < 0 || x >= width) ? attributes->outside_color : row[x];
+        return;
+    }
+
+    row = bits + wrap_texture_coord(y, height, (attributes->wrap & 2) != 0, &flipped) * width;
+
+    while (count)
+    {
+        INT tx = wrap_texture_coord(x, width, (attributes->wrap & 1) != 0, &flipped);
+
+        if (flipped)
+        {
+            run = min(count, tx + 1);
+            for (i=0; i<run; i++)
+                dst[i] = row[tx - i];
+        }
+        else
+        {
+            run = min(count, width - tx);
+            memcpy(dst, row + tx, run * sizeof(ARGB));
+        }
+
+        dst += run;
+        x += run;
+        count -= run;
+    }
+}
+
+/* Fills a span with colors blended from start to end by a factor that starts
+ * at pos and changes by step for each pixel, in 16.16 fixed point. */
+static void blend_colors_span(DWORD *dst, ARGB start, ARGB end, REAL pos, REAL step, INT count)
+{
+    INT fac = (INT)(pos * 65536.0f), fac_step = (INT)(step * 65536.0f);
+    INT i, c;
+
+    for (i=0; i<count; i++, fac += fac_step)
+    {
+        INT f = min(max(fac, 0), 65536);
+        ARGB color = 0;
+
+        for (c=0; c<32; c+=8)
+        {
+            INT a = (start >> c) & 0xff, b = (end >> c) & 0xff;
+            color |= (DWORD)((a * (65536 - f) + b * f) >> 16) << c;
+        }
+        dst[i] = color;
+    }
+}
+
 static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     DWORD *argb_pixels, GpRect *fill_area, UINT cdwStride)
 {
@@ -1036,8 +1325,8 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     {
         int x, y;
         GpSolidFill *fill = (GpSolidFill*)brush;
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
+        for (y=0; y<fill_area->Height; y++)
+            for (x=0; x<fill_area->Width; x++)
                 argb_pixels[x + y*cdwStride] = fill->color;
         return Ok;
     }
@@ -1050,8 +1339,8 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         if (get_hatch_data(fill->hatchstyle, &hatch_data) != Ok)
             return NotImplemented;
 
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
+        for (y=0; y<fill_area->Height; y++)
+            for (x=0; x<fill_area->Width; x++)
             {
                 int hx, hy;
 
@@ -1109,7 +1398,42 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
             GdipDeleteMatrix(world_to_gradient);
         }
 
-        if (stat == Ok)
+        if (stat == Ok && fill_area->Width * fill_area->Height > LINE_GRADIENT_STEPS)
+        {
+            /* the position only selects a color, so look it up */
+            ARGB *colors = GdipAlloc(sizeof(ARGB) * (LINE_GRADIENT_STEPS + 1));
+            REAL x_delta = draw_points[1].X - draw_points[0].X;
+            REAL y_delta = draw_points[2].X - draw_points[0].X;
+
+            if (!colors)
+                return OutOfMemory;
+
+            for (x=0; x<=LINE_GRADIENT_STEPS; x++)
+                colors[x] = blend_line_gradient(fill, (REAL)x / LINE_GRADIENT_STEPS);
+
+            for (y=0; y<fill_area->Height; y++)
+            {
+                DWORD *row = argb_pixels + y*cdwStride;
+                REAL pos = draw_points[0].X + y * y_delta;
+
+                for (x=0; x<fill_area->Width; x++, pos += x_delta)
+                {
+                    REAL wrapped;
+
+                    if (fill->wrap == WrapModeTile)
+                        wrapped = pos - floorf(pos);
+                    else
+                    {
+                        wrapped = pos - 2.0f * floorf(pos * 0.5f);
+                        if (wrapped > 1.0f) wrapped = 2.0f - wrapped;
+                    }
+                    row[x] = colors[(INT)(wrapped * LINE_GRADIENT_STEPS)];
+                }
+            }
+
+            GdipFree(colors);
+        }
+        else if (stat == Ok)
         {
             REAL x_delta = draw_points[1].X - draw_points[0].X;
             REAL y_delta = draw_points[2].X - draw_points[0].X;
@@ -1212,13 +1536,38 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
             REAL y_dx = draw_points[2].X - draw_points[0].X;
             REAL y_dy = draw_points[2].Y - draw_points[0].Y;
 
+            REAL offset = 0.0f;
+            BOOL translated = x_dx == 1.0f && x_dy == 0.0f && y_dx == 0.0f && y_dy == 1.0f;
+
+            if (graphics->interpolation == InterpolationModeNearestNeighbor)
+            {
+                if (graphics->pixeloffset != PixelOffsetModeHalf &&
+                    graphics->pixeloffset != PixelOffsetModeHighQuality)
+                    offset = 0.5f;
+            }
+            else if (draw_points[0].X != floorf(draw_points[0].X) ||
+                     draw_points[0].Y != floorf(draw_points[0].Y))
+            {
+                /* filtering between texels can't be done by copying */
+                translated = FALSE;
+            }
+
             for (y=0; y<fill_area->Height; y++)
             {
+                if (translated)
+                {
+                    /* each texture row is copied, wrapping at tile edges */
+                    copy_texture_span(argb_pixels + y*cdwStride, (const ARGB*)fill->bitmap_bits,
+                        bitmap->width, bitmap->height, floorf(draw_points[0].X + offset),
+                        floorf(draw_points[0].Y + offset) + y, fill_area->Width, fill->imageattributes);
+                    continue;
+                }
+
                 for (x=0; x<fill_area->Width; x++)
                 {
                     GpPointF point;
                     point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + y * x_dy + y * y_dy;
+                    point.Y = draw_points[0].Y + x * x_dy + y * y_dy;
 
                     argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
                         &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
@@ -1415,6 +1764,17 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
                 if (max_x > fill_area->X + fill_area->Width)
                     max_x = fill_area->X + fill_area->Width;
 
+                if (start_color == end_color && min_x < max_x)
+                {
+                    /* the distance to the edge changes linearly along the row */
+                    REAL distance = ((end_point.Y - start_point.Y) * (start_point.X - min_x) +
+                        (end_point.X - start_point.X) * (yf - start_point.Y)) / center_distance;
+
+                    blend_colors_span(argb_pixels + (min_x-fill_area->X) + (y-fill_area->Y)*cdwStride,
+                        start_color, fill->centercolor, distance, -dy / center_distance, max_x - min_x);
+                    continue;
+                }
+
                 for (x=min_x; x<max_x; x++)
                 {
                     REAL xf = (REAL)x;
@@ -2409,6 +2769,11 @@ GpStatus WINGDIPAPI GdipDeleteGraphics(GpGraphics *graphics)
     }
 
     GdipDeleteRegion(graphics->clip);
+    if (graphics->blend_hdc)
+    {
+        DeleteDC(graphics->blend_hdc);
+        DeleteObject(graphics->blend_hbitmap);
+    }
     GdipFree(graphics);
 
     return Ok;
@@ -3634,6 +3999,276 @@ end:
     return retval;
 }
 
+/* Number of sub-scanlines sampled per pixel row when antialiasing. */
+#define AA_SUBSCANLINES 16
+
+struct aa_edge
+{
+    REAL x_top, dxdy;
+    REAL y_top, y_bottom;
+    INT winding;
+};
+
+struct aa_crossing
+{
+    REAL x;
+    INT winding;
+};
+
+static int compare_aa_edges(const void *a, const void *b)
+{
+    const struct aa_edge *edge1 = a, *edge2 = b;
+
+    if (edge1->y_top < edge2->y_top) return -1;
+    if (edge1->y_top > edge2->y_top) return 1;
+    return 0;
+}
+
+/* Add the coverage of [x0,x1) on one sub-scanline to the accumulation
+ * buffers. Partially covered pixels go to cover, fully covered runs are
+ * recorded as start/end deltas in delta. Each pixel is 256 units wide. */
+static void accumulate_aa_span(INT *cover, INT *delta, REAL x0, REAL x1)
+{
+    INT ix0 = floorf(x0), ix1 = floorf(x1);
+    INT f0 = (x0 - ix0) * 256, f1 = (x1 - ix1) * 256;
+
+    if (ix0 == ix1)
+        cover[ix0] += f1 - f0;
+    else
+    {
+        cover[ix0] += 256 - f0;
+        delta[ix0+1] += 256;
+        delta[ix1] -= 256;
+        cover[ix1] += f1;
+    }
+}
+
+/* Compute the coverage of a flattened, device space path for each pixel
+ * in fill_area and scale the alpha of the brush pixels by it. */
+static void rasterize_aa_path(const GpPath *path, const GpRect *fill_area,
+    struct aa_edge *edges, INT edge_count, struct aa_crossing *crossings,
+    INT *active, INT *cover, INT *delta, DWORD *argb_pixels)
+{
+    INT next_edge=0, active_count=0;
+    INT x, y, s, i, j;
+
+    for (y=0; y<fill_area->Height; y++)
+    {
+        DWORD *row = argb_pixels + y * fill_area->Width;
+        INT coverage;
+
+        memset(cover, 0, sizeof(*cover) * (fill_area->Width + 1));
+        memset(delta, 0, sizeof(*delta) * (fill_area->Width + 1));
+
+        for (s=0; s<AA_SUBSCANLINES; s++)
+        {
+            REAL sample_y = fill_area->Y + y + (s + 0.5) / AA_SUBSCANLINES;
+            INT crossing_count=0, winding=0;
+
+            while (next_edge < edge_count && edges[next_edge].y_top <= sample_y)
+                active[active_count++] = next_edge++;
+
+            /* Drop finished edges and collect the crossings sorted by x. */
+            for (i=0, j=0; i<active_count; i++)
+            {
+                const struct aa_edge *edge = &edges[active[i]];
+                REAL cross_x;
+                INT k;
+
+                if (edge->y_bottom <= sample_y)
+                    continue;
+
+                active[j++] = active[i];
+
+                cross_x = edge->x_top + (sample_y - edge->y_top) * edge->dxdy;
+                for (k=crossing_count; k>0 && crossings[k-1].x > cross_x; k--)
+                    crossings[k] = crossings[k-1];
+                crossings[k].x = cross_x;
+                crossings[k].winding = edge->winding;
+                crossing_count++;
+            }
+            active_count = j;
+
+            for (i=0; i+1<crossing_count; i++)
+            {
+                REAL x0, x1;
+
+                winding += crossings[i].winding;
+
+                if (path->fill == FillModeAlternate ? !(winding & 1) : !winding)
+                    continue;
+
+                x0 = max(crossings[i].x - fill_area->X, 0.0);
+                x1 = min(crossings[i+1].x - fill_area->X, fill_area->Width);
+
+                if (x0 < x1)
+                    accumulate_aa_span(cover, delta, x0, x1);
+            }
+        }
+
+        coverage = 0;
+        for (x=0; x<fill_area->Width; x++)
+        {
+            INT alpha;
+
+            coverage += delta[x];
+            alpha = ((coverage + cover[x]) * 255 + 128 * AA_SUBSCANLINES) / (256 * AA_SUBSCANLINES);
+
+            if (alpha <= 0)
+                row[x] = 0;
+            else if (alpha < 255)
+                row[x] = (row[x] & 0xffffff) | ((((row[x] >> 24) * alpha + 127) / 255) << 24);
+        }
+    }
+}
+
+/* Fill a path with an antialiased scanline rasterizer instead of going
+ * through a GDI region. */
+static GpStatus SOFTWARE_GdipFillPathAntiAlias(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF graphics_bounds;
+    GpRect fill_area;
+    struct aa_edge *edges;
+    struct aa_crossing *crossings;
+    INT *active, *cover, *delta;
+    DWORD *pixel_data;
+    REAL min_x, min_y, max_x, max_y;
+    INT i, figure_start=0, edge_count=0, left, top, right, bottom;
+
+    stat = get_graphics_bounds(graphics, &graphics_bounds);
+
+    if (stat == Ok)
+        stat = get_graphics_transform(graphics, CoordinateSpaceDevice,
+            CoordinateSpaceWorld, &world_to_device);
+
+    /* Sample at pixel centers unless the pixel offset mode says otherwise. */
+    if (stat == Ok && graphics->pixeloffset != PixelOffsetModeHalf &&
+        graphics->pixeloffset != PixelOffsetModeHighQuality)
+        stat = GdipTranslateMatrix(&world_to_device, 0.5, 0.5, MatrixOrderAppend);
+
+    if (stat != Ok)
+        return stat;
+
+    stat = GdipClonePath(path, &flat_path);
+
+    if (stat != Ok)
+        return stat;
+
+    stat = GdipFlattenPath(flat_path, &world_to_device, 0.25);
+
+    if (stat != Ok || flat_path->pathdata.Count < 2)
+    {
+        GdipDeletePath(flat_path);
+        return stat;
+    }
+
+    edges = GdipAlloc(sizeof(*edges) * flat_path->pathdata.Count);
+    if (!edges)
+    {
+        GdipDeletePath(flat_path);
+        return OutOfMemory;
+    }
+
+    min_x = max_x = flat_path->pathdata.Points[0].X;
+    min_y = max_y = flat_path->pathdata.Points[0].Y;
+
+    for (i=0; i<flat_path->pathdata.Count; i++)
+    {
+        const GpPointF *start, *end;
+        INT next = i+1;
+
+        if ((flat_path->pathdata.Types[i] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            figure_start = i;
+
+        /* Figures are closed implicitly when filling. */
+        if (next == flat_path->pathdata.Count ||
+            (flat_path->pathdata.Types[next] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            next = figure_start;
+
+        start = &flat_path->pathdata.Points[i];
+        end = &flat_path->pathdata.Points[next];
+
+        min_x = min(min_x, start->X);
+        max_x = max(max_x, start->X);
+        min_y = min(min_y, start->Y);
+        max_y = max(max_y, start->Y);
+
+        if (start->Y == end->Y)
+            continue;
+
+        if (start->Y < end->Y)
+        {
+            edges[edge_count].x_top = start->X;
+            edges[edge_count].y_top = start->Y;
+            edges[edge_count].y_bottom = end->Y;
+            edges[edge_count].winding = 1;
+        }
+        else
+        {
+            edges[edge_count].x_top = end->X;
+            edges[edge_count].y_top = end->Y;
+            edges[edge_count].y_bottom = start->Y;
+            edges[edge_count].winding = -1;
+        }
+        edges[edge_count].dxdy = (end->X - start->X) / (end->Y - start->Y);
+        edge_count++;
+    }
+
+    left = max(floorf(min_x), graphics_bounds.X);
+    top = max(floorf(min_y), graphics_bounds.Y);
+    right = min(ceilf(max_x), graphics_bounds.X + graphics_bounds.Width);
+    bottom = min(ceilf(max_y), graphics_bounds.Y + graphics_bounds.Height);
+
+    if (!edge_count || left >= right || top >= bottom)
+    {
+        GdipFree(edges);
+        GdipDeletePath(flat_path);
+        return Ok;
+    }
+
+    fill_area.X = left;
+    fill_area.Y = top;
+    fill_area.Width = right - left;
+    fill_area.Height = bottom - top;
+
+    qsort(edges, edge_count, sizeof(*edges), compare_aa_edges);
+
+    crossings = GdipAlloc(sizeof(*crossings) * edge_count);
+    active = GdipAlloc(sizeof(*active) * edge_count);
+    cover = GdipAlloc(sizeof(*cover) * (fill_area.Width + 1));
+    delta = GdipAlloc(sizeof(*delta) * (fill_area.Width + 1));
+    pixel_data = GdipAlloc(sizeof(*pixel_data) * fill_area.Width * fill_area.Height);
+
+    if (!crossings || !active || !cover || !delta || !pixel_data)
+        stat = OutOfMemory;
+
+    if (stat == Ok)
+        stat = brush_fill_pixels(graphics, brush, pixel_data, &fill_area, fill_area.Width);
+
+    if (stat == Ok)
+    {
+        rasterize_aa_path(flat_path, &fill_area, edges, edge_count, crossings,
+            active, cover, delta, pixel_data);
+
+        stat = alpha_blend_pixels_hrgn(graphics, fill_area.X, fill_area.Y,
+            (BYTE*)pixel_data, fill_area.Width, fill_area.Height,
+            fill_area.Width * 4, NULL);
+    }
+
+    GdipFree(pixel_data);
+    GdipFree(delta);
+    GdipFree(cover);
+    GdipFree(active);
+    GdipFree(crossings);
+    GdipFree(edges);
+    GdipDeletePath(flat_path);
+
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -3642,6 +4277,10 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
+    if (graphics->smoothing == SmoothingModeAntiAlias ||
+        graphics->smoothing == SmoothingModeHighQuality)
+        return SOFTWARE_GdipFillPathAntiAlias(graphics, brush, path);
+
     /* FIXME: This could probably be done more efficiently without regions. */
 
     stat = GdipCreateRegionPath(path, &rgn);
@@ -3668,7 +4307,10 @@ GpStatus WINGDIPAPI GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *p
     if(graphics->busy)
         return ObjectBusy;
 
-    if (!graphics->image && !graphics->alpha_hdc)
+    /* GDI cannot antialias fills, so leave those to the software rasterizer. */
+    if (!graphics->image && !graphics->alpha_hdc &&
+        graphics->smoothing != SmoothingModeAntiAlias &&
+        graphics->smoothing != SmoothingModeHighQuality)
         stat = GDI32_GdipFillPath(graphics, brush, path);
 
     if (stat == NotImplemented)
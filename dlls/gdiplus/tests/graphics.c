@@ -5495,6 +5495,322 @@ static void test_clipping_2(void)
     DeleteDC(hdc);
 }
 
+static BOOL color_match(ARGB c1, ARGB c2, BYTE max_diff)
+{
+    int i;
+
+    for (i=0; i<4; i++)
+    {
+        if (abs((int)((c1 >> (i*8)) & 0xff) - (int)((c2 >> (i*8)) & 0xff)) > max_diff)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void test_alpha_blend_bitmap(void)
+{
+    static const PixelFormat formats[] = {
+        PixelFormat32bppARGB, PixelFormat32bppPARGB, PixelFormat32bppRGB, PixelFormat24bppRGB };
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap;
+    GpSolidFill *opaque, *translucent, *transparent;
+    GpLineGradient *gradient;
+    GpPointF start, end;
+    ARGB color;
+    int i;
+
+    status = GdipCreateSolidFill(0xff0000ff, &opaque);
+    expect(Ok, status);
+    status = GdipCreateSolidFill(0x80ff0000, &translucent);
+    expect(Ok, status);
+    status = GdipCreateSolidFill(0x00ff0000, &transparent);
+    expect(Ok, status);
+
+    start.X = start.Y = 0.0;
+    end.X = 16.0;
+    end.Y = 0.0;
+    status = GdipCreateLineBrush(&start, &end, 0x80ff0000, 0x80ff0000, WrapModeTile, &gradient);
+    expect(Ok, status);
+
+    for (i=0; i<sizeof(formats)/sizeof(formats[0]); i++)
+    {
+        status = GdipCreateBitmapFromScan0(16, 16, 0, formats[i], NULL, &bitmap);
+        expect(Ok, status);
+
+        status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+        expect(Ok, status);
+
+        status = GdipFillRectangleI(graphics, (GpBrush*)opaque, 0, 0, 16, 16);
+        expect(Ok, status);
+
+        status = GdipFillRectangleI(graphics, (GpBrush*)translucent, 0, 0, 8, 8);
+        expect(Ok, status);
+
+        status = GdipFillRectangleI(graphics, (GpBrush*)gradient, 8, 8, 8, 8);
+        expect(Ok, status);
+
+        status = GdipFillRectangleI(graphics, (GpBrush*)transparent, 0, 8, 8, 8);
+        expect(Ok, status);
+
+        /* Parts of the fill outside the bitmap are clipped. */
+        status = GdipFillRectangleI(graphics, (GpBrush*)translucent, 12, -4, 8, 8);
+        expect(Ok, status);
+
+        GdipDeleteGraphics(graphics);
+
+        status = GdipBitmapGetPixel(bitmap, 4, 4, &color);
+        expect(Ok, status);
+        ok(color_match(0xff80007f, color, 2), "format %x: expected 0xff80007f, got 0x%08x\n", formats[i], color);
+
+        status = GdipBitmapGetPixel(bitmap, 12, 12, &color);
+        expect(Ok, status);
+        ok(color_match(0xff80007f, color, 2), "format %x: expected 0xff80007f, got 0x%08x\n", formats[i], color);
+
+        status = GdipBitmapGetPixel(bitmap, 4, 12, &color);
+        expect(Ok, status);
+        expect(0xff0000ff, color);
+
+        status = GdipBitmapGetPixel(bitmap, 10, 4, &color);
+        expect(Ok, status);
+        expect(0xff0000ff, color);
+
+        status = GdipBitmapGetPixel(bitmap, 14, 2, &color);
+        expect(Ok, status);
+        ok(color_match(0xff80007f, color, 2), "format %x: expected 0xff80007f, got 0x%08x\n", formats[i], color);
+
+        GdipDisposeImage((GpImage*)bitmap);
+    }
+
+    GdipDeleteBrush((GpBrush*)gradient);
+    GdipDeleteBrush((GpBrush*)transparent);
+    GdipDeleteBrush((GpBrush*)translucent);
+    GdipDeleteBrush((GpBrush*)opaque);
+}
+
+static void test_alpha_blend_dib(void)
+{
+    GpStatus status;
+    GpGraphics *graphics;
+    GpSolidFill *translucent;
+    HBITMAP hbm, old_hbm;
+    BITMAPINFO bmi;
+    DWORD *bits;
+    HDC hdc;
+    int i;
+
+    hdc = CreateCompatibleDC(0);
+    ok(hdc != NULL, "CreateCompatibleDC failed\n");
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biHeight = 16;
+    bmi.bmiHeader.biWidth = 16;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hbm = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void**)&bits, NULL, 0);
+    ok(hbm != NULL, "CreateDIBSection failed\n");
+    old_hbm = SelectObject(hdc, hbm);
+
+    for (i=0; i<16*16; i++)
+        bits[i] = 0xff0000ff;
+
+    status = GdipCreateFromHDC(hdc, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateSolidFill(0x80ff0000, &translucent);
+    expect(Ok, status);
+
+    status = GdipSetClipRectI(graphics, 0, 0, 8, 16, CombineModeReplace);
+    expect(Ok, status);
+
+    /* the fill covers the top of the bitmap, which is its last rows */
+    status = GdipFillRectangleI(graphics, (GpBrush*)translucent, 0, 0, 16, 8);
+    expect(Ok, status);
+
+    GdipDeleteGraphics(graphics);
+    GdipDeleteBrush((GpBrush*)translucent);
+
+    ok(color_match(0xff80007f, bits[4 + (15-4)*16], 2), "expected 0xff80007f, got 0x%08x\n", bits[4 + (15-4)*16]);
+    /* outside the clip rectangle */
+    expect(0xff0000ff, bits[12 + (15-4)*16]);
+    /* outside the fill */
+    expect(0xff0000ff, bits[4 + (15-12)*16]);
+
+    SelectObject(hdc, old_hbm);
+    DeleteObject(hbm);
+    DeleteDC(hdc);
+}
+
+static void test_fill_spans(void)
+{
+    static const ARGB texture_data[] = { 0xff000001, 0xff000002, 0xff000003, 0xff000004 };
+    static const struct
+    {
+        WrapMode wrap;
+        int x, y;
+        ARGB color;
+    } texels[] = {
+        { WrapModeTile, 0, 0, 0xff000001 }, { WrapModeTile, 3, 2, 0xff000002 },
+        { WrapModeTile, 4, 3, 0xff000003 }, { WrapModeTileFlipX, 2, 0, 0xff000002 },
+        { WrapModeTileFlipX, 3, 1, 0xff000003 }, { WrapModeTileFlipXY, 2, 2, 0xff000004 },
+    };
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap, *texture_bitmap;
+    GpTexture *texture;
+    GpLineGradient *gradient;
+    GpPointF start, end;
+    ARGB color;
+    int i;
+
+    status = GdipCreateBitmapFromScan0(64, 64, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateBitmapFromScan0(2, 2, 8, PixelFormat32bppARGB, (BYTE*)texture_data, &texture_bitmap);
+    expect(Ok, status);
+
+    for (i=0; i<sizeof(texels)/sizeof(texels[0]); i++)
+    {
+        status = GdipCreateTexture((GpImage*)texture_bitmap, texels[i].wrap, &texture);
+        expect(Ok, status);
+
+        status = GdipFillRectangleI(graphics, (GpBrush*)texture, 0, 0, 5, 5);
+        expect(Ok, status);
+        GdipDeleteBrush((GpBrush*)texture);
+
+        status = GdipBitmapGetPixel(bitmap, texels[i].x, texels[i].y, &color);
+        expect(Ok, status);
+        ok(color == texels[i].color, "%d: expected 0x%08x, got 0x%08x\n", i, texels[i].color, color);
+    }
+
+    GdipDisposeImage((GpImage*)texture_bitmap);
+
+    /* large enough to go through the color table */
+    start.X = start.Y = 0.0;
+    end.X = 64.0;
+    end.Y = 0.0;
+    status = GdipCreateLineBrush(&start, &end, 0xff000000, 0xffff0000, WrapModeTile, &gradient);
+    expect(Ok, status);
+
+    status = GdipFillRectangleI(graphics, (GpBrush*)gradient, 0, 0, 64, 64);
+    expect(Ok, status);
+    GdipDeleteBrush((GpBrush*)gradient);
+
+    status = GdipBitmapGetPixel(bitmap, 0, 10, &color);
+    expect(Ok, status);
+    ok(color_match(0xff000000, color, 2), "expected 0xff000000, got 0x%08x\n", color);
+
+    status = GdipBitmapGetPixel(bitmap, 32, 40, &color);
+    expect(Ok, status);
+    ok(color_match(0xff7f0000, color, 2), "expected 0xff7f0000, got 0x%08x\n", color);
+
+    status = GdipBitmapGetPixel(bitmap, 63, 63, &color);
+    expect(Ok, status);
+    ok(color_match(0xfffb0000, color, 2), "expected 0xfffb0000, got 0x%08x\n", color);
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+}
+
+static void test_antialias_fill(void)
+{
+    static const struct
+    {
+        int x, y;
+        ARGB color;
+    } rect_pixels[] = {
+        { 3, 3, 0xff000000 }, { 2, 4, 0xff000000 },
+        { 1, 3, 0x80000000 }, { 5, 3, 0x80000000 },
+        { 3, 1, 0x80000000 }, { 3, 5, 0x80000000 },
+        { 1, 1, 0x40000000 }, { 5, 5, 0x40000000 },
+        { 0, 0, 0 }, { 6, 3, 0 }, { 3, 7, 0 }
+    };
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap;
+    GpSolidFill *brush;
+    GpPath *path;
+    ARGB color;
+    int i;
+
+    status = GdipCreateBitmapFromScan0(8, 8, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, status);
+
+    status = GdipSetPixelOffsetMode(graphics, PixelOffsetModeHalf);
+    expect(Ok, status);
+
+    status = GdipCreateSolidFill(0xff000000, &brush);
+    expect(Ok, status);
+
+    status = GdipFillRectangle(graphics, (GpBrush*)brush, 1.5, 1.5, 4.0, 4.0);
+    expect(Ok, status);
+
+    for (i=0; i<sizeof(rect_pixels)/sizeof(rect_pixels[0]); i++)
+    {
+        status = GdipBitmapGetPixel(bitmap, rect_pixels[i].x, rect_pixels[i].y, &color);
+        expect(Ok, status);
+        ok(color_match(rect_pixels[i].color, color, 8), "(%i,%i): expected 0x%08x, got 0x%08x\n",
+            rect_pixels[i].x, rect_pixels[i].y, rect_pixels[i].color, color);
+    }
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+
+    /* Two nested rectangles drawn in the same direction leave a hole only
+     * with the alternate fill mode. */
+    for (i=0; i<2; i++)
+    {
+        status = GdipCreateBitmapFromScan0(8, 8, 0, PixelFormat32bppARGB, NULL, &bitmap);
+        expect(Ok, status);
+
+        status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+        expect(Ok, status);
+
+        status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+        expect(Ok, status);
+
+        status = GdipSetPixelOffsetMode(graphics, PixelOffsetModeHalf);
+        expect(Ok, status);
+
+        status = GdipCreatePath(i ? FillModeWinding : FillModeAlternate, &path);
+        expect(Ok, status);
+
+        status = GdipAddPathRectangle(path, 0.0, 0.0, 8.0, 8.0);
+        expect(Ok, status);
+
+        status = GdipAddPathRectangle(path, 2.0, 2.0, 4.0, 4.0);
+        expect(Ok, status);
+
+        status = GdipFillPath(graphics, (GpBrush*)brush, path);
+        expect(Ok, status);
+
+        GdipDeletePath(path);
+        GdipDeleteGraphics(graphics);
+
+        status = GdipBitmapGetPixel(bitmap, 1, 1, &color);
+        expect(Ok, status);
+        expect(0xff000000, color);
+
+        status = GdipBitmapGetPixel(bitmap, 4, 4, &color);
+        expect(Ok, status);
+        expect(i ? 0xff000000 : 0, color);
+
+        GdipDisposeImage((GpImage*)bitmap);
+    }
+
+    GdipDeleteBrush((GpBrush*)brush);
+}
+
 START_TEST(graphics)
 {
     struct GdiplusStartupInput gdiplusStartupInput;
@@ -5565,6 +5881,10 @@ START_TEST(graphics)
     test_getdc_scaled();
     test_alpha_hdc();
     test_bitmapfromgraphics();
+    test_alpha_blend_bitmap();
+    test_alpha_blend_dib();
+    test_fill_spans();
+    test_antialias_fill();
 
     GdiplusShutdown(gdiplusToken);
     DestroyWindow( hwnd );
@@ -31,6 +31,14 @@ typedef struct {
     jsdisp_t dispex;
 
     DWORD length;
+
+    /* Elements [0, elems_cnt) are stored in elems rather than as properties. */
+    jsval_t *elems;
+    DWORD elems_cnt;
+    DWORD elems_size;
+
+    /* Some elements past elems_cnt are stored as regular properties. */
+    BOOL sparse;
 } ArrayInstance;
 
 static const WCHAR lengthW[] = {'l','e','n','g','t','h',0};
@@ -88,29 +96,55 @@ static HRESULT get_length(script_ctx_t *ctx, vdisp_t *vdisp, jsdisp_t **jsthis,
     return S_OK;
 }
 
-static HRESULT set_length(jsdisp_t *obj, DWORD length)
+static inline ArrayInstance *dense_array(jsdisp_t *obj)
 {
-    if(is_class(obj, JSCLASS_ARRAY)) {
-        ((ArrayInstance*)obj)->length = length;
-        return S_OK;
-    }
+    ArrayInstance *array;
 
-    return jsdisp_propput_name(obj, lengthW, jsval_number(length));
+    if(!is_class(obj, JSCLASS_ARRAY))
+        return NULL;
+
+    array = (ArrayInstance*)obj;
+    return !array->sparse && array->elems_cnt == array->length ? array : NULL;
 }
 
-static WCHAR *idx_to_str(DWORD idx, WCHAR *ptr)
+static BOOL ensure_elems_size(ArrayInstance *array, DWORD size)
 {
-    if(!idx) {
-        *ptr = '0';
-        return ptr;
-    }
+    jsval_t *new_elems;
+    DWORD new_size;
+
+    if(size <= array->elems_size)
+        return TRUE;
+
+    new_size = array->elems_size ? array->elems_size*2 : 4;
+    if(new_size < size)
+        new_size = size;
+
+    if(array->elems)
+        new_elems = heap_realloc(array->elems, new_size*sizeof(*new_elems));
+    else
+        new_elems = heap_alloc(new_size*sizeof(*new_elems));
+    if(!new_elems)
+        return FALSE;
 
-    while(idx) {
-        *ptr-- = '0' + (idx%10);
-        idx /= 10;
+    array->elems = new_elems;
+    array->elems_size = new_size;
+    return TRUE;
+}
+
+static void truncate_elems(ArrayInstance *array, DWORD cnt)
+{
+    while(array->elems_cnt > cnt)
+        jsval_release(array->elems[--array->elems_cnt]);
+}
+
+static HRESULT set_length(jsdisp_t *obj, DWORD length)
+{
+    if(is_class(obj, JSCLASS_ARRAY)) {
+        ((ArrayInstance*)obj)->length = length;
+        return S_OK;
     }
 
-    return ptr+1;
+    return jsdisp_propput_name(obj, lengthW, jsval_number(length));
 }
 
 static HRESULT Array_length(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsigned argc, jsval_t *argv,
@@ -137,10 +171,15 @@ static HRESULT Array_length(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsi
         if(len!=(DWORD)len)
             return throw_range_error(ctx, JS_E_INVALID_LENGTH, NULL);
 
-        for(i=len; i<This->length; i++) {
-            hres = jsdisp_delete_idx(&This->dispex, i);
-            if(FAILED(hres))
-                return hres;
+        if(len < This->elems_cnt)
+            truncate_elems(This, len);
+
+        if(This->sparse) {
+            for(i=len; i<This->length; i++) {
+                hres = jsdisp_delete_idx(&This->dispex, i);
+                if(FAILED(hres))
+                    return hres;
+            }
         }
 
         This->length = len;
@@ -490,6 +529,7 @@ static HRESULT Array_reverse(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
 static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
     DWORD length = 0, i;
     jsval_t v, ret;
@@ -513,6 +553,19 @@ static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsign
         return S_OK;
     }
 
+    if((array = dense_array(jsthis))) {
+        ret = array->elems[0];
+        memmove(array->elems, array->elems+1, (length-1)*sizeof(*array->elems));
+        array->elems_cnt--;
+        array->length--;
+
+        if(r)
+            *r = ret;
+        else
+            jsval_release(ret);
+        return S_OK;
+    }
+
     hres = jsdisp_get_idx(jsthis, 0, &ret);
     if(hres == DISP_E_UNKNOWNNAME) {
         ret = jsval_undefined();
@@ -891,6 +944,12 @@ static HRESULT Array_splice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsig
         for(i=length; SUCCEEDED(hres) && i != length-delete_cnt+add_args; i--)
             hres = jsdisp_delete_idx(jsthis, i-1);
     }else if(add_args > delete_cnt) {
+        if(dense_array(jsthis)) {
+            /* Grow the array in order first, so that its elements stay dense. */
+            for(i=length; SUCCEEDED(hres) && i < length-delete_cnt+add_args; i++)
+                hres = jsdisp_propput_idx(jsthis, i, jsval_undefined());
+        }
+
         for(i=length-delete_cnt; SUCCEEDED(hres) && i != start; i--) {
             hres = jsdisp_get_idx(jsthis, i+delete_cnt-1, &val);
             if(hres == DISP_E_UNKNOWNNAME) {
@@ -945,11 +1004,10 @@ static HRESULT Array_toLocaleString(script_ctx_t *ctx, vdisp_t *vthis, WORD flag
 static HRESULT Array_unshift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
-    WCHAR buf[14], *buf_end, *str;
     DWORD i, length;
     jsval_t val;
-    DISPID id;
     HRESULT hres;
 
     TRACE("\n");
@@ -958,38 +1016,46 @@ static HRESULT Array_unshift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
     if(FAILED(hres))
         return hres;
 
-    if(argc) {
-        buf_end = buf + sizeof(buf)/sizeof(WCHAR)-1;
-        *buf_end-- = 0;
-        i = length;
+    if(argc && (array = dense_array(jsthis))) {
+        if(!ensure_elems_size(array, length+argc))
+            return E_OUTOFMEMORY;
 
-        while(i--) {
-            str = idx_to_str(i, buf_end);
+        memmove(array->elems+argc, array->elems, length*sizeof(*array->elems));
 
-            hres = jsdisp_get_id(jsthis, str, 0, &id);
-            if(SUCCEEDED(hres)) {
-                hres = jsdisp_propget(jsthis, id, &val);
-                if(FAILED(hres))
-                    return hres;
+        for(i=0; i<argc; i++) {
+            hres = jsval_copy(argv[i], array->elems+i);
+            if(FAILED(hres)) {
+                while(i--)
+                    jsval_release(array->elems[i]);
+                memmove(array->elems, array->elems+argc, length*sizeof(*array->elems));
+                return hres;
+            }
+        }
+
+        array->elems_cnt += argc;
+        array->length += argc;
+        length += argc;
+    }else if(argc) {
+        i = length;
 
+        while(i--) {
+            hres = jsdisp_get_idx(jsthis, i, &val);
+            if(hres == DISP_E_UNKNOWNNAME) {
+                hres = jsdisp_delete_idx(jsthis, i+argc);
+            }else if(SUCCEEDED(hres)) {
                 hres = jsdisp_propput_idx(jsthis, i+argc, val);
                 jsval_release(val);
-            }else if(hres == DISP_E_UNKNOWNNAME) {
-                hres = IDispatchEx_DeleteMemberByDispID(vthis->u.dispex, id);
             }
+            if(FAILED(hres))
+                return hres;
         }
 
-        if(FAILED(hres))
-            return hres;
-    }
-
-    for(i=0; i<argc; i++) {
-        hres = jsdisp_propput_idx(jsthis, i, argv[i]);
-        if(FAILED(hres))
-            return hres;
-    }
+        for(i=0; i<argc; i++) {
+            hres = jsdisp_propput_idx(jsthis, i, argv[i]);
+            if(FAILED(hres))
+                return hres;
+        }
 
-    if(argc) {
         length += argc;
         hres = set_length(jsthis, length);
         if(FAILED(hres))
@@ -1021,7 +1087,11 @@ static HRESULT Array_value(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsig
 
 static void Array_destructor(jsdisp_t *dispex)
 {
-    heap_free(dispex);
+    ArrayInstance *array = (ArrayInstance*)dispex;
+
+    truncate_elems(array, 0);
+    heap_free(array->elems);
+    heap_free(array);
 }
 
 static void Array_on_put(jsdisp_t *dispex, const WCHAR *name)
@@ -1041,10 +1111,85 @@ static void Array_on_put(jsdisp_t *dispex, const WCHAR *name)
     if(*ptr)
         return;
 
+    array->sparse = TRUE;
     if(id >= array->length)
         array->length = id+1;
 }
 
+static unsigned Array_idx_length(jsdisp_t *dispex)
+{
+    return ((ArrayInstance*)dispex)->elems_cnt;
+}
+
+static HRESULT Array_idx_get(jsdisp_t *dispex, unsigned idx, jsval_t *r)
+{
+    return jsval_copy(((ArrayInstance*)dispex)->elems[idx], r);
+}
+
+static HRESULT Array_idx_put(jsdisp_t *dispex, unsigned idx, jsval_t val)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    jsval_t copy;
+    HRESULT hres;
+
+    TRACE("%p[%u] = %s\n", array, idx, debugstr_jsval(val));
+
+    hres = jsval_copy(val, &copy);
+    if(FAILED(hres))
+        return hres;
+
+    jsval_release(array->elems[idx]);
+    array->elems[idx] = copy;
+    return S_OK;
+}
+
+static HRESULT Array_idx_insert(jsdisp_t *dispex, unsigned idx)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+
+    if(array->sparse || idx != array->elems_cnt) {
+        /* Elements that would leave a hole in elems are stored as properties */
+        TRACE("%p[%u] makes array sparse\n", array, idx);
+        array->sparse = TRUE;
+        return S_FALSE;
+    }
+
+    if(!ensure_elems_size(array, idx+1))
+        return E_OUTOFMEMORY;
+
+    array->elems[array->elems_cnt++] = jsval_undefined();
+    if(array->length < array->elems_cnt)
+        array->length = array->elems_cnt;
+    return S_OK;
+}
+
+static HRESULT Array_idx_delete(jsdisp_t *dispex, unsigned idx)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    HRESULT hres;
+
+    TRACE("%p[%u]\n", array, idx);
+
+    if(idx+1 < array->elems_cnt) {
+        hres = jsdisp_detach_idx(dispex, idx+1, array->elems_cnt);
+        if(FAILED(hres))
+            return hres;
+        array->sparse = TRUE;
+    }
+
+    truncate_elems(array, idx);
+    return S_OK;
+}
+
+static void Array_gc_traverse(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *dispex)
+{
+    ArrayInstance *array = (ArrayInstance*)dispex;
+    DWORD i;
+
+    for(i=0; i < array->elems_cnt; i++)
+        gc_process_linked_val(gc, op, array->elems+i);
+}
+
 static const builtin_prop_t Array_props[] = {
     {concatW,                Array_concat,               PROPF_METHOD|1},
     {joinW,                  Array_join,                 PROPF_METHOD|1},
@@ -1067,7 +1212,13 @@ static const builtin_info_t Array_info = {
     sizeof(Array_props)/sizeof(*Array_props),
     Array_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_gc_traverse,
+    Array_idx_insert,
+    Array_idx_delete
 };
 
 static const builtin_prop_t ArrayInst_props[] = {
@@ -1080,7 +1231,13 @@ static const builtin_info_t ArrayInst_info = {
     sizeof(ArrayInst_props)/sizeof(*ArrayInst_props),
     ArrayInst_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_gc_traverse,
+    Array_idx_insert,
+    Array_idx_delete
 };
 
 static HRESULT ArrayConstr_value(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
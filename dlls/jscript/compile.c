@@ -1804,6 +1804,7 @@ void release_bytecode(bytecode_t *code)
     heap_pool_free(&code->heap);
     heap_free(code->bstr_pool);
     heap_free(code->str_pool);
+    heap_free(code->prop_caches);
     heap_free(code->instrs);
     heap_free(code);
 }
@@ -2025,6 +2026,12 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args,
         return hres;
     }
 
+    compiler.code->prop_caches = heap_alloc_zero(compiler.code_off * sizeof(*compiler.code->prop_caches));
+    if(!compiler.code->prop_caches) {
+        release_bytecode(compiler.code);
+        return E_OUTOFMEMORY;
+    }
+
     *ret = compiler.code;
     return S_OK;
 }
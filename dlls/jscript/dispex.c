@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include "jscript.h"
+#include "engine.h"
 
 #include "wine/unicode.h"
 #include "wine/debug.h"
@@ -65,9 +66,64 @@ static inline DISPID prop_to_id(jsdisp_t *This, dispex_prop_t *prop)
     return prop - This->props;
 }
 
+static BOOL is_idx_name(const WCHAR *name, unsigned *ret)
+{
+    const WCHAR *ptr;
+    unsigned idx = 0;
+
+    if(!name || !isdigitW(*name) || (*name == '0' && name[1]))
+        return FALSE;
+
+    for(ptr = name; isdigitW(*ptr) && idx < 0x10000000; ptr++)
+        idx = idx*10 + (*ptr-'0');
+    if(*ptr)
+        return FALSE;
+
+    *ret = idx;
+    return TRUE;
+}
+
+static inline DWORD get_idx_flags(jsdisp_t *This)
+{
+    return This->builtin_info->idx_put ? PROPF_ENUM : PROPF_CONST;
+}
+
+/*
+ * The range of indexes stored by the object may change after a property
+ * for an index was created. An index stored by the object shadows inherited
+ * and deleted properties of the same name, and a slot for an index past
+ * the current range no longer exists.
+ */
+static void update_idx_prop(jsdisp_t *This, dispex_prop_t *prop)
+{
+    unsigned idx;
+
+    switch(prop->type) {
+    case PROP_IDX:
+        if(prop->u.idx >= This->builtin_info->idx_length(This))
+            prop->type = PROP_DELETED;
+        break;
+    case PROP_PROTREF:
+    case PROP_DELETED:
+        if(is_idx_name(prop->name, &idx) && idx < This->builtin_info->idx_length(This)) {
+            prop->type = PROP_IDX;
+            prop->flags = get_idx_flags(This);
+            prop->u.idx = idx;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 static inline dispex_prop_t *get_prop(jsdisp_t *This, DISPID id)
 {
-    if(id < 0 || id >= This->prop_cnt || This->props[id].type == PROP_DELETED)
+    if(id < 0 || id >= This->prop_cnt)
+        return NULL;
+
+    if(This->builtin_info->idx_length)
+        update_idx_prop(This, This->props+id);
+    if(This->props[id].type == PROP_DELETED)
         return NULL;
 
     return This->props+id;
@@ -202,6 +258,9 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
                 This->props[bucket].bucket_head = pos;
             }
 
+            if(This->builtin_info->idx_length)
+                update_idx_prop(This, This->props+pos);
+
             *ret = &This->props[pos];
             return S_OK;
         }
@@ -222,13 +281,10 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
     }
 
     if(This->builtin_info->idx_length) {
-        const WCHAR *ptr;
-        unsigned idx = 0;
+        unsigned idx;
 
-        for(ptr = name; isdigitW(*ptr) && idx < 0x10000; ptr++)
-            idx = idx*10 + (*ptr-'0');
-        if(!*ptr && idx < This->builtin_info->idx_length(This)) {
-            prop = alloc_prop(This, name, PROP_IDX, This->builtin_info->idx_put ? 0 : PROPF_CONST);
+        if(is_idx_name(name, &idx) && idx < This->builtin_info->idx_length(This)) {
+            prop = alloc_prop(This, name, PROP_IDX, get_idx_flags(This));
             if(!prop)
                 return E_OUTOFMEMORY;
 
@@ -292,6 +348,18 @@ static HRESULT ensure_prop_name(jsdisp_t *This, const WCHAR *name, BOOL search_p
     else
         hres = find_prop_name(This, string_hash(name), name, &prop);
     if(SUCCEEDED(hres) && (!prop || prop->type == PROP_DELETED)) {
+        unsigned idx;
+
+        if(This->builtin_info->idx_insert && is_idx_name(name, &idx)) {
+            HRESULT insert_hres;
+
+            insert_hres = This->builtin_info->idx_insert(This, idx);
+            if(FAILED(insert_hres))
+                return insert_hres;
+            if(insert_hres == S_OK)
+                return find_prop_name(This, string_hash(name), name, ret);
+        }
+
         TRACE("creating prop %s flags %x\n", debugstr_w(name), create_flags);
 
         if(prop) {
@@ -542,6 +610,30 @@ static HRESULT fill_protrefs(jsdisp_t *This)
     return S_OK;
 }
 
+/* Properties of stored indexes are created lazily, make sure they are all enumerated. */
+static HRESULT fill_idx_props(jsdisp_t *This)
+{
+    dispex_prop_t *prop;
+    unsigned i, length;
+    WCHAR name[12];
+    HRESULT hres;
+
+    static const WCHAR formatW[] = {'%','u',0};
+
+    if(!This->builtin_info->idx_length || !(get_idx_flags(This) & PROPF_ENUM))
+        return S_OK;
+
+    length = This->builtin_info->idx_length(This);
+    for(i = 0; i < length; i++) {
+        sprintfW(name, formatW, i);
+        hres = find_prop_name(This, string_hash(name), name, &prop);
+        if(FAILED(hres))
+            return hres;
+    }
+
+    return S_OK;
+}
+
 static inline jsdisp_t *impl_from_IDispatchEx(IDispatchEx *iface)
 {
     return CONTAINING_RECORD(iface, jsdisp_t, IDispatchEx_iface);
@@ -740,7 +832,7 @@ static HRESULT WINAPI DispatchEx_InvokeEx(IDispatchEx *iface, DISPID id, LCID lc
     return hres;
 }
 
-static HRESULT delete_prop(dispex_prop_t *prop, BOOL *ret)
+static HRESULT delete_prop(jsdisp_t *This, dispex_prop_t *prop, BOOL *ret)
 {
     if(prop->flags & PROPF_DONTDELETE) {
         *ret = FALSE;
@@ -752,6 +844,8 @@ static HRESULT delete_prop(dispex_prop_t *prop, BOOL *ret)
     if(prop->type == PROP_JSVAL) {
         jsval_release(prop->u.val);
         prop->type = PROP_DELETED;
+    }else if(prop->type == PROP_IDX && This->builtin_info->idx_delete) {
+        return This->builtin_info->idx_delete(This, prop->u.idx);
     }
     return S_OK;
 }
@@ -776,7 +870,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByName(IDispatchEx *iface, BSTR bst
         return S_OK;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID id)
@@ -793,7 +887,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID
         return DISP_E_MEMBERNOTFOUND;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_GetMemberProperties(IDispatchEx *iface, DISPID id, DWORD grfdexFetch, DWORD *pgrfdex)
@@ -833,6 +927,10 @@ static HRESULT WINAPI DispatchEx_GetNextDispID(IDispatchEx *iface, DWORD grfdex,
         hres = fill_protrefs(This);
         if(FAILED(hres))
             return hres;
+
+        hres = fill_idx_props(This);
+        if(FAILED(hres))
+            return hres;
     }
 
     if(id+1>=0 && id+1<This->prop_cnt) {
@@ -843,6 +941,8 @@ static HRESULT WINAPI DispatchEx_GetNextDispID(IDispatchEx *iface, DWORD grfdex,
     }
 
     while(iter < This->props + This->prop_cnt) {
+        if(This->builtin_info->idx_length)
+            update_idx_prop(This, iter);
         if(iter->name && (get_flags(This, iter) & PROPF_ENUM) && iter->type!=PROP_DELETED) {
             *pid = prop_to_id(This, iter);
             return S_OK;
@@ -917,6 +1017,10 @@ HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *b
     script_addref(ctx);
     dispex->ctx = ctx;
 
+    list_add_tail(&ctx->objects, &dispex->entry);
+    if(++ctx->obj_cnt > ctx->gc_threshold)
+        ctx->gc_requested = TRUE;
+
     return S_OK;
 }
 
@@ -959,6 +1063,8 @@ void jsdisp_free(jsdisp_t *obj)
         heap_free(prop->name);
     }
     heap_free(obj->props);
+    list_remove(&obj->entry);
+    obj->ctx->obj_cnt--;
     script_release(obj->ctx);
     if(obj->prototype)
         jsdisp_release(obj->prototype);
@@ -990,6 +1096,252 @@ void jsdisp_release(jsdisp_t *jsdisp)
 
 #endif
 
+/*
+ * Cycle collector. Objects are reference counted, so anything taking part in
+ * a reference cycle (closures capturing their own scope, objects pointing to
+ * each other) would never be freed. We use trial deletion: references held
+ * by the script objects themselves are subtracted from each object's ref
+ * count; whatever is left is held from outside (the stack, host objects and
+ * so on) and is treated as a root. Objects not reachable from any root are
+ * garbage and get their links cut, which lets the ref counting free them.
+ */
+struct gc_ctx {
+    script_ctx_t *script;
+    unsigned stamp;
+    BOOL failed;
+
+    jsdisp_t **stack;
+    unsigned stack_size;
+    unsigned stack_top;
+
+    scope_chain_t **scopes;
+    unsigned scopes_size;
+    unsigned scope_cnt;
+};
+
+static LONG gc_stamp;
+
+static BOOL gc_grow(struct gc_ctx *gc, void **buf, unsigned *size, unsigned elem_size)
+{
+    unsigned new_size = *size ? *size*2 : 64;
+    void *new_buf;
+
+    new_buf = *buf ? heap_realloc(*buf, new_size*elem_size) : heap_alloc(new_size*elem_size);
+    if(!new_buf) {
+        gc->failed = TRUE;
+        return FALSE;
+    }
+
+    *buf = new_buf;
+    *size = new_size;
+    return TRUE;
+}
+
+static void gc_mark(struct gc_ctx *gc, jsdisp_t *obj)
+{
+    obj->gc_ref = -1;
+
+    if(gc->stack_top == gc->stack_size
+       && !gc_grow(gc, (void**)&gc->stack, &gc->stack_size, sizeof(*gc->stack)))
+        return;
+    gc->stack[gc->stack_top++] = obj;
+}
+
+void gc_process_linked_obj(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *link, void **unlink_ref)
+{
+    switch(op) {
+    case GC_TRAVERSE_UNLINK:
+        *unlink_ref = NULL;
+        jsdisp_release(link);
+        break;
+    case GC_TRAVERSE_SPECULATIVELY:
+        if(link->ctx == gc->script)
+            link->gc_ref--;
+        break;
+    case GC_TRAVERSE:
+        if(link->ctx == gc->script && link->gc_ref != -1)
+            gc_mark(gc, link);
+        break;
+    }
+}
+
+void gc_process_linked_val(struct gc_ctx *gc, gc_traverse_op_t op, jsval_t *link)
+{
+    IDispatch *disp;
+    jsdisp_t *jsdisp;
+
+    if(!is_object_instance(*link) || !(disp = get_object(*link)))
+        return;
+
+    if(op == GC_TRAVERSE_UNLINK) {
+        *link = jsval_undefined();
+        IDispatch_Release(disp);
+        return;
+    }
+
+    jsdisp = to_jsdisp(disp);
+    if(jsdisp)
+        gc_process_linked_obj(gc, op, jsdisp, NULL);
+}
+
+static inline jsdisp_t *scope_get_jsobj(scope_chain_t *scope)
+{
+    /* jsobj is only a reference if obj is the same object */
+    return scope->jsobj && to_disp(scope->jsobj) == scope->obj ? scope->jsobj : NULL;
+}
+
+static void gc_mark_scope(struct gc_ctx *gc, scope_chain_t *scope)
+{
+    jsdisp_t *jsobj;
+
+    for(; scope && scope->gc_ref != -1; scope = scope->next) {
+        scope->gc_ref = -1;
+        if((jsobj = scope_get_jsobj(scope)))
+            gc_process_linked_obj(gc, GC_TRAVERSE, jsobj, NULL);
+    }
+}
+
+void gc_process_scope(struct gc_ctx *gc, gc_traverse_op_t op, scope_chain_t **link)
+{
+    scope_chain_t *scope = *link;
+    jsdisp_t *jsobj;
+
+    switch(op) {
+    case GC_TRAVERSE_UNLINK:
+        *link = NULL;
+        scope_release(scope);
+        break;
+    case GC_TRAVERSE_SPECULATIVELY:
+        /* Scope chains are not tracked, so they are collected while walking them. */
+        for(; scope; scope = scope->next) {
+            if(scope->gc_stamp == gc->stamp) {
+                scope->gc_ref--;
+                break;
+            }
+
+            if(gc->scope_cnt == gc->scopes_size
+               && !gc_grow(gc, (void**)&gc->scopes, &gc->scopes_size, sizeof(*gc->scopes)))
+                break;
+            gc->scopes[gc->scope_cnt++] = scope;
+
+            scope->gc_stamp = gc->stamp;
+            scope->gc_ref = scope->ref-1;
+            if((jsobj = scope_get_jsobj(scope)))
+                gc_process_linked_obj(gc, op, jsobj, NULL);
+        }
+        break;
+    case GC_TRAVERSE:
+        gc_mark_scope(gc, scope);
+        break;
+    }
+}
+
+static void gc_traverse_obj(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *obj)
+{
+    dispex_prop_t *prop;
+
+    for(prop = obj->props; prop < obj->props+obj->prop_cnt; prop++) {
+        if(prop->type == PROP_JSVAL)
+            gc_process_linked_val(gc, op, &prop->u.val);
+    }
+
+    if(obj->prototype)
+        gc_process_linked_obj(gc, op, obj->prototype, (void**)&obj->prototype);
+
+    if(obj->builtin_info->gc_traverse)
+        obj->builtin_info->gc_traverse(gc, op, obj);
+}
+
+static void gc_drain_stack(struct gc_ctx *gc)
+{
+    while(gc->stack_top && !gc->failed)
+        gc_traverse_obj(gc, GC_TRAVERSE, gc->stack[--gc->stack_top]);
+}
+
+void gc_run(script_ctx_t *ctx)
+{
+    struct gc_ctx gc = {ctx};
+    jsdisp_t **garbage = NULL, *obj;
+    unsigned garbage_cnt = 0, i;
+
+    ctx->gc_requested = FALSE;
+    gc.stamp = InterlockedIncrement(&gc_stamp);
+
+    TRACE("(%p) %u objects\n", ctx, ctx->obj_cnt);
+
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry)
+        obj->gc_ref = obj->ref;
+
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry) {
+        gc_traverse_obj(&gc, GC_TRAVERSE_SPECULATIVELY, obj);
+        if(gc.failed)
+            goto done;
+    }
+
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry) {
+        if(obj->gc_ref < 0) {
+            ERR("%p has more references than ref count\n", obj);
+            goto done;
+        }
+    }
+
+    for(i = 0; i < gc.scope_cnt; i++) {
+        if(gc.scopes[i]->gc_ref < 0) {
+            ERR("scope %p has more references than ref count\n", gc.scopes[i]);
+            goto done;
+        }
+    }
+
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry) {
+        if(obj->gc_ref > 0) {
+            gc_mark(&gc, obj);
+            gc_drain_stack(&gc);
+        }
+    }
+
+    for(i = 0; i < gc.scope_cnt; i++) {
+        if(gc.scopes[i]->gc_ref > 0) {
+            gc_mark_scope(&gc, gc.scopes[i]);
+            gc_drain_stack(&gc);
+        }
+    }
+
+    if(gc.failed)
+        goto done;
+
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry) {
+        if(!obj->gc_ref)
+            garbage_cnt++;
+    }
+
+    TRACE("%u objects unreachable\n", garbage_cnt);
+
+    if(garbage_cnt && !(garbage = heap_alloc(garbage_cnt*sizeof(*garbage)))) {
+        garbage_cnt = 0;
+        goto done;
+    }
+
+    i = 0;
+    LIST_FOR_EACH_ENTRY(obj, &ctx->objects, jsdisp_t, entry) {
+        if(!obj->gc_ref)
+            garbage[i++] = jsdisp_addref(obj);
+    }
+
+    for(i = 0; i < garbage_cnt; i++)
+        gc_traverse_obj(&gc, GC_TRAVERSE_UNLINK, garbage[i]);
+
+done:
+    heap_free(gc.stack);
+    heap_free(gc.scopes);
+
+    ctx->gc_threshold = max(GC_MIN_THRESHOLD, (ctx->obj_cnt-garbage_cnt)*2);
+
+    /* Releasing the last object may release the context */
+    for(i = 0; i < garbage_cnt; i++)
+        jsdisp_release(garbage[i]);
+    heap_free(garbage);
+}
+
 HRESULT init_dispex_from_constr(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *builtin_info, jsdisp_t *constr)
 {
     jsdisp_t *prot = NULL;
@@ -1053,6 +1405,33 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/*
+ * Properties are never removed from the props array and a name always maps
+ * to the same slot of an object, so a lookup remembered in the cache stays
+ * valid as long as the slot still holds a live property of that name. This
+ * also protects against the cached object being freed and its memory reused.
+ */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    if(cache->obj == jsdisp) {
+        prop = get_prop(jsdisp, cache->id);
+        if(prop && !strcmpW(prop->name, name)) {
+            *id = cache->id;
+            return S_OK;
+        }
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres)) {
+        cache->obj = jsdisp;
+        cache->id = *id;
+    }
+    return hres;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
@@ -1321,9 +1700,25 @@ HRESULT jsdisp_propput_dontenum(jsdisp_t *obj, const WCHAR *name, jsval_t val)
 HRESULT jsdisp_propput_idx(jsdisp_t *obj, DWORD idx, jsval_t val)
 {
     WCHAR buf[12];
+    HRESULT hres;
 
     static const WCHAR formatW[] = {'%','d',0};
 
+    if(obj->builtin_info->idx_put) {
+        unsigned length = obj->builtin_info->idx_length(obj);
+
+        if(idx == length && obj->builtin_info->idx_insert) {
+            hres = obj->builtin_info->idx_insert(obj, idx);
+            if(FAILED(hres))
+                return hres;
+            if(hres == S_OK)
+                length++;
+        }
+
+        if(idx < length)
+            return obj->builtin_info->idx_put(obj, idx, val);
+    }
+
     sprintfW(buf, formatW, idx);
     return jsdisp_propput_name(obj, buf, val);
 }
@@ -1400,6 +1795,9 @@ HRESULT jsdisp_get_idx(jsdisp_t *obj, DWORD idx, jsval_t *r)
 
     static const WCHAR formatW[] = {'%','d',0};
 
+    if(obj->builtin_info->idx_get && idx < obj->builtin_info->idx_length(obj))
+        return obj->builtin_info->idx_get(obj, idx, r);
+
     sprintfW(name, formatW, idx);
 
     hres = find_prop_name_prot(obj, string_hash(name), name, &prop);
@@ -1470,13 +1868,51 @@ HRESULT jsdisp_delete_idx(jsdisp_t *obj, DWORD idx)
     BOOL b;
     HRESULT hres;
 
+    if(obj->builtin_info->idx_delete && idx < obj->builtin_info->idx_length(obj))
+        return obj->builtin_info->idx_delete(obj, idx);
+
     sprintfW(buf, formatW, idx);
 
     hres = find_prop_name(obj, string_hash(buf), buf, &prop);
     if(FAILED(hres) || !prop)
         return hres;
 
-    return delete_prop(prop, &b);
+    return delete_prop(obj, prop, &b);
+}
+
+/*
+ * Turns properties of indexes in [from, to) stored by the object into regular
+ * properties holding their current values, so that the object may drop them
+ * from its storage.
+ */
+HRESULT jsdisp_detach_idx(jsdisp_t *obj, DWORD from, DWORD to)
+{
+    dispex_prop_t *prop;
+    WCHAR name[12];
+    jsval_t val;
+    DWORD i;
+    HRESULT hres;
+
+    static const WCHAR formatW[] = {'%','u',0};
+
+    for(i = from; i < to; i++) {
+        sprintfW(name, formatW, i);
+
+        hres = find_prop_name(obj, string_hash(name), name, &prop);
+        if(FAILED(hres))
+            return hres;
+        assert(prop && prop->type == PROP_IDX);
+
+        hres = obj->builtin_info->idx_get(obj, i, &val);
+        if(FAILED(hres))
+            return hres;
+
+        prop->type = PROP_JSVAL;
+        prop->flags = PROPF_ENUM;
+        prop->u.val = val;
+    }
+
+    return S_OK;
 }
 
 HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
@@ -1491,7 +1927,7 @@ HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
 
         prop = get_prop(jsdisp, id);
         if(prop)
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         else
             hres = DISP_E_MEMBERNOTFOUND;
 
@@ -1534,7 +1970,7 @@ HRESULT disp_delete_name(script_ctx_t *ctx, IDispatch *disp, jsstr_t *name, BOOL
 
         hres = find_prop_name(jsdisp, string_hash(ptr), ptr, &prop);
         if(prop) {
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         }else {
             *ret = TRUE;
             hres = S_OK;
@@ -1582,7 +2018,7 @@ HRESULT jsdisp_is_own_prop(jsdisp_t *obj, const WCHAR *name, BOOL *ret)
     if(FAILED(hres))
         return hres;
 
-    *ret = prop && (prop->type == PROP_JSVAL || prop->type == PROP_BUILTIN);
+    *ret = prop && (prop->type == PROP_JSVAL || prop->type == PROP_BUILTIN || prop->type == PROP_IDX);
     return S_OK;
 }
 
@@ -236,6 +236,7 @@ HRESULT scope_push(scope_chain_t *scope, jsdisp_t *jsobj, IDispatch *obj, scope_
         return E_OUTOFMEMORY;
 
     new_scope->ref = 1;
+    new_scope->gc_stamp = 0;
 
     IDispatch_AddRef(obj);
     new_scope->jsobj = jsobj;
@@ -383,6 +384,24 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
     return hres;
 }
 
+static inline prop_cache_t *get_prop_cache(exec_ctx_t *ctx)
+{
+    return ctx->code->prop_caches + ctx->ip;
+}
+
+/* Like disp_get_id, but remembers the result for script objects. */
+static HRESULT disp_get_id_cached(exec_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr,
+        DWORD flags, DISPID *id)
+{
+    jsdisp_t *jsdisp;
+
+    jsdisp = to_jsdisp(disp);
+    if(jsdisp)
+        return jsdisp_get_id_cached(jsdisp, name, flags, get_prop_cache(ctx), id);
+
+    return disp_get_id(ctx->script, disp, name, name_bstr, flags, id);
+}
+
 static inline BOOL var_is_null(const VARIANT *v)
 {
     return V_VT(v) == VT_NULL || (V_VT(v) == VT_DISPATCH && !V_DISPATCH(v));
@@ -494,6 +513,8 @@ static BOOL lookup_global_members(script_ctx_t *ctx, BSTR identifier, exprval_t
 /* ECMA-262 3rd Edition    10.1.4 */
 static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
 {
+    exec_ctx_t *exec_ctx = ctx->exec_ctx;
+    prop_cache_t *cache;
     scope_chain_t *scope;
     named_item_t *item;
     DISPID id = 0;
@@ -501,9 +522,11 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
 
     TRACE("%s\n", debugstr_w(identifier));
 
-    for(scope = ctx->exec_ctx->scope_chain; scope; scope = scope->next) {
+    cache = get_prop_cache(exec_ctx);
+
+    for(scope = exec_ctx->scope_chain; scope; scope = scope->next) {
         if(scope->jsobj)
-            hres = jsdisp_get_id(scope->jsobj, identifier, fdexNameImplicit, &id);
+            hres = jsdisp_get_id_cached(scope->jsobj, identifier, fdexNameImplicit, cache, &id);
         else
             hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, &id);
         if(SUCCEEDED(hres)) {
@@ -512,7 +535,7 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_idref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -834,6 +857,7 @@ static HRESULT interp_array(exec_ctx_t *ctx)
     const WCHAR *name;
     jsval_t v, namev;
     IDispatch *obj;
+    jsdisp_t *jsdisp;
     DISPID id;
     HRESULT hres;
 
@@ -847,6 +871,21 @@ static HRESULT interp_array(exec_ctx_t *ctx)
         return hres;
     }
 
+    /* Look up integer subscripts of script objects without converting them to names */
+    if(is_number(namev) && is_int32(get_number(namev)) && get_number(namev) >= 0
+       && (jsdisp = to_jsdisp(obj))) {
+        hres = jsdisp_get_idx(jsdisp, get_number(namev), &v);
+        IDispatch_Release(obj);
+        if(hres == DISP_E_UNKNOWNNAME) {
+            v = jsval_undefined();
+            hres = S_OK;
+        }
+        if(FAILED(hres))
+            return hres;
+
+        return stack_push(ctx, v);
+    }
+
     hres = to_flat_string(ctx->script, namev, &name_str, &name);
     jsval_release(namev);
     if(FAILED(hres)) {
@@ -884,7 +923,7 @@ static HRESULT interp_member(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx->script, obj, arg, arg, 0, &id);
+    hres = disp_get_id_cached(ctx, obj, arg, arg, 0, &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx->script, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -925,7 +964,7 @@ static HRESULT interp_memberid(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx->script, obj, name, NULL, arg, &id);
+    hres = disp_get_id_cached(ctx, obj, name, NULL, arg, &id);
     jsstr_release(name_str);
     if(FAILED(hres)) {
         IDispatch_Release(obj);
@@ -1175,7 +1214,7 @@ static HRESULT interp_carray(exec_ctx_t *ctx)
 {
     const unsigned arg = get_op_uint(ctx, 0);
     jsdisp_t *array;
-    jsval_t val;
+    jsval_t *argv;
     unsigned i;
     HRESULT hres;
 
@@ -1185,17 +1224,17 @@ static HRESULT interp_carray(exec_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    i = arg;
-    while(i--) {
-        val = stack_pop(ctx);
-        hres = jsdisp_propput_idx(array, i, val);
-        jsval_release(val);
+    /* Store the elements in order, so that they are kept in the dense array storage */
+    argv = stack_args(ctx, arg);
+    for(i=0; i < arg; i++) {
+        hres = jsdisp_propput_idx(array, i, argv[i]);
         if(FAILED(hres)) {
             jsdisp_release(array);
             return hres;
         }
     }
 
+    stack_popn(ctx, arg);
     return stack_push(ctx, jsval_obj(array));
 }
 
@@ -2458,6 +2497,9 @@ static HRESULT enter_bytecode(script_ctx_t *ctx, bytecode_t *code, function_code
     exec_ctx->func_code = func;
 
     while(exec_ctx->ip != -1) {
+        if(ctx->gc_requested)
+            gc_run(ctx);
+
         op = code->instrs[exec_ctx->ip].op;
         hres = op_funcs[op](exec_ctx);
         if(FAILED(hres)) {
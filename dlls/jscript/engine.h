@@ -180,6 +180,9 @@ typedef struct _bytecode_t {
     unsigned str_pool_size;
     unsigned str_cnt;
 
+    /* Property lookup caches, one for each instruction */
+    prop_cache_t *prop_caches;
+
     struct _bytecode_t *next;
 } bytecode_t;
 
@@ -211,10 +214,14 @@ typedef struct _scope_chain_t {
     jsdisp_t *jsobj;
     IDispatch *obj;
     struct _scope_chain_t *next;
+
+    LONG gc_ref;
+    unsigned gc_stamp;
 } scope_chain_t;
 
 HRESULT scope_push(scope_chain_t*,jsdisp_t*,IDispatch*,scope_chain_t**) DECLSPEC_HIDDEN;
 void scope_release(scope_chain_t*) DECLSPEC_HIDDEN;
+void gc_process_scope(struct gc_ctx*,gc_traverse_op_t,scope_chain_t**) DECLSPEC_HIDDEN;
 
 static inline void scope_addref(scope_chain_t *scope)
 {
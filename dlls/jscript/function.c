@@ -87,11 +87,23 @@ static void Arguments_destructor(jsdisp_t *jsdisp)
 {
     ArgumentsInstance *arguments = (ArgumentsInstance*)jsdisp;
 
-    jsdisp_release(&arguments->function->dispex);
-    jsdisp_release(arguments->var_obj);
+    if(arguments->function)
+        jsdisp_release(&arguments->function->dispex);
+    if(arguments->var_obj)
+        jsdisp_release(arguments->var_obj);
     heap_free(arguments);
 }
 
+static void Arguments_gc_traverse(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *jsdisp)
+{
+    ArgumentsInstance *arguments = (ArgumentsInstance*)jsdisp;
+
+    if(arguments->function)
+        gc_process_linked_obj(gc, op, &arguments->function->dispex, (void**)&arguments->function);
+    if(arguments->var_obj)
+        gc_process_linked_obj(gc, op, arguments->var_obj, (void**)&arguments->var_obj);
+}
+
 static unsigned Arguments_idx_length(jsdisp_t *jsdisp)
 {
     ArgumentsInstance *arguments = (ArgumentsInstance*)jsdisp;
@@ -126,7 +138,8 @@ static const builtin_info_t Arguments_info = {
     NULL,
     Arguments_idx_length,
     Arguments_idx_get,
-    Arguments_idx_put
+    Arguments_idx_put,
+    Arguments_gc_traverse
 };
 
 static HRESULT create_arguments(script_ctx_t *ctx, FunctionInstance *calee, jsdisp_t *var_obj,
@@ -595,6 +608,14 @@ static void Function_destructor(jsdisp_t *dispex)
     heap_free(This);
 }
 
+static void Function_gc_traverse(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *dispex)
+{
+    FunctionInstance *This = (FunctionInstance*)dispex;
+
+    if(This->scope_chain)
+        gc_process_scope(gc, op, &This->scope_chain);
+}
+
 static const builtin_prop_t Function_props[] = {
     {applyW,                 Function_apply,                 PROPF_METHOD|2},
     {argumentsW,             Function_arguments,             0},
@@ -609,7 +630,11 @@ static const builtin_info_t Function_info = {
     sizeof(Function_props)/sizeof(*Function_props),
     Function_props,
     Function_destructor,
-    NULL
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Function_gc_traverse
 };
 
 static const builtin_prop_t FunctionInst_props[] = {
@@ -623,7 +648,11 @@ static const builtin_info_t FunctionInst_info = {
     sizeof(FunctionInst_props)/sizeof(*FunctionInst_props),
     FunctionInst_props,
     Function_destructor,
-    NULL
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Function_gc_traverse
 };
 
 static HRESULT create_function(script_ctx_t *ctx, const builtin_info_t *builtin_info, DWORD flags,
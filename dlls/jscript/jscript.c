@@ -69,6 +69,7 @@ void script_release(script_ctx_t *ctx)
         return;
 
     clear_ei(ctx);
+    release_regexp_cache(ctx);
     if(ctx->cc)
         release_cc(ctx->cc);
     heap_pool_free(&ctx->tmp_heap);
@@ -217,6 +218,9 @@ static void decrease_state(JScript *This, SCRIPTSTATE state)
                 jsdisp_release(This->ctx->global);
                 This->ctx->global = NULL;
             }
+
+            /* Collect reference cycles that would otherwise keep objects alive */
+            gc_run(This->ctx);
             /* FALLTHROUGH */
         case SCRIPTSTATE_UNINITIALIZED:
             change_state(This, state);
@@ -718,6 +722,8 @@ static HRESULT WINAPI JScriptParse_InitNew(IActiveScriptParse *iface)
     ctx->version = This->version;
     ctx->ei.val = jsval_undefined();
     heap_pool_init(&ctx->tmp_heap);
+    list_init(&ctx->objects);
+    ctx->gc_threshold = GC_MIN_THRESHOLD;
 
     hres = create_jscaller(ctx);
     if(FAILED(hres)) {
@@ -188,6 +188,14 @@ static inline jsdisp_t *get_jsdisp(vdisp_t *vdisp)
 
 typedef HRESULT (*builtin_invoke_t)(script_ctx_t*,vdisp_t*,WORD,unsigned,jsval_t*,jsval_t*);
 
+typedef enum {
+    GC_TRAVERSE_UNLINK,
+    GC_TRAVERSE_SPECULATIVELY,
+    GC_TRAVERSE
+} gc_traverse_op_t;
+
+struct gc_ctx;
+
 typedef struct {
     const WCHAR *name;
     builtin_invoke_t invoke;
@@ -204,12 +212,17 @@ typedef struct {
     unsigned (*idx_length)(jsdisp_t*);
     HRESULT (*idx_get)(jsdisp_t*,unsigned,jsval_t*);
     HRESULT (*idx_put)(jsdisp_t*,unsigned,jsval_t);
+    void (*gc_traverse)(struct gc_ctx*,gc_traverse_op_t,jsdisp_t*);
+    HRESULT (*idx_insert)(jsdisp_t*,unsigned);
+    HRESULT (*idx_delete)(jsdisp_t*,unsigned);
 } builtin_info_t;
 
 struct jsdisp_t {
     IDispatchEx IDispatchEx_iface;
 
     LONG ref;
+    LONG gc_ref;
+    struct list entry;
 
     DWORD buf_size;
     DWORD prop_cnt;
@@ -230,6 +243,10 @@ jsdisp_t *as_jsdisp(IDispatch*) DECLSPEC_HIDDEN;
 jsdisp_t *to_jsdisp(IDispatch*) DECLSPEC_HIDDEN;
 void jsdisp_free(jsdisp_t*) DECLSPEC_HIDDEN;
 
+void gc_process_linked_obj(struct gc_ctx*,gc_traverse_op_t,jsdisp_t*,void**) DECLSPEC_HIDDEN;
+void gc_process_linked_val(struct gc_ctx*,gc_traverse_op_t,jsval_t*) DECLSPEC_HIDDEN;
+void gc_run(script_ctx_t*) DECLSPEC_HIDDEN;
+
 #ifndef TRACE_REFCNT
 
 /*
@@ -257,6 +274,12 @@ void jsdisp_release(jsdisp_t*) DECLSPEC_HIDDEN;
 
 #endif
 
+/* Result of an earlier property lookup, see jsdisp_get_id_cached. */
+typedef struct {
+    jsdisp_t *obj;
+    DISPID id;
+} prop_cache_t;
+
 HRESULT create_dispex(script_ctx_t*,const builtin_info_t*,jsdisp_t*,jsdisp_t**) DECLSPEC_HIDDEN;
 HRESULT init_dispex(jsdisp_t*,script_ctx_t*,const builtin_info_t*,jsdisp_t*) DECLSPEC_HIDDEN;
 HRESULT init_dispex_from_constr(jsdisp_t*,script_ctx_t*,const builtin_info_t*,jsdisp_t*) DECLSPEC_HIDDEN;
@@ -277,9 +300,11 @@ HRESULT jsdisp_propput_idx(jsdisp_t*,DWORD,jsval_t) DECLSPEC_HIDDEN;
 HRESULT jsdisp_propget_name(jsdisp_t*,LPCWSTR,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_idx(jsdisp_t*,DWORD,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_id(jsdisp_t*,const WCHAR*,DWORD,DISPID*) DECLSPEC_HIDDEN;
+HRESULT jsdisp_get_id_cached(jsdisp_t*,const WCHAR*,DWORD,prop_cache_t*,DISPID*) DECLSPEC_HIDDEN;
 HRESULT disp_delete(IDispatch*,DISPID,BOOL*) DECLSPEC_HIDDEN;
 HRESULT disp_delete_name(script_ctx_t*,IDispatch*,jsstr_t*,BOOL*);
 HRESULT jsdisp_delete_idx(jsdisp_t*,DWORD) DECLSPEC_HIDDEN;
+HRESULT jsdisp_detach_idx(jsdisp_t*,DWORD,DWORD) DECLSPEC_HIDDEN;
 HRESULT jsdisp_is_own_prop(jsdisp_t*,const WCHAR*,BOOL*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_is_enumerable(jsdisp_t*,const WCHAR*,BOOL*) DECLSPEC_HIDDEN;
 
@@ -367,6 +392,14 @@ typedef struct {
     unsigned length;
 } match_result_t;
 
+/* Number of live objects that triggers the first cycle collection */
+#define GC_MIN_THRESHOLD 4096
+
+/* Number of most recently compiled regular expressions kept per context */
+#define REGEXP_CACHE_SIZE 16
+
+struct compiled_regexp_t;
+
 struct _script_ctx_t {
     LONG ref;
 
@@ -386,8 +419,15 @@ struct _script_ctx_t {
 
     heap_pool_t tmp_heap;
 
+    struct list objects;
+    unsigned obj_cnt;
+    unsigned gc_threshold;
+    BOOL gc_requested;
+
     IDispatch *host_global;
 
+    struct compiled_regexp_t *regexp_cache[REGEXP_CACHE_SIZE];
+
     jsstr_t *last_match;
     match_result_t match_parens[9];
     DWORD last_match_index;
@@ -449,6 +489,7 @@ struct match_state_t;
 HRESULT regexp_match_next(script_ctx_t*,jsdisp_t*,DWORD,jsstr_t*,struct match_state_t**) DECLSPEC_HIDDEN;
 HRESULT parse_regexp_flags(const WCHAR*,DWORD,DWORD*) DECLSPEC_HIDDEN;
 HRESULT regexp_string_match(script_ctx_t*,jsdisp_t*,jsstr_t*,jsval_t*) DECLSPEC_HIDDEN;
+void release_regexp_cache(script_ctx_t*) DECLSPEC_HIDDEN;
 
 static inline BOOL is_class(jsdisp_t *jsdisp, jsclass_t class)
 {
@@ -25,9 +25,16 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(jscript);
 
+typedef struct compiled_regexp_t {
+    LONG ref;
+    jsstr_t *src;
+    regexp_t *regexp;
+} compiled_regexp_t;
+
 typedef struct {
     jsdisp_t dispex;
 
+    compiled_regexp_t *compiled;
     regexp_t *jsregexp;
     jsstr_t *str;
     INT last_index;
@@ -580,17 +587,83 @@ static HRESULT RegExp_value(script_ctx_t *ctx, vdisp_t *jsthis, WORD flags, unsi
     return S_OK;
 }
 
+static void release_compiled_regexp(compiled_regexp_t *compiled)
+{
+    if(--compiled->ref)
+        return;
+
+    regexp_destroy(compiled->regexp);
+    jsstr_release(compiled->src);
+    heap_free(compiled);
+}
+
+/* Returns compiled regexp for given source and flags, reusing recently compiled ones. */
+static compiled_regexp_t *compile_regexp(script_ctx_t *ctx, jsstr_t *src, const WCHAR *str, WORD flags)
+{
+    compiled_regexp_t *compiled;
+    DWORD len = jsstr_length(src);
+    unsigned i;
+
+    for(i = 0; i < REGEXP_CACHE_SIZE && ctx->regexp_cache[i]; i++) {
+        compiled = ctx->regexp_cache[i];
+        if(compiled->regexp->flags == flags && compiled->regexp->source_len == len
+           && !memcmp(compiled->regexp->source, str, len*sizeof(WCHAR))) {
+            memmove(ctx->regexp_cache+1, ctx->regexp_cache, i*sizeof(*ctx->regexp_cache));
+            ctx->regexp_cache[0] = compiled;
+            compiled->ref++;
+            return compiled;
+        }
+    }
+
+    compiled = heap_alloc(sizeof(*compiled));
+    if(!compiled)
+        return NULL;
+
+    compiled->regexp = regexp_new(ctx, &ctx->tmp_heap, str, len, flags, FALSE);
+    if(!compiled->regexp) {
+        heap_free(compiled);
+        return NULL;
+    }
+
+    /* Bytecode refers to the source string, so the cache entry keeps it alive. */
+    compiled->src = jsstr_addref(src);
+    compiled->ref = 2;
+
+    if(ctx->regexp_cache[REGEXP_CACHE_SIZE-1])
+        release_compiled_regexp(ctx->regexp_cache[REGEXP_CACHE_SIZE-1]);
+    memmove(ctx->regexp_cache+1, ctx->regexp_cache, (REGEXP_CACHE_SIZE-1)*sizeof(*ctx->regexp_cache));
+    ctx->regexp_cache[0] = compiled;
+    return compiled;
+}
+
+void release_regexp_cache(script_ctx_t *ctx)
+{
+    unsigned i;
+
+    for(i = 0; i < REGEXP_CACHE_SIZE && ctx->regexp_cache[i]; i++) {
+        release_compiled_regexp(ctx->regexp_cache[i]);
+        ctx->regexp_cache[i] = NULL;
+    }
+}
+
 static void RegExp_destructor(jsdisp_t *dispex)
 {
     RegExpInstance *This = (RegExpInstance*)dispex;
 
-    if(This->jsregexp)
-        regexp_destroy(This->jsregexp);
+    if(This->compiled)
+        release_compiled_regexp(This->compiled);
     jsval_release(This->last_index_val);
     jsstr_release(This->str);
     heap_free(This);
 }
 
+static void RegExp_gc_traverse(struct gc_ctx *gc, gc_traverse_op_t op, jsdisp_t *dispex)
+{
+    RegExpInstance *This = (RegExpInstance*)dispex;
+
+    gc_process_linked_val(gc, op, &This->last_index_val);
+}
+
 static const builtin_prop_t RegExp_props[] = {
     {execW,                  RegExp_exec,                  PROPF_METHOD|1},
     {globalW,                RegExp_global,                0},
@@ -608,7 +681,11 @@ static const builtin_info_t RegExp_info = {
     sizeof(RegExp_props)/sizeof(*RegExp_props),
     RegExp_props,
     RegExp_destructor,
-    NULL
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    RegExp_gc_traverse
 };
 
 static const builtin_prop_t RegExpInst_props[] = {
@@ -625,7 +702,11 @@ static const builtin_info_t RegExpInst_info = {
     sizeof(RegExpInst_props)/sizeof(*RegExpInst_props),
     RegExpInst_props,
     RegExp_destructor,
-    NULL
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    RegExp_gc_traverse
 };
 
 static HRESULT alloc_regexp(script_ctx_t *ctx, jsdisp_t *object_prototype, RegExpInstance **ret)
@@ -670,12 +751,13 @@ HRESULT create_regexp(script_ctx_t *ctx, jsstr_t *src, DWORD flags, jsdisp_t **r
     regexp->str = jsstr_addref(src);
     regexp->last_index_val = jsval_number(0);
 
-    regexp->jsregexp = regexp_new(ctx, &ctx->tmp_heap, str, jsstr_length(regexp->str), flags, FALSE);
-    if(!regexp->jsregexp) {
+    regexp->compiled = compile_regexp(ctx, src, str, flags);
+    if(!regexp->compiled) {
         WARN("regexp_new failed\n");
         jsdisp_release(&regexp->dispex);
         return E_FAIL;
     }
+    regexp->jsregexp = regexp->compiled->regexp;
 
     *ret = &regexp->dispex;
     return S_OK;
@@ -1039,6 +1039,49 @@ tmp = arr.shift();
 ok(tmp === undefined, "[].shift() = " + tmp);
 ok(arr.toString() === "", "arr = " + arr.toString());
 
+arr = [];
+for(i = 0; i < 10; i++)
+    arr[i] = i;
+ok(arr.length === 10, "arr.length = " + arr.length);
+delete arr[9];
+ok(arr.length === 10, "arr.length = " + arr.length);
+ok(!("9" in arr), "arr[9] not deleted");
+delete arr[3];
+ok(!(3 in arr), "arr[3] not deleted");
+ok(arr[4] === 4, "arr[4] = " + arr[4]);
+ok(arr.toString() === "0,1,2,,4,5,6,7,8,", "arr = " + arr.toString());
+ok(arr.hasOwnProperty("2"), "arr.hasOwnProperty('2') is false");
+ok(!arr.hasOwnProperty("3"), "arr.hasOwnProperty('3') is true");
+arr[3] = 3;
+arr[9] = 9;
+ok(arr.toString() === "0,1,2,3,4,5,6,7,8,9", "arr = " + arr.toString());
+arr.length = 4;
+ok(arr.toString() === "0,1,2,3", "arr = " + arr.toString());
+ok(!(5 in arr), "arr[5] not deleted");
+arr[5] = 5;
+ok(arr.length === 6, "arr.length = " + arr.length);
+ok(arr.toString() === "0,1,2,3,,5", "arr = " + arr.toString());
+arr["01"] = "x";
+ok(arr[1] === 1, "arr[1] = " + arr[1]);
+ok(arr.length === 6, "arr.length = " + arr.length);
+
+tmp = "";
+for(i in [1,2,3])
+    tmp += i;
+ok(tmp === "012", "for in array returned " + tmp);
+
+Array.prototype[1] = "proto";
+arr = [0];
+ok(arr[1] === "proto", "arr[1] = " + arr[1]);
+ok(arr["1"] === "proto", "arr['1'] = " + arr["1"]);
+arr.push(1);
+ok(arr[1] === 1, "arr[1] = " + arr[1]);
+ok(arr["1"] === 1, "arr['1'] = " + arr["1"]);
+tmp = arr.pop();
+ok(tmp === 1, "arr.pop() = " + tmp);
+ok(arr["1"] === "proto", "arr['1'] = " + arr["1"]);
+delete Array.prototype[1];
+
 arr = [1,2,,4];
 tmp = arr.shift(2);
 ok(tmp === 1, "[1,2,,4].shift(2) = " + tmp);
@@ -1449,6 +1449,28 @@ ok(NaN === 6, "NaN !== 6");
 Infinity = 6;
 ok(Infinity === 6, "Infinity !== 6");
 
+function getX(o) { return o.x; }
+
+(function() {
+    function C() {}
+    var proto = {x: 1}, o1, o2 = {x: 2}, i;
+
+    C.prototype = proto;
+    o1 = new C();
+
+    for(i = 0; i < 2; i++) {
+        ok(getX(o1) === 1, "getX(o1) = " + getX(o1));
+        ok(getX(o2) === 2, "getX(o2) = " + getX(o2));
+    }
+    o1.x = 3;
+    ok(getX(o1) === 3, "getX(o1) = " + getX(o1) + " expected 3");
+    delete o1.x;
+    ok(getX(o1) === 1, "getX(o1) = " + getX(o1) + " expected 1");
+    proto.x = 4;
+    ok(getX(o1) === 4, "getX(o1) = " + getX(o1) + " expected 4");
+    ok(getX({y: 1, x: 5}) === 5, "getX({y: 1, x: 5}) !== 5");
+})();
+
 Math = 6;
 ok(Math === 6, "NaN !== 6");
 
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+/* Array element access and array method heavy loops. */
+
+function testFill(n) {
+    var arr = [], sum = 0, i;
+
+    for(i = 0; i < n; i++)
+        arr[i] = i;
+    for(i = 0; i < n; i++)
+        sum += arr[i];
+
+    return sum;
+}
+
+function testPushPop(n) {
+    var arr = [], sum = 0, i;
+
+    for(i = 0; i < n; i++)
+        arr.push(i, i+1);
+    while(arr.length)
+        sum += arr.pop();
+
+    return sum;
+}
+
+function testSieve(n) {
+    var sieve = new Array(), cnt = 0, i, j;
+
+    for(i = 0; i <= n; i++)
+        sieve.push(true);
+
+    for(i = 2; i <= n; i++) {
+        if(!sieve[i])
+            continue;
+        cnt++;
+        for(j = i*2; j <= n; j += i)
+            sieve[j] = false;
+    }
+
+    return cnt;
+}
+
+function testSortJoin(n) {
+    var arr = [], i;
+
+    for(i = 0; i < n; i++)
+        arr.push((i * 7919) % n);
+    arr.sort(function(a, b) { return a - b; });
+
+    return arr.slice(0, 5).concat(arr.slice(n-5)).join(",");
+}
+
+function testQueue(n) {
+    var queue = [0], sum = 0, v;
+
+    while(queue.length) {
+        v = queue.shift();
+        sum += v;
+        if(v < n)
+            queue.push(v+1);
+    }
+
+    return sum;
+}
+
+if(testFill(100000) !== 4999950000)
+    throw "testFill failed";
+if(testPushPop(50000) !== 2500000000)
+    throw "testPushPop failed";
+if(testSieve(100000) !== 9592)
+    throw "testSieve failed";
+if(testSortJoin(20000) !== "0,1,2,3,4,19995,19996,19997,19998,19999")
+    throw "testSortJoin failed";
+if(testQueue(5000) !== 12502500)
+    throw "testQueue failed";
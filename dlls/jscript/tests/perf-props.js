@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Property access, method call and closure heavy loops. */
+
+function Point(x, y) {
+    this.x = x;
+    this.y = y;
+}
+
+Point.prototype.add = function(p) {
+    return new Point(this.x + p.x, this.y + p.y);
+};
+
+Point.prototype.length2 = function() {
+    return this.x*this.x + this.y*this.y;
+};
+
+function testProps(n) {
+    var obj = {a: 1, b: 2, c: 3}, sum = 0, i;
+
+    for(i = 0; i < n; i++) {
+        sum += obj.a + obj.b + obj.c;
+        obj.a = obj.b;
+        obj.b = obj.c;
+        obj.c = i;
+    }
+
+    return sum;
+}
+
+function testMethods(n) {
+    var p = new Point(0, 0), d = new Point(1, 2), i;
+
+    for(i = 0; i < n; i++)
+        p = p.add(d);
+
+    return p.length2();
+}
+
+function makeCounter() {
+    var count = 0;
+    return function() { return ++count; };
+}
+
+function testClosures(n) {
+    var counter = makeCounter(), i, r = 0;
+
+    for(i = 0; i < n; i++)
+        r = counter();
+
+    return r;
+}
+
+var globalSum = 0;
+
+function testGlobals(n) {
+    var i;
+
+    for(i = 0; i < n; i++)
+        globalSum += i;
+
+    return globalSum;
+}
+
+if(testProps(100000) !== 14999250024)
+    throw "testProps failed";
+if(testMethods(100000) !== 100000*100000*5)
+    throw "testMethods failed";
+if(testClosures(100000) !== 100000)
+    throw "testClosures failed";
+if(testGlobals(100000) !== 100000*99999/2)
+    throw "testGlobals failed";
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026 Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+/* Regular expression searches over a larger text. */
+
+var words = ["alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"];
+
+function makeText(n) {
+    var parts = [], i;
+
+    for(i = 0; i < n; i++)
+        parts.push(words[i % 8] + (i % 7 ? " " : " id" + i + ";"));
+
+    return parts.join("");
+}
+
+var text = makeText(20000);
+
+function testLiteralPrefix() {
+    return text.match(/id\d+;/g).length;
+}
+
+function testClass() {
+    return text.match(/[xyz]/g).length;
+}
+
+function testSplit() {
+    return text.split(/;/).length;
+}
+
+function testReplace() {
+    return text.replace(/eta/g, "ETA").split("ETA").length - 1;
+}
+
+function testConstruct(n) {
+    var i, r = 0;
+
+    for(i = 0; i < n; i++) {
+        if(new RegExp("ga+mma").test(words[i % 8]))
+            r++;
+    }
+
+    return r;
+}
+
+if(testLiteralPrefix() !== 2858)
+    throw "testLiteralPrefix failed";
+if(testClass() !== 2500)
+    throw "testClass failed";
+if(testSplit() !== 2859)
+    throw "testSplit failed";
+if(testReplace() !== 10000)
+    throw "testReplace failed";
+if(testConstruct(20000) !== 2500)
+    throw "testConstruct failed";
@@ -660,4 +660,25 @@ tmp = new RegExp("abc/", "mgi");
 ok(tmp.toString() === "/abc//igm", "(new RegExp(\"abc/\")).toString() = " + tmp.toString());
 ok(/abc/.toString(1, false, "3") === "/abc/", "/abc/.toString(1, false, \"3\") = " + /abc/.toString());
 
+
+ok("abcabd".search(/abd/) === 3, "\"abcabd\".search(/abd/) = " + "abcabd".search(/abd/));
+ok("abab".search(/b/) === 1, "\"abab\".search(/b/) = " + "abab".search(/b/));
+ok("aaa".search(/b/) === -1, "\"aaa\".search(/b/) = " + "aaa".search(/b/));
+ok("x\u1234y".search(/\u1234/) === 1, "\"x\\u1234y\".search(/\\u1234/) = " + "x\u1234y".search(/\u1234/));
+ok("xyza".search(/[ab]/) === 3, "\"xyza\".search(/[ab]/) = " + "xyza".search(/[ab]/));
+ok("xyz".search(/[ab]/) === -1, "\"xyz\".search(/[ab]/) = " + "xyz".search(/[ab]/));
+ok("a1b2".replace(/[0-9]/g, "#") === "a#b#", "\"a1b2\".replace(/[0-9]/g, \"#\") = " + "a1b2".replace(/[0-9]/g, "#"));
+
+re = new RegExp("ab", "g");
+tmp = new RegExp("ab", "g");
+m = re.exec("xxabab");
+ok(m.index === 2, "m.index = " + m.index);
+ok(re.lastIndex === 4, "re.lastIndex = " + re.lastIndex);
+m = tmp.exec("xxabab");
+ok(m.index === 2, "m.index = " + m.index);
+ok(tmp.lastIndex === 4, "tmp.lastIndex = " + tmp.lastIndex);
+ok(new RegExp("ab", "i").test("AB"), "new RegExp(\"ab\", \"i\").test(\"AB\") returned false");
+ok(!new RegExp("ab").test("AB"), "new RegExp(\"ab\").test(\"AB\") returned true");
+ok(new RegExp("ab").global === false, "new RegExp(\"ab\").global = " + new RegExp("ab").global);
+
 reportSuccess();
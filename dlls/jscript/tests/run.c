@@ -134,6 +134,8 @@ DEFINE_EXPECT(DeleteMemberByDispID_false);
 #define DISPID_GLOBAL_TESTRES       0x1018
 #define DISPID_GLOBAL_TESTNORES     0x1019
 #define DISPID_GLOBAL_DISPEXFUNC    0x101a
+#define DISPID_GLOBAL_GCOBJ         0x101b
+#define DISPID_GLOBAL_GCOBJREF      0x101c
 
 #define DISPID_GLOBAL_TESTPROPDELETE    0x2000
 #define DISPID_GLOBAL_TESTNOPROPDELETE  0x2001
@@ -566,6 +568,55 @@ static IDispatchExVtbl pureDispVtbl = {
 
 static IDispatchEx pureDisp = { &pureDispVtbl };
 
+static LONG gc_obj_ref;
+
+static HRESULT WINAPI gcObj_QueryInterface(IDispatchEx *iface, REFIID riid, void **ppv)
+{
+    HRESULT hres;
+
+    hres = DispatchEx_QueryInterface(iface, riid, ppv);
+    if(SUCCEEDED(hres))
+        IDispatchEx_AddRef(iface);
+    return hres;
+}
+
+static ULONG WINAPI gcObj_AddRef(IDispatchEx *iface)
+{
+    return InterlockedIncrement(&gc_obj_ref);
+}
+
+static ULONG WINAPI gcObj_Release(IDispatchEx *iface)
+{
+    return InterlockedDecrement(&gc_obj_ref);
+}
+
+static HRESULT WINAPI gcObj_InvokeEx(IDispatchEx *iface, DISPID id, LCID lcid, WORD wFlags, DISPPARAMS *pdp,
+        VARIANT *res, EXCEPINFO *pei, IServiceProvider *pspCaller)
+{
+    ok(0, "unexpected call %x\n", id);
+    return DISP_E_MEMBERNOTFOUND;
+}
+
+static IDispatchExVtbl gcObjVtbl = {
+    gcObj_QueryInterface,
+    gcObj_AddRef,
+    gcObj_Release,
+    DispatchEx_GetTypeInfoCount,
+    DispatchEx_GetTypeInfo,
+    DispatchEx_GetIDsOfNames,
+    DispatchEx_Invoke,
+    DispatchEx_GetDispID,
+    gcObj_InvokeEx,
+    DispatchEx_DeleteMemberByName,
+    DispatchEx_DeleteMemberByDispID,
+    DispatchEx_GetMemberProperties,
+    DispatchEx_GetMemberName,
+    DispatchEx_GetNextDispID,
+    DispatchEx_GetNameSpaceParent
+};
+
+static IDispatchEx gcObj = { &gcObjVtbl };
+
 static HRESULT WINAPI Global_GetDispID(IDispatchEx *iface, BSTR bstrName, DWORD grfdex, DISPID *pid)
 {
     if(!strcmp_wa(bstrName, "ok")) {
@@ -735,6 +786,16 @@ static HRESULT WINAPI Global_GetDispID(IDispatchEx *iface, BSTR bstrName, DWORD
         return S_OK;
     }
 
+    if(!strcmp_wa(bstrName, "gcObj")) {
+        *pid = DISPID_GLOBAL_GCOBJ;
+        return S_OK;
+    }
+
+    if(!strcmp_wa(bstrName, "gcObjRef")) {
+        *pid = DISPID_GLOBAL_GCOBJREF;
+        return S_OK;
+    }
+
     if(strict_dispid_check && strcmp_wa(bstrName, "t"))
         ok(0, "unexpected call %s\n", wine_dbgstr_w(bstrName));
     return DISP_E_UNKNOWNNAME;
@@ -921,6 +982,17 @@ static HRESULT WINAPI Global_InvokeEx(IDispatchEx *iface, DISPID id, LCID lcid,
         V_DISPATCH(pvarRes) = (IDispatch*)&dispexFunc;
         return S_OK;
 
+    case DISPID_GLOBAL_GCOBJ:
+        IDispatchEx_AddRef(&gcObj);
+        V_VT(pvarRes) = VT_DISPATCH;
+        V_DISPATCH(pvarRes) = (IDispatch*)&gcObj;
+        return S_OK;
+
+    case DISPID_GLOBAL_GCOBJREF:
+        V_VT(pvarRes) = VT_I4;
+        V_I4(pvarRes) = gc_obj_ref;
+        return S_OK;
+
     case DISPID_GLOBAL_GETNULLBSTR:
         if(pvarRes) {
             V_VT(pvarRes) = VT_BSTR;
@@ -1946,6 +2018,29 @@ static void test_script_exprs(void)
     testing_expr = FALSE;
 }
 
+static void test_gc(void)
+{
+    gc_obj_ref = 0;
+
+    parse_script_a("(function() { var o = {obj: gcObj}; o.self = o; })();");
+    ok(!gc_obj_ref, "gc_obj_ref = %d\n", gc_obj_ref);
+
+    parse_script_a("(function() { var a = [gcObj], b = {a: a}; a.push(b); })();");
+    ok(!gc_obj_ref, "gc_obj_ref = %d\n", gc_obj_ref);
+
+    /* closure referencing its own activation object */
+    parse_script_a("(function() { var o = gcObj; function f() { return o; } })();");
+    ok(!gc_obj_ref, "gc_obj_ref = %d\n", gc_obj_ref);
+
+    /* cycles are collected while the script is still running */
+    parse_script_a("for(var i = 0; i < 5000; i++) (function() { var o = gcObj; function f() { return o; } })();"
+                   "ok(gcObjRef < 5000, 'gcObjRef = ' + gcObjRef);"
+                   "var keep = (function() { var o = gcObj; function f() { return o; } return f; })();"
+                   "for(var i = 0; i < 5000; i++) (function() { var o = {obj: gcObj}; o.self = o; })();"
+                   "ok(keep() === gcObj, 'keep() !== gcObj');");
+    ok(!gc_obj_ref, "gc_obj_ref = %d\n", gc_obj_ref);
+}
+
 static BOOL run_tests(void)
 {
     HRESULT hres;
@@ -2221,6 +2316,8 @@ static BOOL run_tests(void)
         "Object expected",
         NULL);
 
+    test_gc();
+
     return TRUE;
 }
 
@@ -2366,6 +2463,9 @@ static void run_benchmarks(void)
     run_benchmark("dna.js");
     run_benchmark("base64.js");
     run_benchmark("validateinput.js");
+    run_benchmark("props.js");
+    run_benchmark("regexpperf.js");
+    run_benchmark("arrayperf.js");
 }
 
 static BOOL check_jscript(void)
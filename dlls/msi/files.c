@@ -164,12 +164,11 @@ static UINT copy_file(MSIFILE *file, LPWSTR source)
         return GetLastError();
 
     SetFileAttributesW(file->TargetPath, FILE_ATTRIBUTE_NORMAL);
-
-    file->state = msifs_installed;
     return ERROR_SUCCESS;
 }
 
-static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
+/* doesn't touch file->state, it may be called from a copy thread */
+static UINT copy_install_file(MSIFILE *file, LPWSTR source, BOOL *installed, BOOL *reboot)
 {
     UINT gle;
 
@@ -177,7 +176,10 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
 
     gle = copy_file(file, source);
     if (gle == ERROR_SUCCESS)
+    {
+        *installed = TRUE;
         return gle;
+    }
 
     if (gle == ERROR_ALREADY_EXISTS && file->state == msifs_overwrite)
     {
@@ -190,6 +192,7 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
 
         gle = copy_file(file, source);
         TRACE("Overwriting existing file: %d\n", gle);
+        if (gle == ERROR_SUCCESS) *installed = TRUE;
     }
     if (gle == ERROR_SHARING_VIOLATION || gle == ERROR_USER_MAPPED_FILE)
     {
@@ -213,8 +216,8 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
             MoveFileExW(file->TargetPath, NULL, MOVEFILE_DELAY_UNTIL_REBOOT) &&
             MoveFileExW(tmpfileW, file->TargetPath, MOVEFILE_DELAY_UNTIL_REBOOT))
         {
-            file->state = msifs_installed;
-            package->need_reboot_at_end = 1;
+            *installed = TRUE;
+            *reboot = TRUE;
             gle = ERROR_SUCCESS;
         }
         else
@@ -229,6 +232,204 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
     return gle;
 }
 
+/*
+ * Uncompressed files are copied by a small pool of worker threads so that
+ * disk I/O overlaps with the install thread working through the file list.
+ * Completed copies are collected on the install thread, which updates the
+ * file state and sends progress for them. The queue is drained before the
+ * media changes and before a cabinet is extracted.
+ */
+#define MAX_COPY_THREADS 4
+
+struct copy_job
+{
+    struct list entry;
+    MSIFILE    *file;
+    WCHAR      *source;
+    UINT        error;
+    BOOL        installed;
+    BOOL        reboot;
+};
+
+struct copy_queue
+{
+    CRITICAL_SECTION cs;
+    struct list      jobs;     /* waiting to be copied */
+    struct list      done;     /* copied, waiting to be collected */
+    UINT             pending;  /* queued but not collected yet */
+    HANDLE           sem;
+    HANDLE           done_event;
+    HANDLE           threads[MAX_COPY_THREADS];
+    UINT             thread_count;
+    BOOL             shutdown;
+    BOOL             finished;
+    UINT             error;
+};
+
+static DWORD WINAPI copy_thread( void *arg )
+{
+    struct copy_queue *queue = arg;
+    struct copy_job *job;
+    UINT r;
+
+    for (;;)
+    {
+        WaitForSingleObject( queue->sem, INFINITE );
+
+        EnterCriticalSection( &queue->cs );
+        if (list_empty( &queue->jobs ))
+        {
+            BOOL shutdown = queue->shutdown;
+            LeaveCriticalSection( &queue->cs );
+            if (shutdown) break;
+            continue;
+        }
+        job = LIST_ENTRY( list_head( &queue->jobs ), struct copy_job, entry );
+        list_remove( &job->entry );
+        /* don't start new copies once one has failed */
+        r = queue->error;
+        LeaveCriticalSection( &queue->cs );
+
+        if (r == ERROR_SUCCESS)
+        {
+            r = copy_install_file( job->file, job->source, &job->installed, &job->reboot );
+            if (r != ERROR_SUCCESS)
+                ERR("Failed to copy %s to %s (%d)\n", debugstr_w(job->source),
+                    debugstr_w(job->file->TargetPath), r);
+        }
+        job->error = r;
+
+        EnterCriticalSection( &queue->cs );
+        if (r != ERROR_SUCCESS && queue->error == ERROR_SUCCESS) queue->error = r;
+        list_add_tail( &queue->done, &job->entry );
+        LeaveCriticalSection( &queue->cs );
+        SetEvent( queue->done_event );
+    }
+    return 0;
+}
+
+static void init_copy_queue( struct copy_queue *queue )
+{
+    memset( queue, 0, sizeof(*queue) );
+    InitializeCriticalSection( &queue->cs );
+    list_init( &queue->jobs );
+    list_init( &queue->done );
+}
+
+static void copy_file_done( MSIPACKAGE *package, MSIFILE *file, BOOL installed, BOOL reboot )
+{
+    if (installed) file->state = msifs_installed;
+    if (reboot) package->need_reboot_at_end = 1;
+    msi_file_update_ui( package, file, szInstallFiles );
+}
+
+/* collects finished copies, optionally waiting for all of them, and returns the first error */
+static UINT collect_copies( MSIPACKAGE *package, struct copy_queue *queue, BOOL wait )
+{
+    struct copy_job *job, *next;
+    struct list done;
+    UINT r;
+
+    for (;;)
+    {
+        list_init( &done );
+        EnterCriticalSection( &queue->cs );
+        list_move_tail( &done, &queue->done );
+        LeaveCriticalSection( &queue->cs );
+
+        LIST_FOR_EACH_ENTRY_SAFE( job, next, &done, struct copy_job, entry )
+        {
+            if (job->error == ERROR_SUCCESS)
+                copy_file_done( package, job->file, job->installed, job->reboot );
+            list_remove( &job->entry );
+            msi_free( job->source );
+            msi_free( job );
+            queue->pending--;
+        }
+        if (!wait || !queue->pending) break;
+        WaitForSingleObject( queue->done_event, INFINITE );
+    }
+
+    EnterCriticalSection( &queue->cs );
+    r = queue->error;
+    LeaveCriticalSection( &queue->cs );
+    return r;
+}
+
+static UINT queue_copy_file( MSIPACKAGE *package, struct copy_queue *queue, MSIFILE *file, WCHAR *source )
+{
+    struct copy_job *job;
+    BOOL installed = FALSE, reboot = FALSE;
+    UINT r;
+
+    if (!queue->sem && !(queue->sem = CreateSemaphoreW( NULL, 0, MAXLONG, NULL )))
+        WARN("failed to create semaphore %u\n", GetLastError());
+    if (!queue->done_event && !(queue->done_event = CreateEventW( NULL, FALSE, FALSE, NULL )))
+        WARN("failed to create event %u\n", GetLastError());
+
+    if (queue->sem && queue->done_event && !queue->thread_count)
+    {
+        SYSTEM_INFO si;
+        UINT i, count;
+
+        GetSystemInfo( &si );
+        count = min( max( si.dwNumberOfProcessors, 2 ), MAX_COPY_THREADS );
+        for (i = 0; i < count; i++)
+        {
+            if (!(queue->threads[i] = CreateThread( NULL, 0, copy_thread, queue, 0, NULL ))) break;
+            queue->thread_count++;
+        }
+        TRACE("started %u copy threads\n", queue->thread_count);
+    }
+
+    if (queue->thread_count && (job = msi_alloc_zero( sizeof(*job) )))
+    {
+        job->file   = file;
+        job->source = source;
+
+        EnterCriticalSection( &queue->cs );
+        list_add_tail( &queue->jobs, &job->entry );
+        LeaveCriticalSection( &queue->cs );
+        queue->pending++;
+        ReleaseSemaphore( queue->sem, 1, NULL );
+        return collect_copies( package, queue, FALSE );
+    }
+
+    /* fall back to copying synchronously */
+    r = copy_install_file( file, source, &installed, &reboot );
+    if (r != ERROR_SUCCESS)
+        ERR("Failed to copy %s to %s (%d)\n", debugstr_w(source), debugstr_w(file->TargetPath), r);
+    else
+        copy_file_done( package, file, installed, reboot );
+    msi_free( source );
+    return r;
+}
+
+/* waits for all pending copies, stops the copy threads and returns the first error */
+static UINT finish_copy_queue( MSIPACKAGE *package, struct copy_queue *queue )
+{
+    UINT i;
+
+    if (queue->finished) return queue->error;
+    queue->finished = TRUE;
+
+    collect_copies( package, queue, TRUE );
+    if (queue->thread_count)
+    {
+        EnterCriticalSection( &queue->cs );
+        queue->shutdown = TRUE;
+        LeaveCriticalSection( &queue->cs );
+
+        ReleaseSemaphore( queue->sem, queue->thread_count, NULL );
+        WaitForMultipleObjects( queue->thread_count, queue->threads, TRUE, INFINITE );
+        for (i = 0; i < queue->thread_count; i++) CloseHandle( queue->threads[i] );
+    }
+    if (queue->sem) CloseHandle( queue->sem );
+    if (queue->done_event) CloseHandle( queue->done_event );
+    DeleteCriticalSection( &queue->cs );
+    return queue->error;
+}
+
 static UINT msi_create_directory( MSIPACKAGE *package, const WCHAR *dir )
 {
     MSIFOLDER *folder;
@@ -318,21 +519,33 @@ WCHAR *msi_resolve_file_source( MSIPACKAGE *package, MSIFILE *file )
  * For efficiency, this is done in two passes:
  * 1) Correct all the TargetPaths and determine what files are to be installed.
  * 2) Extract Cabinets and copy files.
+ *
+ * Uncompressed files are handed to the copy queue, which is drained before
+ * the media changes, before a cabinet is extracted and before assemblies are
+ * installed.
  */
 UINT ACTION_InstallFiles(MSIPACKAGE *package)
 {
     MSIMEDIAINFO *mi;
     MSICOMPONENT *comp;
-    UINT rc = ERROR_SUCCESS;
+    UINT rc = ERROR_SUCCESS, copy_rc;
     MSIFILE *file;
+    struct copy_queue queue;
 
     schedule_install_files(package);
     mi = msi_alloc_zero( sizeof(MSIMEDIAINFO) );
+    init_copy_queue( &queue );
 
     LIST_FOR_EACH_ENTRY( file, &package->files, MSIFILE, entry )
     {
-        msi_file_update_ui( package, file, szInstallFiles );
+        /* progress for uncompressed files is sent once they have been copied */
+        if (file->IsCompressed) msi_file_update_ui( package, file, szInstallFiles );
 
+        if (file->Sequence > mi->last_sequence && collect_copies( package, &queue, TRUE ))
+        {
+            rc = ERROR_INSTALL_FAILURE;
+            goto done;
+        }
         rc = msi_load_media_info( package, file->Sequence, mi );
         if (rc != ERROR_SUCCESS)
         {
@@ -340,7 +553,11 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             rc = ERROR_FUNCTION_FAILED;
             goto done;
         }
-        if (!file->Component->Enabled) continue;
+        if (!file->Component->Enabled)
+        {
+            if (!file->IsCompressed) msi_file_update_ui( package, file, szInstallFiles );
+            continue;
+        }
 
         if (file->state != msifs_hashmatch &&
             file->state != msifs_skipped &&
@@ -352,7 +569,10 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
         }
 
         if (file->state != msifs_missing && !mi->is_continuous && file->state != msifs_overwrite)
+        {
+            if (!file->IsCompressed) msi_file_update_ui( package, file, szInstallFiles );
             continue;
+        }
 
         if (file->Sequence > mi->last_sequence || mi->is_continuous ||
             (file->IsCompressed && !mi->is_extracted))
@@ -364,6 +584,11 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             data.cb = installfiles_cb;
             data.user = (PVOID)(UINT_PTR)mi->disk_id;
 
+            if (file->IsCompressed && collect_copies( package, &queue, TRUE ))
+            {
+                rc = ERROR_INSTALL_FAILURE;
+                goto done;
+            }
             if (file->IsCompressed &&
                 !msi_cabextract(package, mi, &data))
             {
@@ -383,16 +608,11 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             {
                 msi_create_directory(package, file->Component->Directory);
             }
-            rc = copy_install_file(package, file, source);
-            if (rc != ERROR_SUCCESS)
+            if (queue_copy_file( package, &queue, file, source ))
             {
-                ERR("Failed to copy %s to %s (%d)\n", debugstr_w(source),
-                    debugstr_w(file->TargetPath), rc);
                 rc = ERROR_INSTALL_FAILURE;
-                msi_free(source);
                 goto done;
             }
-            msi_free(source);
         }
         else if (file->state != msifs_installed && !(file->Attributes & msidbFileAttributesPatchAdded))
         {
@@ -401,6 +621,12 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             goto done;
         }
     }
+    if ((copy_rc = finish_copy_queue( package, &queue )))
+    {
+        ERR("Failed to copy files (%u)\n", copy_rc);
+        rc = ERROR_INSTALL_FAILURE;
+        goto done;
+    }
     LIST_FOR_EACH_ENTRY( comp, &package->components, MSICOMPONENT, entry )
     {
         comp->Action = msi_get_component_action( package, comp );
@@ -417,6 +643,7 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
     }
 
 done:
+    finish_copy_queue( package, &queue );
     msi_free_media_info(mi);
     return rc;
 }
@@ -431,6 +431,29 @@ static const CHAR mm_media_dat[] = "DiskId\tLastSequence\tDiskPrompt\tCabinet\tV
                                    "Media\tDiskId\n"
                                    "1\t3\t\ttest1.cab\tDISK1\t\n";
 
+static const CHAR um_file_dat[] = "File\tComponent_\tFileName\tFileSize\tVersion\tLanguage\tAttributes\tSequence\n"
+                                  "s72\ts72\tl255\ti4\tS72\tS20\tI2\ti2\n"
+                                  "File\tFile\n"
+                                  "maximus\tmaximus\tmaximus\t500\t\t\t8192\t1\n"
+                                  "gaius\tmaximus\tgaius\t500\t\t\t8192\t2\n"
+                                  "tiberius\tmaximus\ttiberius\t500\t\t\t8192\t3\n"
+                                  "claudius\tmaximus\tclaudius\t500\t\t\t8192\t4\n"
+                                  "nero\tmaximus\tnero\t500\t\t\t8192\t5\n"
+                                  "galba\tmaximus\tgalba\t500\t\t\t8192\t6\n"
+                                  "augustus\taugustus\taugustus\t500\t\t\t8192\t7\n"
+                                  "otho\taugustus\totho\t500\t\t\t8192\t8\n"
+                                  "vitellius\taugustus\tvitellius\t500\t\t\t8192\t9\n"
+                                  "vespasian\taugustus\tvespasian\t500\t\t\t8192\t10\n"
+                                  "titus\taugustus\ttitus\t500\t\t\t8192\t11\n"
+                                  "caesar\tcaesar\tcaesar\t500\t\t\t16384\t12\n"
+                                  "domitian\taugustus\tdomitian\t500\t\t\t8192\t13";
+
+static const CHAR um_media_dat[] = "DiskId\tLastSequence\tDiskPrompt\tCabinet\tVolumeLabel\tSource\n"
+                                   "i2\ti4\tL64\tS255\tS32\tS72\n"
+                                   "Media\tDiskId\n"
+                                   "1\t6\t\t\tDISK1\t\n"
+                                   "2\t13\t\ttest2.cab\tDISK2\t\n";
+
 static const CHAR ss_media_dat[] = "DiskId\tLastSequence\tDiskPrompt\tCabinet\tVolumeLabel\tSource\n"
                                    "i2\ti4\tL64\tS255\tS32\tS72\n"
                                    "Media\tDiskId\n"
@@ -1388,6 +1411,18 @@ static const msi_table mm_tables[] =
     ADD_TABLE(property),
 };
 
+static const msi_table um_tables[] =
+{
+    ADD_TABLE(cc_component),
+    ADD_TABLE(directory),
+    ADD_TABLE(cc_feature),
+    ADD_TABLE(cc_feature_comp),
+    ADD_TABLE(um_file),
+    ADD_TABLE(install_exec_seq),
+    ADD_TABLE(um_media),
+    ADD_TABLE(property),
+};
+
 static const msi_table ss_tables[] =
 {
     ADD_TABLE(cc_component),
@@ -3070,6 +3105,65 @@ error:
     DeleteFile(msifile);
 }
 
+static const char *um_files[] =
+{
+    "maximus", "gaius", "tiberius", "claudius", "nero", "galba", "augustus",
+    "otho", "vitellius", "vespasian", "titus", "domitian"
+};
+
+static void test_uncompressed_media(void)
+{
+    char path[MAX_PATH];
+    UINT r, i;
+
+    if (is_process_limited())
+    {
+        skip("process is limited\n");
+        return;
+    }
+
+    CreateDirectoryA("msitest", NULL);
+    for (i = 0; i < sizeof(um_files) / sizeof(um_files[0]); i++)
+    {
+        sprintf(path, "msitest\\%s", um_files[i]);
+        create_file(path, 500);
+    }
+    create_file("caesar", 500);
+
+    create_database(msifile, um_tables, sizeof(um_tables) / sizeof(msi_table));
+
+    MsiSetInternalUI(INSTALLUILEVEL_NONE, NULL);
+
+    create_cab_file("test2.cab", MEDIA_SIZE, "caesar\0");
+
+    r = MsiInstallProductA(msifile, NULL);
+    if (r == ERROR_INSTALL_PACKAGE_REJECTED)
+    {
+        skip("Not enough rights to perform tests\n");
+        goto error;
+    }
+    ok(r == ERROR_SUCCESS, "Expected ERROR_SUCCESS, got %u\n", r);
+    for (i = 0; i < sizeof(um_files) / sizeof(um_files[0]); i++)
+    {
+        sprintf(path, "msitest\\%s", um_files[i]);
+        ok(delete_pf(path, TRUE), "File %s not installed\n", um_files[i]);
+    }
+    ok(delete_pf("msitest\\caesar", TRUE), "File not installed\n");
+    ok(delete_pf("msitest", FALSE), "Directory not created\n");
+
+error:
+    /* Delete the files in the temp (current) folder */
+    for (i = 0; i < sizeof(um_files) / sizeof(um_files[0]); i++)
+    {
+        sprintf(path, "msitest\\%s", um_files[i]);
+        DeleteFile(path);
+    }
+    RemoveDirectory("msitest");
+    DeleteFile("caesar");
+    DeleteFile("test2.cab");
+    DeleteFile(msifile);
+}
+
 static void test_samesequence(void)
 {
     UINT r;
@@ -5695,6 +5789,7 @@ START_TEST(install)
     test_continuouscabs();
     test_caborder();
     test_mixedmedia();
+    test_uncompressed_media();
     test_samesequence();
     test_uiLevelFlags();
     test_readonlyfile();
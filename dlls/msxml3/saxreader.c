@@ -161,8 +161,25 @@ typedef struct
     BSTR qname;
     ns *ns; /* namespaces defined in this particular element */
     int ns_count;
+    int ns_size;
 } element_entry;
 
+struct name_entry
+{
+    struct list entry;
+    unsigned int hash;
+    xmlChar *prefix;
+    xmlChar *local;
+    BSTR name;
+};
+
+struct name_cache
+{
+    struct list *buckets;
+    unsigned int size;
+    unsigned int count;
+};
+
 enum saxhandler_type
 {
     SAXContentHandler = 0,
@@ -300,6 +317,12 @@ typedef struct
     int column;
     BOOL vbInterface;
     struct list elements;
+    struct list free_elements;
+    struct name_cache names;
+
+    /* conversion buffer for characters() data, reused for every call */
+    WCHAR *chars;
+    int chars_size;
 
     BSTR namespaceUri;
     int attributesSize;
@@ -437,61 +460,197 @@ static BOOL is_namespaces_enabled(const saxreader *reader)
     return (reader->version < MSXML4) || (reader->features & Namespaces);
 }
 
-static BSTR build_qname(BSTR prefix, BSTR local)
+/* Element and attribute names are interned for the duration of a parse, the same
+ * names are reported over and over again and converting them only once saves both
+ * a UTF-8 conversion and an allocation per reported name. */
+static unsigned int name_hash(const xmlChar *prefix, const xmlChar *local)
 {
-    if (prefix && *prefix)
+    unsigned int hash = 0;
+
+    if (prefix)
     {
-        BSTR qname = SysAllocStringLen(NULL, SysStringLen(prefix) + SysStringLen(local) + 1);
-        WCHAR *ptr;
+        while (*prefix) hash = hash * 31 + *prefix++;
+        hash = hash * 31 + ':';
+    }
+    while (*local) hash = hash * 31 + *local++;
+
+    return hash;
+}
+
+static BSTR build_name(const xmlChar *prefix, const xmlChar *local)
+{
+    int prefix_len = 0, local_len;
+    BSTR name;
+
+    /* prefix length includes null terminator, its place is taken by a colon */
+    if (prefix)
+        prefix_len = MultiByteToWideChar(CP_UTF8, 0, (LPCSTR)prefix, -1, NULL, 0);
+    local_len = MultiByteToWideChar(CP_UTF8, 0, (LPCSTR)local, -1, NULL, 0);
+
+    name = SysAllocStringLen(NULL, prefix_len + local_len - 1);
+    if (!name)
+        return NULL;
 
-        ptr = qname;
-        strcpyW(ptr, prefix);
-        ptr += SysStringLen(prefix);
-        *ptr++ = ':';
-        strcpyW(ptr, local);
-        return qname;
+    if (prefix)
+    {
+        MultiByteToWideChar(CP_UTF8, 0, (LPCSTR)prefix, -1, name, prefix_len);
+        name[prefix_len-1] = ':';
     }
-    else
-        return SysAllocString(local);
+    MultiByteToWideChar(CP_UTF8, 0, (LPCSTR)local, -1, name + prefix_len, local_len);
+
+    return name;
 }
 
-static element_entry* alloc_element_entry(const xmlChar *local, const xmlChar *prefix, int nb_ns,
-    const xmlChar **namespaces)
+static BOOL grow_name_cache(struct name_cache *cache)
 {
-    element_entry *ret;
-    int i;
+    struct name_entry *entry, *entry2;
+    unsigned int size, i;
+    struct list *buckets;
 
-    ret = heap_alloc(sizeof(*ret));
-    if (!ret) return ret;
+    size = cache->size ? cache->size * 2 : 64;
+    buckets = heap_alloc(size * sizeof(*buckets));
+    if (!buckets)
+        return FALSE;
 
-    ret->local  = bstr_from_xmlChar(local);
-    ret->prefix = bstr_from_xmlChar(prefix);
-    ret->qname  = build_qname(ret->prefix, ret->local);
-    ret->ns = nb_ns ? heap_alloc(nb_ns*sizeof(ns)) : NULL;
-    ret->ns_count = nb_ns;
+    for (i = 0; i < size; i++)
+        list_init(&buckets[i]);
 
-    for (i=0; i < nb_ns; i++)
+    for (i = 0; i < cache->size; i++)
     {
-        ret->ns[i].prefix = bstr_from_xmlChar(namespaces[2*i]);
-        ret->ns[i].uri = bstr_from_xmlChar(namespaces[2*i+1]);
+        LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &cache->buckets[i], struct name_entry, entry)
+        {
+            list_remove(&entry->entry);
+            list_add_tail(&buckets[entry->hash & (size-1)], &entry->entry);
+        }
     }
 
-    return ret;
+    heap_free(cache->buckets);
+    cache->buckets = buckets;
+    cache->size = size;
+    return TRUE;
 }
 
-static void free_element_entry(element_entry *element)
+/* Returns a string owned by the cache for 'prefix:local', or 'local' if there's no prefix. */
+static BSTR intern_name(struct name_cache *cache, const xmlChar *prefix, const xmlChar *local)
 {
+    struct name_entry *entry;
+    unsigned int hash;
+
+    if (!local) return NULL;
+    if (prefix && !*prefix) prefix = NULL;
+
+    hash = name_hash(prefix, local);
+
+    if (cache->size)
+    {
+        LIST_FOR_EACH_ENTRY(entry, &cache->buckets[hash & (cache->size-1)], struct name_entry, entry)
+        {
+            if (entry->hash == hash && xmlStrEqual(entry->local, local) && xmlStrEqual(entry->prefix, prefix))
+                return entry->name;
+        }
+    }
+
+    if (cache->count >= cache->size && !grow_name_cache(cache))
+        return NULL;
+
+    entry = heap_alloc(sizeof(*entry));
+    if (!entry)
+        return NULL;
+
+    entry->hash = hash;
+    entry->prefix = heap_strdupxmlChar(prefix);
+    entry->local = heap_strdupxmlChar(local);
+    entry->name = build_name(prefix, local);
+    if (!entry->local || (prefix && !entry->prefix) || !entry->name)
+    {
+        SysFreeString(entry->name);
+        heap_free(entry->local);
+        heap_free(entry->prefix);
+        heap_free(entry);
+        return NULL;
+    }
+
+    list_add_head(&cache->buckets[hash & (cache->size-1)], &entry->entry);
+    cache->count++;
+
+    return entry->name;
+}
+
+static void free_name_cache(struct name_cache *cache)
+{
+    struct name_entry *entry, *entry2;
+    unsigned int i;
+
+    for (i = 0; i < cache->size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &cache->buckets[i], struct name_entry, entry)
+        {
+            SysFreeString(entry->name);
+            heap_free(entry->local);
+            heap_free(entry->prefix);
+            heap_free(entry);
+        }
+    }
+
+    heap_free(cache->buckets);
+    cache->buckets = NULL;
+    cache->size = cache->count = 0;
+}
+
+/* Entries popped from the element stack are kept on a free list and reused. */
+static element_entry* alloc_element_entry(saxlocator *locator, const xmlChar *local, const xmlChar *prefix,
+    int nb_ns, const xmlChar **namespaces)
+{
+    struct list *head = list_head(&locator->free_elements);
+    element_entry *ret;
     int i;
 
-    for (i=0; i<element->ns_count;i++)
+    if (head)
+    {
+        ret = LIST_ENTRY(head, element_entry, entry);
+        list_remove(&ret->entry);
+    }
+    else
+    {
+        ret = heap_alloc(sizeof(*ret));
+        if (!ret) return ret;
+        ret->ns = NULL;
+        ret->ns_size = 0;
+    }
+
+    if (nb_ns > ret->ns_size)
     {
-        SysFreeString(element->ns[i].prefix);
-        SysFreeString(element->ns[i].uri);
+        heap_free(ret->ns);
+        ret->ns = heap_alloc(nb_ns*sizeof(ns));
+        ret->ns_size = ret->ns ? nb_ns : 0;
+        if (!ret->ns)
+        {
+            list_add_head(&locator->free_elements, &ret->entry);
+            return NULL;
+        }
     }
 
-    SysFreeString(element->prefix);
-    SysFreeString(element->local);
+    ret->local  = intern_name(&locator->names, NULL, local);
+    ret->prefix = intern_name(&locator->names, NULL, prefix);
+    ret->qname  = intern_name(&locator->names, prefix, local);
+    ret->ns_count = nb_ns;
 
+    for (i=0; i < nb_ns; i++)
+    {
+        ret->ns[i].prefix = intern_name(&locator->names, NULL, namespaces[2*i]);
+        ret->ns[i].uri = intern_name(&locator->names, NULL, namespaces[2*i+1]);
+    }
+
+    return ret;
+}
+
+static void free_element_entry(saxlocator *locator, element_entry *element)
+{
+    list_add_head(&locator->free_elements, &element->entry);
+}
+
+static void destroy_element_entry(element_entry *element)
+{
     heap_free(element->ns);
     heap_free(element);
 }
@@ -519,19 +678,16 @@ static BSTR find_element_uri(saxlocator *locator, const xmlChar *uri)
 
     if (!uri) return NULL;
 
-    uriW = bstr_from_xmlChar(uri);
+    /* interned, so it's enough to compare pointers */
+    uriW = intern_name(&locator->names, NULL, uri);
 
     LIST_FOR_EACH_ENTRY(element, &locator->elements, element_entry, entry)
     {
         for (i=0; i < element->ns_count; i++)
-            if (!strcmpW(uriW, element->ns[i].uri))
-            {
-                SysFreeString(uriW);
+            if (uriW && uriW == element->ns[i].uri)
                 return element->ns[i].uri;
-            }
     }
 
-    SysFreeString(uriW);
     ERR("namespace uri not found, %s\n", debugstr_a((char*)uri));
     return NULL;
 }
@@ -615,23 +771,6 @@ static BSTR bstr_from_xmlCharN(const xmlChar *buf, int len)
     return bstr;
 }
 
-static BSTR QName_from_xmlChar(const xmlChar *prefix, const xmlChar *name)
-{
-    xmlChar *qname;
-    BSTR bstr;
-
-    if(!name) return NULL;
-
-    if(!prefix || !*prefix)
-        return bstr_from_xmlChar(name);
-
-    qname = xmlBuildQName(name, prefix, NULL, 0);
-    bstr = bstr_from_xmlChar(qname);
-    xmlFree(qname);
-
-    return bstr;
-}
-
 static BSTR pooled_bstr_from_xmlChar(struct bstrpool *pool, const xmlChar *buf)
 {
     BSTR pool_entry = bstr_from_xmlChar(buf);
@@ -1308,16 +1447,28 @@ static BSTR saxreader_get_unescaped_value(const xmlChar *buf, int len)
     return bstr;
 }
 
+static void free_attribute_values(saxlocator *locator)
+{
+    int i;
+
+    /* names are interned, only values belong to the attribute */
+    for (i = 0; i < locator->nb_attributes; i++)
+        SysFreeString(locator->attributes[i].szValue);
+    locator->nb_attributes = 0;
+}
+
 static HRESULT SAXAttributes_populate(saxlocator *locator,
         int nb_namespaces, const xmlChar **xmlNamespaces,
         int nb_attributes, const xmlChar **xmlAttributes)
 {
     static const xmlChar xmlns[] = "xmlns";
-    static const WCHAR xmlnsW[] = { 'x','m','l','n','s',0 };
+    static const xmlChar emptyA[] = "";
 
     struct _attributes *attrs;
     int i;
 
+    free_attribute_values(locator);
+
     /* skip namespace definitions */
     if ((locator->saxreader->features & NamespacePrefixes) == 0)
         nb_namespaces = 0;
@@ -1332,6 +1483,7 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
             return E_OUTOFMEMORY;
         }
         locator->attributes = attrs;
+        locator->attributesSize = locator->nb_attributes*2;
     }
     else
     {
@@ -1340,13 +1492,13 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
 
     for (i = 0; i < nb_namespaces; i++)
     {
-        attrs[nb_attributes+i].szLocalname = SysAllocStringLen(NULL, 0);
+        attrs[nb_attributes+i].szLocalname = intern_name(&locator->names, NULL, emptyA);
         attrs[nb_attributes+i].szURI = locator->namespaceUri;
         attrs[nb_attributes+i].szValue = bstr_from_xmlChar(xmlNamespaces[2*i+1]);
         if(!xmlNamespaces[2*i])
-            attrs[nb_attributes+i].szQName = SysAllocString(xmlnsW);
+            attrs[nb_attributes+i].szQName = intern_name(&locator->names, NULL, xmlns);
         else
-            attrs[nb_attributes+i].szQName = QName_from_xmlChar(xmlns, xmlNamespaces[2*i]);
+            attrs[nb_attributes+i].szQName = intern_name(&locator->names, xmlns, xmlNamespaces[2*i]);
     }
 
     for (i = 0; i < nb_attributes; i++)
@@ -1354,15 +1506,14 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
         static const xmlChar xmlA[] = "xml";
 
         if (xmlStrEqual(xmlAttributes[i*5+1], xmlA))
-            attrs[i].szURI = bstr_from_xmlChar(xmlAttributes[i*5+2]);
+            attrs[i].szURI = intern_name(&locator->names, NULL, xmlAttributes[i*5+2]);
         else
             /* that's an important feature to keep same uri pointer for every reported attribute */
             attrs[i].szURI = find_element_uri(locator, xmlAttributes[i*5+2]);
 
-        attrs[i].szLocalname = bstr_from_xmlChar(xmlAttributes[i*5]);
+        attrs[i].szLocalname = intern_name(&locator->names, NULL, xmlAttributes[i*5]);
         attrs[i].szValue = saxreader_get_unescaped_value(xmlAttributes[i*5+3], xmlAttributes[i*5+4]-xmlAttributes[i*5+3]);
-        attrs[i].szQName = QName_from_xmlChar(xmlAttributes[i*5+1],
-                xmlAttributes[i*5]);
+        attrs[i].szQName = intern_name(&locator->names, xmlAttributes[i*5+1], xmlAttributes[i*5]);
     }
 
     return S_OK;
@@ -1462,7 +1613,7 @@ static void libxmlStartElementNS(
     if(This->saxreader->version < MSXML4)
         This->column++;
 
-    element = alloc_element_entry(localname, prefix, nb_namespaces, namespaces);
+    element = alloc_element_entry(This, localname, prefix, nb_namespaces, namespaces);
     push_element_ns(This, element);
 
     if (is_namespaces_enabled(This->saxreader))
@@ -1564,8 +1715,8 @@ static void libxmlEndElementNS(
 
     if (!saxreader_has_handler(This, SAXContentHandler))
     {
-        This->nb_attributes = 0;
-        free_element_entry(element);
+        free_attribute_values(This);
+        free_element_entry(This, element);
         return;
     }
 
@@ -1585,12 +1736,12 @@ static void libxmlEndElementNS(
                 local, SysStringLen(local),
                 element->qname, SysStringLen(element->qname));
 
-    This->nb_attributes = 0;
+    free_attribute_values(This);
 
     if (sax_callback_failed(This, hr))
     {
         format_error_message_from_id(This, hr);
-        free_element_entry(element);
+        free_element_entry(This, element);
         return;
     }
 
@@ -1613,7 +1764,27 @@ static void libxmlEndElementNS(
            format_error_message_from_id(This, hr);
     }
 
-    free_element_entry(element);
+    free_element_entry(This, element);
+}
+
+/* Converts to locator owned buffer, UTF-16 data never takes more code units
+ * than there are bytes in UTF-8 input, so buffer is sized upfront. */
+static const WCHAR *saxlocator_chars_from_xmlCharN(saxlocator *locator, const xmlChar *buf, int len, int *out_len)
+{
+    if (len >= locator->chars_size)
+    {
+        int size = max(len + 1, 256);
+
+        heap_free(locator->chars);
+        locator->chars = heap_alloc(size*sizeof(WCHAR));
+        locator->chars_size = locator->chars ? size : 0;
+        if (!locator->chars)
+            return NULL;
+    }
+
+    *out_len = len ? MultiByteToWideChar(CP_UTF8, 0, (LPCSTR)buf, len, locator->chars, len) : 0;
+    locator->chars[*out_len] = 0;
+    return locator->chars;
 }
 
 static void libxmlCharacters(
@@ -1622,6 +1793,7 @@ static void libxmlCharacters(
         int len)
 {
     saxlocator *This = ctx;
+    struct saxcontenthandler_iface *handler = saxreader_get_contenthandler(This->saxreader);
     BSTR Chars;
     HRESULT hr;
     xmlChar *cur, *end;
@@ -1679,8 +1851,23 @@ static void libxmlCharacters(
                 This->column = 0;
         }
 
-        Chars = pooled_bstr_from_xmlCharN(&This->saxreader->pool, cur, end-cur);
-        hr = saxreader_saxcharacters(This, Chars);
+        if (This->vbInterface)
+        {
+            Chars = pooled_bstr_from_xmlCharN(&This->saxreader->pool, cur, end-cur);
+            hr = saxreader_saxcharacters(This, Chars);
+        }
+        else
+        {
+            /* data is only valid for the duration of the call, no need to keep it around */
+            const WCHAR *chars;
+            int chars_len;
+
+            chars = saxlocator_chars_from_xmlCharN(This, cur, end-cur, &chars_len);
+            if (chars)
+                hr = ISAXContentHandler_characters(handler->handler, chars, chars_len);
+            else
+                hr = E_OUTOFMEMORY;
+        }
 
         if (sax_callback_failed(This, hr))
         {
@@ -2161,27 +2348,30 @@ static ULONG WINAPI isaxlocator_Release(
     if (ref == 0)
     {
         element_entry *element, *element2;
-        int index;
 
         SysFreeString(This->publicId);
         SysFreeString(This->systemId);
         SysFreeString(This->namespaceUri);
 
-        for(index=0; index<This->nb_attributes; index++)
-        {
-            SysFreeString(This->attributes[index].szLocalname);
-            SysFreeString(This->attributes[index].szValue);
-            SysFreeString(This->attributes[index].szQName);
-        }
+        free_attribute_values(This);
         heap_free(This->attributes);
+        heap_free(This->chars);
 
         /* element stack */
         LIST_FOR_EACH_ENTRY_SAFE(element, element2, &This->elements, element_entry, entry)
         {
             list_remove(&element->entry);
-            free_element_entry(element);
+            destroy_element_entry(element);
+        }
+
+        LIST_FOR_EACH_ENTRY_SAFE(element, element2, &This->free_elements, element_entry, entry)
+        {
+            list_remove(&element->entry);
+            destroy_element_entry(element);
         }
 
+        free_name_cache(&This->names);
+
         ISAXXMLReader_Release(&This->saxreader->ISAXXMLReader_iface);
         heap_free( This );
     }
@@ -2315,6 +2505,10 @@ static HRESULT SAXLocator_create(saxreader *reader, saxlocator **ppsaxlocator, B
     }
 
     list_init(&locator->elements);
+    list_init(&locator->free_elements);
+    memset(&locator->names, 0, sizeof(locator->names));
+    locator->chars = NULL;
+    locator->chars_size = 0;
 
     *ppsaxlocator = locator;
 
@@ -2407,20 +2601,35 @@ static HRESULT internal_parseBuffer(saxreader *This, const char *buffer, int siz
     return hr;
 }
 
+/* Streams are fed to the parser in large chunks, every chunk is a separate
+ * Read() call and a separate pass through the push parser. */
+#define SAX_STREAM_CHUNK_SIZE 0x10000
+
 static HRESULT internal_parseStream(saxreader *This, ISequentialStream *stream, BOOL vbInterface)
 {
     saxlocator *locator;
     HRESULT hr;
     ULONG dataRead;
-    char data[1024];
+    char *data;
     int ret;
 
+    data = heap_alloc(SAX_STREAM_CHUNK_SIZE);
+    if (!data) return E_OUTOFMEMORY;
+
     dataRead = 0;
-    hr = ISequentialStream_Read(stream, data, sizeof(data), &dataRead);
-    if(FAILED(hr)) return hr;
+    hr = ISequentialStream_Read(stream, data, SAX_STREAM_CHUNK_SIZE, &dataRead);
+    if(FAILED(hr))
+    {
+        heap_free(data);
+        return hr;
+    }
 
     hr = SAXLocator_create(This, &locator, vbInterface);
-    if(FAILED(hr)) return hr;
+    if(FAILED(hr))
+    {
+        heap_free(data);
+        return hr;
+    }
 
     locator->pParserCtxt = xmlCreatePushParserCtxt(
             &locator->saxreader->sax, locator,
@@ -2428,12 +2637,13 @@ static HRESULT internal_parseStream(saxreader *This, ISequentialStream *stream,
     if(!locator->pParserCtxt)
     {
         ISAXLocator_Release(&locator->ISAXLocator_iface);
+        heap_free(data);
         return E_FAIL;
     }
 
     This->isParsing = TRUE;
 
-    if(dataRead != sizeof(data))
+    if(dataRead != SAX_STREAM_CHUNK_SIZE)
     {
         ret = xmlParseChunk(locator->pParserCtxt, data, 0, 1);
         hr = ret!=XML_ERR_OK && locator->ret==S_OK ? E_FAIL : locator->ret;
@@ -2443,7 +2653,7 @@ static HRESULT internal_parseStream(saxreader *This, ISequentialStream *stream,
         while(1)
         {
             dataRead = 0;
-            hr = ISequentialStream_Read(stream, data, sizeof(data), &dataRead);
+            hr = ISequentialStream_Read(stream, data, SAX_STREAM_CHUNK_SIZE, &dataRead);
             if (FAILED(hr)) break;
 
             ret = xmlParseChunk(locator->pParserCtxt, data, dataRead, 0);
@@ -2451,7 +2661,7 @@ static HRESULT internal_parseStream(saxreader *This, ISequentialStream *stream,
 
             if (hr != S_OK) break;
 
-            if (dataRead != sizeof(data))
+            if (dataRead != SAX_STREAM_CHUNK_SIZE)
             {
                 ret = xmlParseChunk(locator->pParserCtxt, data, 0, 1);
                 hr = ret!=XML_ERR_OK && locator->ret==S_OK ? E_FAIL : locator->ret;
@@ -2465,6 +2675,7 @@ static HRESULT internal_parseStream(saxreader *This, ISequentialStream *stream,
     xmlFreeParserCtxt(locator->pParserCtxt);
     locator->pParserCtxt = NULL;
     ISAXLocator_Release(&locator->ISAXLocator_iface);
+    heap_free(data);
     return hr;
 }
 
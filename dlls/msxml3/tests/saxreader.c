@@ -2730,6 +2730,98 @@ static void test_saxreader_encoding(void)
     }
 }
 
+static struct call_entry stream_chunks_test[] = {
+    { CH_ENDTEST }
+};
+
+/* document spans several stream read chunks, text nodes and names are split
+   at arbitrary positions */
+static void test_saxreader_stream_chunks(void)
+{
+    static const char item_fmt[] = "<n:item xmlns:n=\"urn:test\" id=\"%d\">text data %d</n:item>";
+    struct call_sequence *seq;
+    ISAXXMLReader *reader;
+    WCHAR text[64], expected[64];
+    int i, len, item, text_len;
+    char buff[128], *xml;
+    IStream *stream;
+    VARIANT var;
+    HRESULT hr;
+    BSTR qname;
+
+    hr = CoCreateInstance(&CLSID_SAXXMLReader, NULL, CLSCTX_INPROC_SERVER, &IID_ISAXXMLReader, (void**)&reader);
+    EXPECT_HR(hr, S_OK);
+    g_reader = reader;
+    msxml_version = 0;
+
+    xml = HeapAlloc(GetProcessHeap(), 0, 3000 * sizeof(buff) + 16);
+    len = sprintf(xml, "<root>");
+    for (i = 0; i < 3000; i++)
+        len += sprintf(xml + len, item_fmt, i, i);
+    len += sprintf(xml + len, "</root>");
+
+    hr = ISAXXMLReader_putContentHandler(reader, &contentHandler);
+    EXPECT_HR(hr, S_OK);
+
+    stream = create_test_stream(xml, len);
+    V_VT(&var) = VT_UNKNOWN;
+    V_UNKNOWN(&var) = (IUnknown*)stream;
+
+    set_expected_seq(stream_chunks_test);
+    hr = ISAXXMLReader_parse(reader, var);
+    EXPECT_HR(hr, S_OK);
+    IStream_Release(stream);
+
+    qname = _bstr_("n:item");
+    seq = sequences[CONTENT_HANDLER_INDEX];
+    item = text_len = 0;
+    for (i = 0; i < seq->count; i++)
+    {
+        const struct call_entry *call = &seq->sequence[i];
+
+        switch (call->id)
+        {
+        case CH_STARTELEMENT:
+            if (lstrcmpW(call->arg3W, qname)) break;
+            ok(!lstrcmpW(call->arg1W, _bstr_("urn:test")), "%d: got uri %s\n", item, wine_dbgstr_w(call->arg1W));
+            ok(call->attr_count == 1, "%d: got %d attributes\n", item, call->attr_count);
+            if (call->attr_count == 1)
+            {
+                sprintf(buff, "%d", item);
+                MultiByteToWideChar(CP_ACP, 0, buff, -1, expected, sizeof(expected)/sizeof(WCHAR));
+                ok(!lstrcmpW(call->attributes[0].valueW, expected), "%d: got value %s\n", item,
+                    wine_dbgstr_w(call->attributes[0].valueW));
+            }
+            text_len = 0;
+            break;
+        case CH_CHARACTERS:
+            len = SysStringLen(call->arg1W);
+            if (text_len + len < sizeof(text)/sizeof(WCHAR))
+            {
+                memcpy(text + text_len, call->arg1W, len*sizeof(WCHAR));
+                text_len += len;
+            }
+            break;
+        case CH_ENDELEMENT:
+            if (lstrcmpW(call->arg3W, qname)) break;
+            text[text_len] = 0;
+            sprintf(buff, "text data %d", item);
+            MultiByteToWideChar(CP_ACP, 0, buff, -1, expected, sizeof(expected)/sizeof(WCHAR));
+            ok(!lstrcmpW(text, expected), "%d: got text %s\n", item, wine_dbgstr_w(text));
+            item++;
+            break;
+        default:
+            ;
+        }
+    }
+    ok(item == 3000, "got %d items\n", item);
+
+    flush_sequence(sequences, CONTENT_HANDLER_INDEX);
+    HeapFree(GetProcessHeap(), 0, xml);
+    ISAXXMLReader_Release(reader);
+    free_bstrs();
+}
+
 static void test_mxwriter_handlers(void)
 {
     ISAXContentHandler *handler;
@@ -5351,6 +5443,7 @@ START_TEST(saxreader)
     test_saxreader_properties();
     test_saxreader_features();
     test_saxreader_encoding();
+    test_saxreader_stream_chunks();
     test_dispex();
 
     /* MXXMLWriter tests */
@@ -53,6 +53,9 @@ typedef struct FileLockBytesImpl
     HANDLE hfile;
     DWORD flProtect;
     LPWSTR pwcsName;
+    HANDLE hmapping;
+    const BYTE *view;
+    ULONG view_size;
 } FileLockBytesImpl;
 
 static const ILockBytesVtbl FileLockBytesImpl_Vtbl;
@@ -87,6 +90,46 @@ static DWORD GetProtectMode(DWORD openFlags)
     return PAGE_READONLY;
 }
 
+/******************************************************************************
+ *      FileLockBytesImpl_MapFile
+ *
+ * Maps a file that is opened for reading only, so that reads can be served
+ * by copying from the view instead of calling ReadFile. This is only done
+ * when nobody else can write to the file, as the view would not follow
+ * changes to its size.
+ */
+static void FileLockBytesImpl_MapFile(FileLockBytesImpl *This, DWORD openFlags)
+{
+  This->hmapping = NULL;
+  This->view = NULL;
+  This->view_size = 0;
+
+  if (This->flProtect != PAGE_READONLY)
+    return;
+
+  if (STGM_SHARE_MODE(openFlags) != STGM_SHARE_DENY_WRITE &&
+      STGM_SHARE_MODE(openFlags) != STGM_SHARE_EXCLUSIVE)
+    return;
+
+  if (This->filesize.u.HighPart || !This->filesize.u.LowPart)
+    return;
+
+  This->hmapping = CreateFileMappingW(This->hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!This->hmapping)
+    return;
+
+  This->view = MapViewOfFile(This->hmapping, FILE_MAP_READ, 0, 0, 0);
+  if (!This->view)
+  {
+    CloseHandle(This->hmapping);
+    This->hmapping = NULL;
+    return;
+  }
+
+  This->view_size = This->filesize.u.LowPart;
+  TRACE("mapped %u bytes at %p\n", This->view_size, This->view);
+}
+
 /******************************************************************************
  *      FileLockBytesImpl_Construct
  *
@@ -111,6 +154,7 @@ HRESULT FileLockBytesImpl_Construct(HANDLE hFile, DWORD openFlags, LPCWSTR pwcsN
   This->filesize.u.LowPart = GetFileSize(This->hfile,
 					 &This->filesize.u.HighPart);
   This->flProtect = GetProtectMode(openFlags);
+  FileLockBytesImpl_MapFile(This, openFlags);
 
   if(pwcsName) {
     if (!GetFullPathNameW(pwcsName, MAX_PATH, fullpath, NULL))
@@ -121,6 +165,8 @@ HRESULT FileLockBytesImpl_Construct(HANDLE hFile, DWORD openFlags, LPCWSTR pwcsN
                               (lstrlenW(fullpath)+1)*sizeof(WCHAR));
     if (!This->pwcsName)
     {
+       if (This->view) UnmapViewOfFile(This->view);
+       if (This->hmapping) CloseHandle(This->hmapping);
        HeapFree(GetProcessHeap(), 0, This);
        return E_OUTOFMEMORY;
     }
@@ -169,6 +215,8 @@ static ULONG WINAPI FileLockBytesImpl_Release(ILockBytes *iface)
 
     if (ref == 0)
     {
+        if (This->view) UnmapViewOfFile(This->view);
+        if (This->hmapping) CloseHandle(This->hmapping);
         CloseHandle(This->hfile);
         HeapFree(GetProcessHeap(), 0, This->pwcsName);
         HeapFree(GetProcessHeap(), 0, This);
@@ -207,6 +255,15 @@ static HRESULT WINAPI FileLockBytesImpl_ReadAt(
     if (pcbRead)
         *pcbRead = 0;
 
+    if (This->view && ulOffset.QuadPart < This->view_size &&
+        cb <= This->view_size - ulOffset.u.LowPart)
+    {
+        memcpy(pv, This->view + ulOffset.u.LowPart, cb);
+        if (pcbRead)
+            *pcbRead = cb;
+        return S_OK;
+    }
+
     offset.QuadPart = ulOffset.QuadPart;
 
     ret = SetFilePointerEx(This->hfile, offset, NULL, FILE_BEGIN);
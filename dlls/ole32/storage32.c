@@ -116,6 +116,8 @@ static ULONG Storage32Impl_AddExtBlockDepot(StorageImpl* This);
 static ULONG Storage32Impl_GetNextExtendedBlock(StorageImpl* This, ULONG blockIndex);
 static ULONG Storage32Impl_GetExtDepotBlock(StorageImpl* This, ULONG depotIndex);
 static void Storage32Impl_SetExtDepotBlock(StorageImpl* This, ULONG depotIndex, ULONG blockIndex);
+static HRESULT StorageImpl_GetCachedDepotBlock(StorageImpl* This, ULONG depotIndex, BlockDepotCacheEntry **entry);
+static HRESULT StorageImpl_FlushDepotCache(StorageImpl* This);
 
 static ULONG BlockChainStream_GetHeadOfChain(BlockChainStream* This);
 static ULARGE_INTEGER BlockChainStream_GetSize(BlockChainStream* This);
@@ -2757,6 +2759,7 @@ static HRESULT StorageImpl_Construct(
   HRESULT     hr = S_OK;
   DirEntry currentEntry;
   DirRef      currentEntryRef;
+  int         i;
 
   if ( FAILED( validateSTGM(openFlags) ))
     return STG_E_INVALIDFLAG;
@@ -2869,7 +2872,13 @@ static HRESULT StorageImpl_Construct(
   /*
    * There is no block depot cached yet.
    */
-  This->indexBlockDepotCached = 0xFFFFFFFF;
+  for (i=0; i<BLOCKDEPOT_CACHE_SIZE; i++)
+  {
+    This->blockDepotCache[i].index = 0xFFFFFFFF;
+    This->blockDepotCache[i].dirty = FALSE;
+  }
+  This->blockDepotToEvict = 0;
+  This->lastBlockDepotCached = 0;
   This->indexExtBlockDepotCached = 0xFFFFFFFF;
 
   /*
@@ -3062,6 +3071,9 @@ static HRESULT StorageImpl_Flush(StorageBaseImpl *storage)
     if (This->blockChainCache[i])
       hr = BlockChainStream_Flush(This->blockChainCache[i]);
 
+  if (SUCCEEDED(hr))
+    hr = StorageImpl_FlushDepotCache(This);
+
   if (SUCCEEDED(hr))
     hr = ILockBytes_Flush(This->lockBytes);
 
@@ -3079,13 +3091,12 @@ static ULONG StorageImpl_GetNextFreeBigBlock(
   StorageImpl* This)
 {
   ULONG depotBlockIndexPos;
-  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
+  BlockDepotCacheEntry *depot;
   ULONG depotBlockOffset;
   ULONG blocksPerDepot    = This->bigBlockSize / sizeof(ULONG);
   ULONG nextBlockIndex    = BLOCK_SPECIAL;
   int   depotIndex        = 0;
   ULONG freeBlock         = BLOCK_UNUSED;
-  ULONG read;
   ULARGE_INTEGER neededSize;
   STATSTG statstg;
 
@@ -3175,14 +3186,12 @@ static ULONG StorageImpl_GetNextFreeBigBlock(
       }
     }
 
-    StorageImpl_ReadBigBlock(This, depotBlockIndexPos, depotBuffer, &read);
-
-    if (read)
+    if (SUCCEEDED(StorageImpl_GetCachedDepotBlock(This, depotIndex, &depot)))
     {
       while ( ( (depotBlockOffset/sizeof(ULONG) ) < blocksPerDepot) &&
               ( nextBlockIndex != BLOCK_UNUSED))
       {
-        StorageUtl_ReadDWord(depotBuffer, depotBlockOffset, &nextBlockIndex);
+        nextBlockIndex = depot->data[depotBlockOffset/sizeof(ULONG)];
 
         if (nextBlockIndex == BLOCK_UNUSED)
         {
@@ -3275,6 +3284,113 @@ static ULONG Storage32Impl_GetExtDepotBlock(StorageImpl* This, ULONG depotIndex)
   return blockIndex;
 }
 
+/******************************************************************************
+ *      StorageImpl_WriteDepotCacheEntry
+ *
+ * Writes a modified block of the big block depot back to the file.
+ */
+static HRESULT StorageImpl_WriteDepotCacheEntry(StorageImpl* This, BlockDepotCacheEntry *entry)
+{
+  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
+  ULONG index, num_blocks = This->bigBlockSize / 4;
+
+  for (index = 0; index < num_blocks; index++)
+    StorageUtl_WriteDWord(depotBuffer, index*sizeof(ULONG), entry->data[index]);
+
+  if (!StorageImpl_WriteBigBlock(This, entry->sector, depotBuffer))
+    return STG_E_WRITEFAULT;
+
+  entry->dirty = FALSE;
+  return S_OK;
+}
+
+static HRESULT StorageImpl_FlushDepotCache(StorageImpl* This)
+{
+  HRESULT hr;
+  int i;
+
+  for (i=0; i<BLOCKDEPOT_CACHE_SIZE; i++)
+  {
+    if (This->blockDepotCache[i].dirty)
+    {
+      hr = StorageImpl_WriteDepotCacheEntry(This, &This->blockDepotCache[i]);
+      if (FAILED(hr)) return hr;
+    }
+  }
+
+  return S_OK;
+}
+
+/******************************************************************************
+ *      StorageImpl_GetCachedDepotBlock
+ *
+ * Returns the cache entry for the given block of the big block depot,
+ * reading it from the file if necessary. Walking a chain usually stays
+ * within one depot block, so the last entry used is checked first.
+ */
+static HRESULT StorageImpl_GetCachedDepotBlock(StorageImpl* This, ULONG depotIndex,
+  BlockDepotCacheEntry **entry)
+{
+  BlockDepotCacheEntry *result;
+  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
+  ULONG read, index, num_blocks;
+  HRESULT hr;
+  int i;
+
+  result = &This->blockDepotCache[This->lastBlockDepotCached];
+  if (result->index == depotIndex)
+  {
+    *entry = result;
+    return S_OK;
+  }
+
+  for (i=0; i<BLOCKDEPOT_CACHE_SIZE; i++)
+  {
+    if (This->blockDepotCache[i].index == depotIndex)
+    {
+      This->lastBlockDepotCached = i;
+      *entry = &This->blockDepotCache[i];
+      return S_OK;
+    }
+  }
+
+  i = This->blockDepotToEvict;
+  result = &This->blockDepotCache[i];
+
+  if (result->dirty)
+  {
+    hr = StorageImpl_WriteDepotCacheEntry(This, result);
+    if (FAILED(hr)) return hr;
+  }
+
+  result->index = 0xFFFFFFFF;
+
+  if (depotIndex < COUNT_BBDEPOTINHEADER)
+    result->sector = This->bigBlockDepotStart[depotIndex];
+  else
+    result->sector = Storage32Impl_GetExtDepotBlock(This, depotIndex);
+
+  StorageImpl_ReadBigBlock(This, result->sector, depotBuffer, &read);
+
+  if (!read)
+    return STG_E_READFAULT;
+
+  num_blocks = This->bigBlockSize / 4;
+
+  for (index = 0; index < num_blocks; index++)
+    StorageUtl_ReadDWord(depotBuffer, index*sizeof(ULONG), &result->data[index]);
+
+  result->index = depotIndex;
+
+  This->blockDepotToEvict++;
+  if (This->blockDepotToEvict == BLOCKDEPOT_CACHE_SIZE)
+    This->blockDepotToEvict = 0;
+
+  This->lastBlockDepotCached = i;
+  *entry = result;
+  return S_OK;
+}
+
 /******************************************************************************
  *      Storage32Impl_SetExtDepotBlock
  *
@@ -3418,10 +3534,8 @@ static HRESULT StorageImpl_GetNextBlockInChain(
   ULONG offsetInDepot    = blockIndex * sizeof (ULONG);
   ULONG depotBlockCount  = offsetInDepot / This->bigBlockSize;
   ULONG depotBlockOffset = offsetInDepot % This->bigBlockSize;
-  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
-  ULONG read;
-  ULONG depotBlockIndexPos;
-  int index, num_blocks;
+  BlockDepotCacheEntry *depot;
+  HRESULT hr;
 
   *nextBlockIndex   = BLOCK_SPECIAL;
 
@@ -3432,40 +3546,11 @@ static HRESULT StorageImpl_GetNextBlockInChain(
     return STG_E_READFAULT;
   }
 
-  /*
-   * Cache the currently accessed depot block.
-   */
-  if (depotBlockCount != This->indexBlockDepotCached)
-  {
-    This->indexBlockDepotCached = depotBlockCount;
-
-    if (depotBlockCount < COUNT_BBDEPOTINHEADER)
-    {
-      depotBlockIndexPos = This->bigBlockDepotStart[depotBlockCount];
-    }
-    else
-    {
-      /*
-       * We have to look in the extended depot.
-       */
-      depotBlockIndexPos = Storage32Impl_GetExtDepotBlock(This, depotBlockCount);
-    }
-
-    StorageImpl_ReadBigBlock(This, depotBlockIndexPos, depotBuffer, &read);
-
-    if (!read)
-      return STG_E_READFAULT;
-
-    num_blocks = This->bigBlockSize / 4;
-
-    for (index = 0; index < num_blocks; index++)
-    {
-      StorageUtl_ReadDWord(depotBuffer, index*sizeof(ULONG), nextBlockIndex);
-      This->blockDepotCached[index] = *nextBlockIndex;
-    }
-  }
+  hr = StorageImpl_GetCachedDepotBlock(This, depotBlockCount, &depot);
+  if (FAILED(hr))
+    return hr;
 
-  *nextBlockIndex = This->blockDepotCached[depotBlockOffset/sizeof(ULONG)];
+  *nextBlockIndex = depot->data[depotBlockOffset/sizeof(ULONG)];
 
   return S_OK;
 }
@@ -3519,10 +3604,21 @@ static void StorageImpl_SetNextBlockInChain(
   ULONG depotBlockCount  = offsetInDepot / This->bigBlockSize;
   ULONG depotBlockOffset = offsetInDepot % This->bigBlockSize;
   ULONG depotBlockIndexPos;
+  BlockDepotCacheEntry *depot;
 
   assert(depotBlockCount < This->bigBlockDepotCount);
   assert(blockIndex != nextBlock);
 
+  /*
+   * Update the cached depot block, it is written back on flush.
+   */
+  if (SUCCEEDED(StorageImpl_GetCachedDepotBlock(This, depotBlockCount, &depot)))
+  {
+    depot->data[depotBlockOffset/sizeof(ULONG)] = nextBlock;
+    depot->dirty = TRUE;
+    return;
+  }
+
   if (depotBlockCount < COUNT_BBDEPOTINHEADER)
   {
     depotBlockIndexPos = This->bigBlockDepotStart[depotBlockCount];
@@ -3537,13 +3633,6 @@ static void StorageImpl_SetNextBlockInChain(
 
   StorageImpl_WriteDWordToBigBlock(This, depotBlockIndexPos, depotBlockOffset,
                         nextBlock);
-  /*
-   * Update the cached block depot, if necessary.
-   */
-  if (depotBlockCount == This->indexBlockDepotCached)
-  {
-    This->blockDepotCached[depotBlockOffset/sizeof(ULONG)] = nextBlock;
-  }
 }
 
 /******************************************************************************
@@ -6211,7 +6300,22 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
 
     if (!cachedBlock)
     {
-      /* Not in cache, and we're going to read past the end of the block. */
+      ULONG extraBlocks = 0;
+
+      /* Not in cache, and we're going to read past the end of the block.
+       * Read any following blocks stored in consecutive sectors along
+       * with this one, leaving the last block of the read to the cache. */
+      while (size - bytesToReadInBuffer > This->parentStorage->bigBlockSize &&
+             This->cachedBlocks[0].index != blockNoInSequence + extraBlocks + 1 &&
+             This->cachedBlocks[1].index != blockNoInSequence + extraBlocks + 1 &&
+             BlockChainStream_GetSectorOfOffset(This, blockNoInSequence + extraBlocks + 1) ==
+               blockIndex + extraBlocks + 1)
+      {
+        bytesToReadInBuffer += This->parentStorage->bigBlockSize;
+        extraBlocks++;
+      }
+      blockNoInSequence += extraBlocks;
+
       ulOffset.u.HighPart = 0;
       ulOffset.u.LowPart = StorageImpl_GetBigBlockOffset(This->parentStorage, blockIndex) +
                                offsetInBlock;
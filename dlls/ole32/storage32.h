@@ -332,6 +332,19 @@ void StorageBaseImpl_RemoveStream(StorageBaseImpl * stg, StgStreamImpl * strm) D
 
 /* Number of BlockChainStream objects to cache in a StorageImpl */
 #define BLOCKCHAIN_CACHE_SIZE 4
+#define BLOCKDEPOT_CACHE_SIZE 8
+
+/*
+ * A block of the big block depot kept in memory. Changes are written back
+ * to the file when the entry is evicted or the storage is flushed.
+ */
+typedef struct BlockDepotCacheEntry
+{
+  ULONG index;
+  ULONG sector;
+  BOOL  dirty;
+  ULONG data[MAX_BIG_BLOCK_SIZE / 4];
+} BlockDepotCacheEntry;
 
 /****************************************************************************
  * Storage32Impl definitions.
@@ -363,8 +376,9 @@ struct StorageImpl
   ULONG extBlockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
   ULONG indexExtBlockDepotCached;
 
-  ULONG blockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
-  ULONG indexBlockDepotCached;
+  BlockDepotCacheEntry blockDepotCache[BLOCKDEPOT_CACHE_SIZE];
+  UINT blockDepotToEvict;
+  UINT lastBlockDepotCached;
   ULONG prevFreeBlock;
 
   /* All small blocks before this one are known to be in use. */
@@ -3099,6 +3099,243 @@ if (hr == S_OK) {
     DeleteFileW(fileW);
 }
 
+static void fill_chunk(BYTE *buffer, ULONG size, int stream, ULONG chunk)
+{
+    ULONG i;
+
+    for (i = 0; i < size; i++)
+        buffer[i] = (BYTE)(chunk * 7 + stream * 13 + i);
+}
+
+static void test_large_streams(void)
+{
+    static const WCHAR fileW[] = {'w','i','n','e','t','e','s','t','.','s','t','g',0};
+    static const ULONG chunk_size = 4096, chunk_count = 256;
+    IStream *stm[2];
+    IStorage *stg;
+    BYTE buffer[4096], expected[4096];
+    LARGE_INTEGER pos;
+    ULONG i, j, chunk, count;
+    HRESULT hr;
+
+    hr = StgCreateDocfile(fileW, STGM_CREATE | STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, &stg);
+    ok(hr == S_OK, "StgCreateDocfile failed 0x%08x\n", hr);
+    if (FAILED(hr)) return;
+
+    hr = IStorage_CreateStream(stg, strmA_name, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, 0, &stm[0]);
+    ok(hr == S_OK, "CreateStream failed 0x%08x\n", hr);
+    hr = IStorage_CreateStream(stg, strmB_name, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, 0, &stm[1]);
+    ok(hr == S_OK, "CreateStream failed 0x%08x\n", hr);
+
+    /* interleave the writes so the block chains of both streams span many depot blocks */
+    for (i = 0; i < chunk_count; i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            fill_chunk(buffer, chunk_size, j, i);
+            count = 0;
+            hr = IStream_Write(stm[j], buffer, chunk_size, &count);
+            ok(hr == S_OK && count == chunk_size, "Write failed 0x%08x, %u\n", hr, count);
+        }
+    }
+
+    /* read and overwrite chunks in random order */
+    for (i = 0; i < chunk_count; i++)
+    {
+        chunk = (i * 97) % chunk_count;
+        for (j = 0; j < 2; j++)
+        {
+            pos.QuadPart = chunk * chunk_size;
+            hr = IStream_Seek(stm[j], pos, STREAM_SEEK_SET, NULL);
+            ok(hr == S_OK, "Seek failed 0x%08x\n", hr);
+            count = 0;
+            hr = IStream_Read(stm[j], buffer, chunk_size, &count);
+            ok(hr == S_OK && count == chunk_size, "Read failed 0x%08x, %u\n", hr, count);
+            fill_chunk(expected, chunk_size, j, chunk);
+            ok(!memcmp(buffer, expected, chunk_size), "stream %u chunk %u differs\n", j, chunk);
+
+            if (chunk % 3 == 0)
+            {
+                fill_chunk(buffer, chunk_size, j + 2, chunk);
+                hr = IStream_Seek(stm[j], pos, STREAM_SEEK_SET, NULL);
+                ok(hr == S_OK, "Seek failed 0x%08x\n", hr);
+                hr = IStream_Write(stm[j], buffer, chunk_size, &count);
+                ok(hr == S_OK && count == chunk_size, "Write failed 0x%08x, %u\n", hr, count);
+            }
+        }
+    }
+
+    IStream_Release(stm[0]);
+    IStream_Release(stm[1]);
+    IStorage_Release(stg);
+
+    hr = StgOpenStorage(fileW, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+    if (FAILED(hr))
+    {
+        DeleteFileW(fileW);
+        return;
+    }
+
+    hr = IStorage_OpenStream(stg, strmA_name, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, 0, &stm[0]);
+    ok(hr == S_OK, "OpenStream failed 0x%08x\n", hr);
+    hr = IStorage_OpenStream(stg, strmB_name, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, 0, &stm[1]);
+    ok(hr == S_OK, "OpenStream failed 0x%08x\n", hr);
+
+    for (i = 0; i < chunk_count; i++)
+    {
+        chunk = chunk_count - 1 - i;
+        for (j = 0; j < 2; j++)
+        {
+            pos.QuadPart = chunk * chunk_size;
+            hr = IStream_Seek(stm[j], pos, STREAM_SEEK_SET, NULL);
+            ok(hr == S_OK, "Seek failed 0x%08x\n", hr);
+            count = 0;
+            hr = IStream_Read(stm[j], buffer, chunk_size, &count);
+            ok(hr == S_OK && count == chunk_size, "Read failed 0x%08x, %u\n", hr, count);
+            fill_chunk(expected, chunk_size, chunk % 3 == 0 ? j + 2 : j, chunk);
+            ok(!memcmp(buffer, expected, chunk_size), "stream %u chunk %u differs\n", j, chunk);
+        }
+    }
+
+    IStream_Release(stm[0]);
+    IStream_Release(stm[1]);
+    IStorage_Release(stg);
+
+    DeleteFileW(fileW);
+}
+
+static void check_stream_chunks(IStorage *stg, const WCHAR *name, int stream, ULONG size)
+{
+    BYTE buffer[4096], expected[4096];
+    IStream *stm;
+    STATSTG stat;
+    ULONG chunk, count;
+    HRESULT hr;
+
+    hr = IStorage_OpenStream(stg, name, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, 0, &stm);
+    ok(hr == S_OK, "OpenStream failed 0x%08x\n", hr);
+    if (FAILED(hr)) return;
+
+    hr = IStream_Stat(stm, &stat, STATFLAG_NONAME);
+    ok(hr == S_OK, "Stat failed 0x%08x\n", hr);
+    ok(stat.cbSize.QuadPart == size, "stream %u: got size %u\n", stream, stat.cbSize.u.LowPart);
+
+    for (chunk = 0; chunk * sizeof(buffer) < size; chunk++)
+    {
+        ULONG len = min(size - chunk * sizeof(buffer), sizeof(buffer));
+
+        count = 0;
+        hr = IStream_Read(stm, buffer, sizeof(buffer), &count);
+        ok(hr == S_OK && count == len, "Read failed 0x%08x, %u\n", hr, count);
+        fill_chunk(expected, len, stream, chunk);
+        ok(!memcmp(buffer, expected, len), "stream %u chunk %u differs\n", stream, chunk);
+    }
+
+    IStream_Release(stm);
+}
+
+static void test_mapped_file(void)
+{
+    static const WCHAR fileW[] = {'w','i','n','e','t','e','s','t','.','s','t','g',0};
+    BYTE buffer[4096];
+    IStream *stm[2];
+    IStorage *stg;
+    ULARGE_INTEGER size;
+    HANDLE file;
+    DWORD old_size, new_size;
+    ULONG i, count;
+    HRESULT hr;
+
+    hr = StgCreateDocfile(fileW, STGM_CREATE | STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, &stg);
+    ok(hr == S_OK, "StgCreateDocfile failed 0x%08x\n", hr);
+    if (FAILED(hr)) return;
+
+    hr = IStorage_CreateStream(stg, strmA_name, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, 0, &stm[0]);
+    ok(hr == S_OK, "CreateStream failed 0x%08x\n", hr);
+    for (i = 0; i < 2; i++)
+    {
+        fill_chunk(buffer, sizeof(buffer), 0, i);
+        hr = IStream_Write(stm[0], buffer, sizeof(buffer), &count);
+        ok(hr == S_OK && count == sizeof(buffer), "Write failed 0x%08x, %u\n", hr, count);
+    }
+    IStream_Release(stm[0]);
+    IStorage_Release(stg);
+
+    file = CreateFileW(fileW, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    old_size = GetFileSize(file, NULL);
+    CloseHandle(file);
+
+    /* a read-only file that nobody can write to is read through a mapping */
+    hr = StgOpenStorage(fileW, NULL, STGM_READ | STGM_SHARE_DENY_WRITE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+    check_stream_chunks(stg, strmA_name, 0, 2 * sizeof(buffer));
+    IStorage_Release(stg);
+
+    /* write well past the end of the previous mapping, growing one stream
+     * through SetSize and appending another */
+    hr = StgOpenStorage(fileW, NULL, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+
+    hr = IStorage_OpenStream(stg, strmA_name, NULL, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, &stm[0]);
+    ok(hr == S_OK, "OpenStream failed 0x%08x\n", hr);
+    size.QuadPart = 20 * sizeof(buffer);
+    hr = IStream_SetSize(stm[0], size);
+    ok(hr == S_OK, "SetSize failed 0x%08x\n", hr);
+    for (i = 2; i < 20; i++)
+    {
+        fill_chunk(buffer, sizeof(buffer), 0, i);
+        hr = IStream_Write(stm[0], buffer, sizeof(buffer), &count);
+        ok(hr == S_OK && count == sizeof(buffer), "Write failed 0x%08x, %u\n", hr, count);
+    }
+
+    hr = IStorage_CreateStream(stg, strmB_name, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, 0, &stm[1]);
+    ok(hr == S_OK, "CreateStream failed 0x%08x\n", hr);
+    for (i = 0; i < 24; i++)
+    {
+        fill_chunk(buffer, sizeof(buffer), 1, i);
+        hr = IStream_Write(stm[1], buffer, sizeof(buffer), &count);
+        ok(hr == S_OK && count == sizeof(buffer), "Write failed 0x%08x, %u\n", hr, count);
+    }
+    IStream_Release(stm[0]);
+    IStream_Release(stm[1]);
+
+    check_stream_chunks(stg, strmA_name, 0, 20 * sizeof(buffer));
+    check_stream_chunks(stg, strmB_name, 1, 24 * sizeof(buffer));
+    IStorage_Release(stg);
+
+    file = CreateFileW(fileW, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    new_size = GetFileSize(file, NULL);
+    CloseHandle(file);
+    ok(new_size > old_size + 40 * sizeof(buffer), "file size went from %u to %u\n", old_size, new_size);
+
+    /* the new mapping covers the grown file */
+    hr = StgOpenStorage(fileW, NULL, STGM_READ | STGM_SHARE_DENY_WRITE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+    check_stream_chunks(stg, strmA_name, 0, 20 * sizeof(buffer));
+    check_stream_chunks(stg, strmB_name, 1, 24 * sizeof(buffer));
+    IStorage_Release(stg);
+
+    /* shrink a stream again */
+    hr = StgOpenStorage(fileW, NULL, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+    hr = IStorage_OpenStream(stg, strmA_name, NULL, STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, &stm[0]);
+    ok(hr == S_OK, "OpenStream failed 0x%08x\n", hr);
+    size.QuadPart = sizeof(buffer) + 100;
+    hr = IStream_SetSize(stm[0], size);
+    ok(hr == S_OK, "SetSize failed 0x%08x\n", hr);
+    IStream_Release(stm[0]);
+    IStorage_Release(stg);
+
+    hr = StgOpenStorage(fileW, NULL, STGM_READ | STGM_SHARE_DENY_WRITE, NULL, 0, &stg);
+    ok(hr == S_OK, "StgOpenStorage failed 0x%08x\n", hr);
+    check_stream_chunks(stg, strmA_name, 0, sizeof(buffer) + 100);
+    check_stream_chunks(stg, strmB_name, 1, 24 * sizeof(buffer));
+    IStorage_Release(stg);
+
+    DeleteFileW(fileW);
+}
+
 START_TEST(storage32)
 {
     CHAR temp[MAX_PATH];
@@ -3144,4 +3381,6 @@ START_TEST(storage32)
     test_hglobal_storage_creation();
     test_convert();
     test_direct_swmr();
+    test_large_streams();
+    test_mapped_file();
 }
@@ -2177,7 +2177,15 @@ static inline ULONG array_read_variance_and_unmarshall(
       offset = pStubMsg->Offset;
 
       if (!fMustAlloc && !*ppMemory)
-        fMustAlloc = TRUE;
+      {
+        if (fUseBufferMemoryServer && !pStubMsg->IsClient &&
+            !offset && pStubMsg->ActualCount == pStubMsg->MaxCount)
+          /* the whole array is in the RPC buffer, so servers can point
+           * straight into it */
+          *ppMemory = pStubMsg->Buffer;
+        else
+          fMustAlloc = TRUE;
+      }
       if (fMustAlloc)
         *ppMemory = NdrAllocate(pStubMsg, memsize);
       saved_buffer = pStubMsg->Buffer;
@@ -2187,7 +2195,9 @@ static inline ULONG array_read_variance_and_unmarshall(
       EmbeddedPointerUnmarshall(pStubMsg, saved_buffer, *ppMemory, pFormat,
                                 fMustAlloc);
 
-      memcpy(*ppMemory + offset, saved_buffer, bufsize);
+      TRACE("copying %p to %p\n", saved_buffer, *ppMemory + offset);
+      if (*ppMemory + offset != saved_buffer)
+        memcpy(*ppMemory + offset, saved_buffer, bufsize);
     }
     return bufsize;
   case RPC_FC_C_CSTRING:
@@ -5463,7 +5473,14 @@ unsigned char *  WINAPI NdrVaryingArrayUnmarshall(PMIDL_STUB_MESSAGE pStubMsg,
     offset = pStubMsg->Offset;
 
     if (!fMustAlloc && !*ppMemory)
-        fMustAlloc = TRUE;
+    {
+        if (!pStubMsg->IsClient && !offset && bufsize == size)
+            /* the whole array is in the RPC buffer, so servers can point
+             * straight into it */
+            *ppMemory = pStubMsg->Buffer;
+        else
+            fMustAlloc = TRUE;
+    }
     if (fMustAlloc)
         *ppMemory = NdrAllocate(pStubMsg, size);
     saved_buffer = pStubMsg->BufferMark = pStubMsg->Buffer;
@@ -5471,7 +5488,9 @@ unsigned char *  WINAPI NdrVaryingArrayUnmarshall(PMIDL_STUB_MESSAGE pStubMsg,
 
     EmbeddedPointerUnmarshall(pStubMsg, saved_buffer, *ppMemory, pFormat, fMustAlloc);
 
-    memcpy(*ppMemory + offset, saved_buffer, bufsize);
+    TRACE("copying %p to %p\n", saved_buffer, *ppMemory + offset);
+    if (*ppMemory + offset != saved_buffer)
+        memcpy(*ppMemory + offset, saved_buffer, bufsize);
 
     return NULL;
 }
@@ -412,6 +412,261 @@ static void client_free_handle(
     }
 }
 
+/* Procedures that only take base type parameters (by value or through a
+ * simple reference) are translated once into a table of buffer operations,
+ * which saves going through the generic marshalling routines and looking
+ * at the format string again on every call. */
+
+#define BASE_ARG_IN         0x01
+#define BASE_ARG_OUT        0x02
+#define BASE_ARG_RETURN     0x04
+#define BASE_ARG_SIMPLE_REF 0x08
+#define BASE_ARG_FLOAT      0x10
+
+struct base_arg
+{
+    unsigned short stack_offset;
+    unsigned char  size;       /* size in memory and on the wire */
+    unsigned char  flags;      /* BASE_ARG_* */
+    unsigned short alloc_size; /* size of server allocated [out] memory */
+};
+
+struct base_proc
+{
+    const NDR_PARAM_OIF *params;   /* parameter format this was built from */
+    unsigned short number_of_params;
+    BOOL           supported;      /* whether the fast path can be used */
+    ULONG          in_size;        /* buffer space needed by the [in] params */
+    ULONG          out_size;       /* buffer space needed by the [out] params */
+    struct base_arg *args;
+    NDR_PARAM_OIF  format[1];      /* copy of the parameter format */
+};
+
+#define BASE_PROC_CACHE_SIZE 1024
+#define BASE_PROC_CACHE_PROBE 8
+
+/* entries are never freed, they are checked against a copy of the format
+ * so that a different module loaded at the same address doesn't match */
+static struct base_proc *base_proc_cache[BASE_PROC_CACHE_SIZE];
+
+static unsigned int base_type_size(unsigned char fc)
+{
+    switch (fc)
+    {
+    case RPC_FC_BYTE:
+    case RPC_FC_CHAR:
+    case RPC_FC_SMALL:
+    case RPC_FC_USMALL:
+        return sizeof(UCHAR);
+    case RPC_FC_WCHAR:
+    case RPC_FC_SHORT:
+    case RPC_FC_USHORT:
+        return sizeof(USHORT);
+    case RPC_FC_LONG:
+    case RPC_FC_ULONG:
+    case RPC_FC_ERROR_STATUS_T:
+    case RPC_FC_ENUM32:
+        return sizeof(ULONG);
+    case RPC_FC_FLOAT:
+        return sizeof(float);
+    case RPC_FC_DOUBLE:
+        return sizeof(double);
+    case RPC_FC_HYPER:
+        return sizeof(ULONGLONG);
+    default:
+        /* types that are converted or checked when marshalling */
+        return 0;
+    }
+}
+
+static struct base_proc *build_base_proc( const NDR_PARAM_OIF *params, unsigned short number_of_params )
+{
+    struct base_proc *proc;
+    unsigned int i;
+
+    proc = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                      FIELD_OFFSET( struct base_proc, format[number_of_params] ) +
+                      number_of_params * sizeof(struct base_arg) );
+    if (!proc) return NULL;
+
+    proc->params = params;
+    proc->number_of_params = number_of_params;
+    proc->args = (struct base_arg *)&proc->format[number_of_params];
+    memcpy( proc->format, params, number_of_params * sizeof(*params) );
+
+    for (i = 0; i < number_of_params; i++)
+    {
+        struct base_arg *arg = &proc->args[i];
+        unsigned int size;
+
+        if (!params[i].attr.IsBasetype || params[i].attr.IsPipe) return proc;
+        if (!(size = base_type_size( params[i].u.type_format_char ))) return proc;
+        if (params[i].attr.ServerAllocSize && !params[i].attr.IsSimpleRef) return proc;
+
+        arg->stack_offset = params[i].stack_offset;
+        arg->size = size;
+        arg->alloc_size = params[i].attr.ServerAllocSize * 8;
+        if (params[i].attr.IsIn) arg->flags |= BASE_ARG_IN;
+        if (params[i].attr.IsOut) arg->flags |= BASE_ARG_OUT;
+        if (params[i].attr.IsReturn) arg->flags |= BASE_ARG_RETURN;
+        if (params[i].attr.IsSimpleRef) arg->flags |= BASE_ARG_SIMPLE_REF;
+        if (params[i].u.type_format_char == RPC_FC_FLOAT) arg->flags |= BASE_ARG_FLOAT;
+
+        if (arg->flags & BASE_ARG_IN)
+            proc->in_size = ((proc->in_size + size - 1) & ~(size - 1)) + size;
+        if (arg->flags & (BASE_ARG_OUT | BASE_ARG_RETURN))
+            proc->out_size = ((proc->out_size + size - 1) & ~(size - 1)) + size;
+    }
+
+    proc->supported = TRUE;
+    return proc;
+}
+
+/* returns the translated procedure, or NULL if it has to be interpreted */
+static const struct base_proc *get_base_proc( PFORMAT_STRING pFormat, unsigned short number_of_params )
+{
+    const NDR_PARAM_OIF *params = (const NDR_PARAM_OIF *)pFormat;
+    unsigned int i, hash = ((ULONG_PTR)pFormat >> 2) % BASE_PROC_CACHE_SIZE;
+    struct base_proc *proc;
+
+    for (i = 0; i < BASE_PROC_CACHE_PROBE; i++)
+    {
+        proc = base_proc_cache[(hash + i) % BASE_PROC_CACHE_SIZE];
+        if (!proc) break;
+        if (proc->params == params && proc->number_of_params == number_of_params &&
+            !memcmp( proc->format, params, number_of_params * sizeof(*params) ))
+            return proc->supported ? proc : NULL;
+    }
+
+    if (!(proc = build_base_proc( params, number_of_params ))) return NULL;
+    TRACE( "%p: %u params, %s\n", pFormat, number_of_params, proc->supported ? "base types only" : "interpreted" );
+
+    for (i = 0; i < BASE_PROC_CACHE_PROBE; i++)
+    {
+        if (!InterlockedCompareExchangePointer( (void **)&base_proc_cache[(hash + i) % BASE_PROC_CACHE_SIZE],
+                                                proc, NULL ))
+            return proc->supported ? proc : NULL;
+    }
+
+    /* cache is full around this slot, keep interpreting this procedure */
+    HeapFree( GetProcessHeap(), 0, proc );
+    return NULL;
+}
+
+static inline void base_arg_buffer_size( MIDL_STUB_MESSAGE *pStubMsg, const struct base_arg *arg )
+{
+    ULONG len = (pStubMsg->BufferLength + arg->size - 1) & ~(arg->size - 1);
+
+    if (len + arg->size < pStubMsg->BufferLength) RpcRaiseException( RPC_X_BAD_STUB_DATA );
+    pStubMsg->BufferLength = len + arg->size;
+}
+
+static inline void base_arg_marshal( MIDL_STUB_MESSAGE *pStubMsg, const void *mem, unsigned int size )
+{
+    ULONG_PTR mask = size - 1;
+    unsigned char *end = (unsigned char *)pStubMsg->RpcMsg->Buffer + pStubMsg->BufferLength;
+
+    memset( pStubMsg->Buffer, 0, (size - (ULONG_PTR)pStubMsg->Buffer) & mask );
+    pStubMsg->Buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+    if (pStubMsg->Buffer + size < pStubMsg->Buffer || pStubMsg->Buffer + size > end)
+    {
+        ERR( "buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n", pStubMsg->Buffer, end, size );
+        RpcRaiseException( RPC_X_BAD_STUB_DATA );
+    }
+    memcpy( pStubMsg->Buffer, mem, size );
+    pStubMsg->Buffer += size;
+}
+
+/* returns a pointer to the value in the buffer */
+static inline unsigned char *base_arg_unmarshal( MIDL_STUB_MESSAGE *pStubMsg, unsigned int size )
+{
+    ULONG_PTR mask = size - 1;
+    unsigned char *ret = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+
+    if (ret + size < ret || ret + size > pStubMsg->BufferEnd)
+    {
+        ERR( "buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n", ret, pStubMsg->BufferEnd, size );
+        RpcRaiseException( RPC_X_BAD_STUB_DATA );
+    }
+    pStubMsg->Buffer = ret + size;
+    return ret;
+}
+
+static void client_do_base_args( PMIDL_STUB_MESSAGE pStubMsg, const struct base_proc *proc,
+                                 enum stubless_phase phase, void **fpu_args, unsigned char *pRetVal )
+{
+    unsigned int i;
+
+    TRACE( "phase %d, %u base type params\n", phase, proc->number_of_params );
+
+    switch (phase)
+    {
+    case STUBLESS_INITOUT:
+    case STUBLESS_FREE:
+        /* base types don't need to be cleared or freed */
+        break;
+    case STUBLESS_CALCSIZE:
+        for (i = 0; i < proc->number_of_params; i++)
+        {
+            const struct base_arg *arg = &proc->args[i];
+            if ((arg->flags & BASE_ARG_SIMPLE_REF) && !*(unsigned char **)(pStubMsg->StackTop + arg->stack_offset))
+                RpcRaiseException( RPC_X_NULL_REF_POINTER );
+        }
+        if (!(pStubMsg->BufferLength & 7) && pStubMsg->BufferLength + proc->in_size >= proc->in_size)
+            pStubMsg->BufferLength += proc->in_size;
+        else
+        {
+            for (i = 0; i < proc->number_of_params; i++)
+                if (proc->args[i].flags & BASE_ARG_IN) base_arg_buffer_size( pStubMsg, &proc->args[i] );
+        }
+        break;
+    case STUBLESS_MARSHAL:
+        for (i = 0; i < proc->number_of_params; i++)
+        {
+            const struct base_arg *arg = &proc->args[i];
+            unsigned char *mem = pStubMsg->StackTop + arg->stack_offset;
+
+            if (!(arg->flags & BASE_ARG_IN)) continue;
+            if (arg->flags & BASE_ARG_SIMPLE_REF) mem = *(unsigned char **)mem;
+#ifdef __x86_64__  /* floats are passed as doubles through varargs functions */
+            else if ((arg->flags & BASE_ARG_FLOAT) && !fpu_args)
+            {
+                float f = *(double *)mem;
+                base_arg_marshal( pStubMsg, &f, sizeof(f) );
+                continue;
+            }
+#endif
+            base_arg_marshal( pStubMsg, mem, arg->size );
+        }
+        break;
+    case STUBLESS_UNMARSHAL:
+        for (i = 0; i < proc->number_of_params; i++)
+        {
+            const struct base_arg *arg = &proc->args[i];
+            unsigned char *mem = pStubMsg->StackTop + arg->stack_offset;
+
+            if (!(arg->flags & BASE_ARG_OUT)) continue;
+            if ((arg->flags & BASE_ARG_RETURN) && pRetVal) mem = pRetVal;
+            if (arg->flags & BASE_ARG_SIMPLE_REF) mem = *(unsigned char **)mem;
+            memcpy( mem, base_arg_unmarshal( pStubMsg, arg->size ), arg->size );
+        }
+        break;
+    default:
+        RpcRaiseException(RPC_S_INTERNAL_ERROR);
+    }
+}
+
+static inline void client_do_phase( PMIDL_STUB_MESSAGE pStubMsg, const struct base_proc *proc,
+                                    PFORMAT_STRING pFormat, enum stubless_phase phase, void **fpu_args,
+                                    unsigned short number_of_params, unsigned char *pRetVal )
+{
+    if (proc && (phase != STUBLESS_UNMARSHAL ||
+                 (pStubMsg->RpcMsg->DataRepresentation & 0x0000FFFFUL) == NDR_LOCAL_DATA_REPRESENTATION))
+        client_do_base_args( pStubMsg, proc, phase, fpu_args, pRetVal );
+    else
+        client_do_args( pStubMsg, pFormat, phase, fpu_args, number_of_params, pRetVal );
+}
+
 void client_do_args( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFormat, enum stubless_phase phase,
                      void **fpu_args, unsigned short number_of_params, unsigned char *pRetVal )
 {
@@ -619,6 +874,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     PFORMAT_STRING pHandleFormat;
     /* correlation cache */
     ULONG_PTR NdrCorrCache[256];
+    /* translated base type parameters, if the procedure only has those */
+    const struct base_proc *base_proc = NULL;
 
     TRACE("pStubDesc %p, pFormat %p, ...\n", pStubDesc, pFormat);
 
@@ -697,6 +954,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
             }
 #endif
         }
+
+        base_proc = get_base_proc(pFormat, number_of_params);
     }
     else
     {
@@ -745,16 +1004,16 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
         if (pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT)
         {
             TRACE( "INITOUT\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_INITOUT, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_INITOUT, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
         }
 
         __TRY
         {
             /* 2. CALCSIZE */
             TRACE( "CALCSIZE\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
 
             /* 3. GETBUFFER */
             TRACE( "GETBUFFER\n" );
@@ -784,8 +1043,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 4. MARSHAL */
             TRACE( "MARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
 
             /* 5. SENDRECEIVE */
             TRACE( "SENDRECEIVE\n" );
@@ -822,8 +1081,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 6. UNMARSHAL */
             TRACE( "UNMARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
         }
         __EXCEPT_ALL
         {
@@ -831,8 +1090,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
             {
                 /* 7. FREE */
                 TRACE( "FREE\n" );
-                client_do_args(&stubMsg, pFormat, STUBLESS_FREE, fpu_stack,
-                               number_of_params, (unsigned char *)&RetVal);
+                client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_FREE, fpu_stack,
+                                number_of_params, (unsigned char *)&RetVal);
                 RetVal = NdrProxyErrorHandler(GetExceptionCode());
             }
             else
@@ -867,8 +1126,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     {
         /* 2. CALCSIZE */
         TRACE( "CALCSIZE\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
 
         /* 3. GETBUFFER */
         TRACE( "GETBUFFER\n" );
@@ -889,8 +1148,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 4. MARSHAL */
         TRACE( "MARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
 
         /* 5. SENDRECEIVE */
         TRACE( "SENDRECEIVE\n" );
@@ -916,8 +1175,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 6. UNMARSHAL */
         TRACE( "UNMARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, base_proc, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
     }
 
     if (ext_flags.HasNewCorrDesc)
@@ -1179,6 +1438,64 @@ static LONG_PTR *stub_do_args(MIDL_STUB_MESSAGE *pStubMsg,
     return retval_ptr;
 }
 
+static LONG_PTR *stub_do_base_args( MIDL_STUB_MESSAGE *pStubMsg, const struct base_proc *proc,
+                                    enum stubless_phase phase )
+{
+    LONG_PTR *retval_ptr = NULL;
+    unsigned int i;
+
+    TRACE( "phase %d, %u base type params\n", phase, proc->number_of_params );
+
+    if (phase == STUBLESS_CALCSIZE)
+    {
+        if (!(pStubMsg->BufferLength & 7) && pStubMsg->BufferLength + proc->out_size >= proc->out_size)
+            pStubMsg->BufferLength += proc->out_size;
+        else
+        {
+            for (i = 0; i < proc->number_of_params; i++)
+                if (proc->args[i].flags & (BASE_ARG_OUT | BASE_ARG_RETURN))
+                    base_arg_buffer_size( pStubMsg, &proc->args[i] );
+        }
+    }
+
+    for (i = 0; i < proc->number_of_params; i++)
+    {
+        const struct base_arg *arg = &proc->args[i];
+        unsigned char *pArg = pStubMsg->StackTop + arg->stack_offset;
+
+        switch (phase)
+        {
+        case STUBLESS_UNMARSHAL:
+            if (arg->alloc_size)
+                *(void **)pArg = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, arg->alloc_size );
+            if (!(arg->flags & BASE_ARG_IN)) break;
+            if (!(arg->flags & BASE_ARG_SIMPLE_REF))
+                memcpy( pArg, base_arg_unmarshal( pStubMsg, arg->size ), arg->size );
+            else if (*(void **)pArg)
+                memcpy( *(void **)pArg, base_arg_unmarshal( pStubMsg, arg->size ), arg->size );
+            else  /* point directly into the buffer */
+                *(void **)pArg = base_arg_unmarshal( pStubMsg, arg->size );
+            break;
+        case STUBLESS_INITOUT:
+        case STUBLESS_CALCSIZE:
+            break;
+        case STUBLESS_MARSHAL:
+            if (!(arg->flags & (BASE_ARG_OUT | BASE_ARG_RETURN))) break;
+            base_arg_marshal( pStubMsg, (arg->flags & BASE_ARG_SIMPLE_REF) ? *(unsigned char **)pArg : pArg,
+                              arg->size );
+            break;
+        case STUBLESS_FREE:
+            if (arg->alloc_size) HeapFree( GetProcessHeap(), 0, *(void **)pArg );
+            break;
+        default:
+            RpcRaiseException(RPC_S_INTERNAL_ERROR);
+        }
+
+        if (arg->flags & BASE_ARG_RETURN) retval_ptr = (LONG_PTR *)pArg;
+    }
+    return retval_ptr;
+}
+
 /***********************************************************************
  *            NdrStubCall2 [RPCRT4.@]
  *
@@ -1214,6 +1531,8 @@ LONG WINAPI NdrStubCall2(
     const NDR_PROC_HEADER *pProcHeader;
     /* location to put retval into */
     LONG_PTR *retval_ptr = NULL;
+    /* translated base type parameters, if the procedure only has those */
+    const struct base_proc *base_proc = NULL;
     /* correlation cache */
     ULONG_PTR NdrCorrCache[256];
 
@@ -1351,6 +1670,8 @@ LONG WINAPI NdrStubCall2(
      * preferred format */
     if ((pRpcMsg->DataRepresentation & 0x0000FFFFUL) != NDR_LOCAL_DATA_REPRESENTATION)
         NdrConvert(&stubMsg, pFormat);
+    else if (pStubDesc->Version >= 0x20000)
+        base_proc = get_base_proc(pFormat, number_of_params);
 
     for (phase = STUBLESS_UNMARSHAL; phase <= STUBLESS_FREE; phase++)
     {
@@ -1410,7 +1731,10 @@ LONG WINAPI NdrStubCall2(
         case STUBLESS_CALCSIZE:
         case STUBLESS_MARSHAL:
         case STUBLESS_FREE:
-            retval_ptr = stub_do_args(&stubMsg, pFormat, phase, number_of_params);
+            if (base_proc)
+                retval_ptr = stub_do_base_args(&stubMsg, base_proc, phase);
+            else
+                retval_ptr = stub_do_args(&stubMsg, pFormat, phase, number_of_params);
             break;
         default:
             ERR("shouldn't reach here. phase %d\n", phase);
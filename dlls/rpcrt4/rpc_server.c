@@ -50,6 +50,8 @@ WINE_DEFAULT_DEBUG_CHANNEL(rpc);
 
 typedef struct _RpcPacket
 {
+  struct list entry; /* CS ::server_pool_cs */
+  RpcServerInterface *sif; /* interface of the call, if registered; holds a reference */
   struct _RpcConnection* conn;
   RpcPktHdr* hdr;
   RPC_MESSAGE* msg;
@@ -99,6 +101,35 @@ static CRITICAL_SECTION_DEBUG server_auth_info_cs_debug =
 };
 static CRITICAL_SECTION server_auth_info_cs = { &server_auth_info_cs_debug, -1, 0, 0, 0, 0 };
 
+static CRITICAL_SECTION server_pool_cs;
+static CRITICAL_SECTION_DEBUG server_pool_cs_debug =
+{
+    0, 0, &server_pool_cs,
+    { &server_pool_cs_debug.ProcessLocksList, &server_pool_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": server_pool_cs") }
+};
+static CRITICAL_SECTION server_pool_cs = { &server_pool_cs_debug, -1, 0, 0, 0, 0 };
+
+/* how long an idle worker thread waits for a new request before exiting */
+#define SERVER_POOL_IDLE_TIMEOUT 30000
+
+/* request packets that can be dispatched right away, CS server_pool_cs */
+static struct list server_packets = LIST_INIT(server_packets);
+/* request packets for interfaces served by RpcServerListen, CS server_pool_cs */
+static struct list server_listen_packets = LIST_INIT(server_listen_packets);
+/* released once for each idle worker thread that is handed new work */
+static HANDLE server_pool_semaphore;
+/* number of worker threads and number of those waiting for work, CS server_pool_cs */
+static UINT server_pool_threads;
+static UINT server_pool_idle;
+/* number of queued and executing calls for interfaces served by
+ * RpcServerListen, CS server_pool_cs */
+static UINT server_listen_queued;
+static UINT server_listen_calls;
+/* limits set by RpcServerListen, CS server_pool_cs */
+static UINT server_pool_min_threads = 1;
+static UINT server_listen_max_calls = RPC_C_LISTEN_MAX_CALLS_DEFAULT;
+
 /* whether the server is currently listening */
 static BOOL std_listen;
 /* number of manual listeners (calls to RpcServerListen) */
@@ -535,16 +566,186 @@ static void RPCRT4_process_packet(RpcConnection* conn, RpcPktHdr* hdr,
   HeapFree(GetProcessHeap(), 0, auth_data);
 }
 
+/* Returns the interface the connection is bound to, with a reference held. */
+static RpcServerInterface *RPCRT4_packet_interface(RpcConnection *conn)
+{
+  RpcServerInterface *cif;
+
+  EnterCriticalSection(&server_cs);
+  LIST_FOR_EACH_ENTRY(cif, &server_interfaces, RpcServerInterface, entry) {
+    if (!memcmp(&conn->ActiveInterface, &cif->If->InterfaceId, sizeof(RPC_SYNTAX_IDENTIFIER))) {
+      InterlockedIncrement(&cif->CurrentCalls);
+      LeaveCriticalSection(&server_cs);
+      return cif;
+    }
+  }
+  LeaveCriticalSection(&server_cs);
+  return NULL;
+}
+
+static inline BOOL is_listen_packet(const RpcPacket *pkt)
+{
+  return pkt->sif && !(pkt->sif->Flags & RPC_IF_AUTOLISTEN);
+}
+
+/* Takes the next packet a worker thread may execute. Packets for
+ * auto-listen interfaces are never held back by the RpcServerListen limit,
+ * so that calls made while executing another call can't wait for a thread
+ * their caller occupies. Must be called with server_pool_cs held. */
+static RpcPacket *RPCRT4_next_packet(void)
+{
+  struct list *ptr;
+
+  if ((ptr = list_head(&server_packets))) {
+    list_remove(ptr);
+    return LIST_ENTRY(ptr, RpcPacket, entry);
+  }
+
+  if (server_listen_calls < server_listen_max_calls &&
+      (ptr = list_head(&server_listen_packets))) {
+    list_remove(ptr);
+    server_listen_queued--;
+    server_listen_calls++;
+    return LIST_ENTRY(ptr, RpcPacket, entry);
+  }
+
+  return NULL;
+}
+
+/* Gives the call slot of a finished packet to the next deferred packet of
+ * the same interface. Must be called with server_pool_cs held. */
+static void RPCRT4_release_call(RpcPacket *pkt)
+{
+  struct list *ptr;
+
+  if (!pkt->sif) return;
+
+  if (is_listen_packet(pkt)) {
+    server_listen_calls--;
+    return;
+  }
+
+  if ((ptr = list_head(&pkt->sif->PendingPackets))) {
+    /* the calling worker thread picks it up next */
+    list_remove(ptr);
+    list_add_tail(&server_packets, ptr);
+  }
+  else
+    pkt->sif->DispatchedCalls--;
+}
+
 static DWORD CALLBACK RPCRT4_worker_thread(LPVOID the_arg)
 {
-  RpcPacket *pkt = the_arg;
-  RPCRT4_process_packet(pkt->conn, pkt->hdr, pkt->msg, pkt->auth_data,
-                        pkt->auth_length);
-  RPCRT4_ReleaseConnection(pkt->conn);
-  HeapFree(GetProcessHeap(), 0, pkt);
+  RpcPacket *pkt;
+  DWORD ret;
+
+  EnterCriticalSection(&server_pool_cs);
+
+  for (;;) {
+    pkt = RPCRT4_next_packet();
+    if (pkt) {
+      LeaveCriticalSection(&server_pool_cs);
+
+      RPCRT4_process_packet(pkt->conn, pkt->hdr, pkt->msg, pkt->auth_data,
+                            pkt->auth_length);
+
+      EnterCriticalSection(&server_pool_cs);
+      RPCRT4_release_call(pkt);
+      LeaveCriticalSection(&server_pool_cs);
+
+      if (pkt->sif) RPCRT4_release_server_interface(pkt->sif);
+      RPCRT4_ReleaseConnection(pkt->conn);
+      HeapFree(GetProcessHeap(), 0, pkt);
+
+      EnterCriticalSection(&server_pool_cs);
+      continue;
+    }
+
+    server_pool_idle++;
+    LeaveCriticalSection(&server_pool_cs);
+
+    ret = WaitForSingleObject(server_pool_semaphore, SERVER_POOL_IDLE_TIMEOUT);
+
+    EnterCriticalSection(&server_pool_cs);
+    if (ret != WAIT_OBJECT_0) {
+      /* RPCRT4_queue_packet may have claimed us after the wait timed out */
+      if (WaitForSingleObject(server_pool_semaphore, 0) == WAIT_OBJECT_0)
+        continue;
+
+      server_pool_idle--;
+      if (server_pool_threads > server_pool_min_threads)
+        break;
+    }
+  }
+
+  server_pool_threads--;
+  LeaveCriticalSection(&server_pool_cs);
+
+  TRACE("worker thread exiting\n");
   return 0;
 }
 
+static BOOL RPCRT4_queue_packet(RpcPacket *packet)
+{
+  RpcServerInterface *sif = RPCRT4_packet_interface(packet->conn);
+  BOOL runnable = TRUE;
+  HANDLE thread;
+
+  packet->sif = sif;
+
+  EnterCriticalSection(&server_pool_cs);
+
+  if (!server_pool_semaphore)
+    server_pool_semaphore = CreateSemaphoreW(NULL, 0, MAXLONG, NULL);
+  if (!server_pool_semaphore)
+    goto fail;
+
+  if (is_listen_packet(packet)) {
+    list_add_tail(&server_listen_packets, &packet->entry);
+    server_listen_queued++;
+    /* packets beyond the limit are picked up when a call finishes */
+    runnable = server_listen_queued + server_listen_calls <= server_listen_max_calls;
+  }
+  else if (sif && sif->DispatchedCalls >= max(sif->MaxCalls, 1)) {
+    list_add_tail(&sif->PendingPackets, &packet->entry);
+    runnable = FALSE;
+  }
+  else {
+    if (sif) sif->DispatchedCalls++;
+    list_add_tail(&server_packets, &packet->entry);
+  }
+
+  if (!runnable)
+    TRACE("too many calls for connection %p, deferring packet %p\n", packet->conn, packet);
+  else if (server_pool_idle) {
+    /* hand the packet to an idle worker thread */
+    server_pool_idle--;
+    ReleaseSemaphore(server_pool_semaphore, 1, NULL);
+  }
+  else if ((thread = CreateThread(NULL, 0, RPCRT4_worker_thread, NULL, 0, NULL))) {
+    server_pool_threads++;
+    CloseHandle(thread);
+  }
+  else if (!server_pool_threads) {
+    /* nobody would ever pick it up */
+    list_remove(&packet->entry);
+    if (is_listen_packet(packet))
+      server_listen_queued--;
+    else if (sif)
+      sif->DispatchedCalls--;
+    goto fail;
+  }
+  /* otherwise one of the busy worker threads will pick it up */
+
+  LeaveCriticalSection(&server_pool_cs);
+  return TRUE;
+
+fail:
+  LeaveCriticalSection(&server_pool_cs);
+  if (sif) RPCRT4_release_server_interface(sif);
+  return FALSE;
+}
+
 static DWORD CALLBACK RPCRT4_io_thread(LPVOID the_arg)
 {
   RpcConnection* conn = the_arg;
@@ -592,8 +793,9 @@ static DWORD CALLBACK RPCRT4_io_thread(LPVOID the_arg)
       packet->msg = msg;
       packet->auth_data = auth_data;
       packet->auth_length = auth_length;
-      if (!QueueUserWorkItem(RPCRT4_worker_thread, packet, WT_EXECUTELONGFUNCTION)) {
-        ERR("couldn't queue work item for worker thread, error was %d\n", GetLastError());
+      if (!RPCRT4_queue_packet(packet)) {
+        ERR("couldn't queue packet for worker thread, error was %d\n", GetLastError());
+        RPCRT4_ReleaseConnection(packet->conn);
         HeapFree(GetProcessHeap(), 0, packet);
         status = RPC_S_OUT_OF_RESOURCES;
       } else {
@@ -1146,6 +1348,7 @@ RPC_STATUS WINAPI RpcServerRegisterIf2( RPC_IF_HANDLE IfSpec, UUID* MgrTypeUuid,
   sif->MaxCalls     = MaxCalls;
   sif->MaxRpcSize   = MaxRpcSize;
   sif->IfCallbackFn = IfCallbackFn;
+  list_init(&sif->PendingPackets);
 
   EnterCriticalSection(&server_cs);
   list_add_head(&server_interfaces, &sif->entry);
@@ -1509,6 +1712,11 @@ RPC_STATUS WINAPI RpcServerListen( UINT MinimumCallThreads, UINT MaxCalls, UINT
   if (list_empty(&protseqs))
     return RPC_S_NO_PROTSEQS_REGISTERED;
 
+  EnterCriticalSection(&server_pool_cs);
+  server_listen_max_calls = max(MaxCalls, 1);
+  server_pool_min_threads = min(max(MinimumCallThreads, 1), server_listen_max_calls);
+  LeaveCriticalSection(&server_pool_cs);
+
   status = RPCRT4_start_listen(FALSE);
 
   if (DontWait || (status != RPC_S_OK)) return status;
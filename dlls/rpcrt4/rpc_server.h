@@ -70,6 +70,8 @@ typedef struct _RpcServerInterface
   UINT MaxRpcSize;
   RPC_IF_CALLBACK_FN* IfCallbackFn;
   LONG CurrentCalls; /* number of calls currently executing */
+  UINT DispatchedCalls; /* CS ::server_pool_cs, number of requests handed to worker threads */
+  struct list PendingPackets; /* CS ::server_pool_cs, requests deferred because of MaxCalls */
   /* set when unregistering interface to let the caller of
    * RpcServerUnregisterIf* know that all calls have finished */
   HANDLE CallsCompletedEvent;
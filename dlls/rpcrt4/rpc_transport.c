@@ -82,6 +82,7 @@
 #include "winerror.h"
 #include "wininet.h"
 #include "winternl.h"
+#include "ntsecapi.h"
 #include "wine/unicode.h"
 
 #include "rpc.h"
@@ -121,6 +122,21 @@ static RpcConnection *rpcrt4_conn_np_alloc(void)
   return &npc->common;
 }
 
+struct lrpc_shm;
+
+typedef struct _RpcConnection_lrpc
+{
+  RpcConnection_np np;
+  struct lrpc_shm *shm; /* shared memory rings, if the client asked for them */
+  BOOL negotiated; /* server-only: whether the client had its chance to ask */
+} RpcConnection_lrpc;
+
+static RpcConnection *rpcrt4_ncalrpc_alloc(void)
+{
+  RpcConnection_lrpc *lrpc = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(RpcConnection_lrpc));
+  return &lrpc->np.common;
+}
+
 static DWORD CALLBACK listen_thread(void *arg)
 {
   RpcConnection_np *npc = arg;
@@ -244,6 +260,477 @@ static RPC_STATUS rpcrt4_conn_open_pipe(RpcConnection *Connection, LPCSTR pname,
   return RPC_S_OK;
 }
 
+/**** ncalrpc shared memory support ****/
+
+/* Once a local connection is established, the client can ask the server to
+ * move the traffic of the connection to a pair of byte rings in shared
+ * memory.  The packets written to the rings are the same as on the pipe.
+ * The pipe is kept open for impersonation and to notice the other side
+ * going away.  Events are only signalled when the other side has said that
+ * it is waiting, so a busy connection doesn't need any server calls.
+ *
+ * The section and its events are unnamed.  The server creates them and
+ * duplicates them into the process the client says it is, then proves that
+ * this really is the process at the other end of the pipe: it puts a random
+ * cookie in the section, and the client has to send it back on the pipe
+ * before either side switches over.
+ *
+ * Once they have been sent, the handles belong to the client, which closes
+ * them itself if anything goes wrong; it sends a zeroed cookie if it can't
+ * use them.  The server only closes them in the client when the reply
+ * couldn't be sent, or when the cookie sent back proves that the pipe
+ * client isn't the process they were given to. */
+
+#define LRPC_SHM_MAGIC     0x4d485357 /* "WSHM" */
+#define LRPC_SHM_RING_SIZE 0x10000
+#define LRPC_SHM_POLL      1000 /* ms between checks of the pipe while waiting */
+
+/* sent by the client as a separate pipe message before any packet */
+struct lrpc_shm_request
+{
+  DWORD magic;
+  DWORD pid;
+  DWORD reserved;
+  DWORD ring_size;
+};
+
+/* must be the size of the first read of a packet, see rpcrt4_ncalrpc_read */
+C_ASSERT(sizeof(struct lrpc_shm_request) == sizeof(RpcPktCommonHdr));
+
+/* the server's answer, ring_size is 0 if it declines; the handles are
+ * valid in the client process */
+struct lrpc_shm_reply
+{
+  DWORD magic;
+  DWORD ring_size;
+  DWORD mapping;
+  DWORD events[4];
+};
+
+/* sent by the client with the cookie found in the section, or zeroed if it
+ * couldn't map it, and echoed by the server if it matches or sent back
+ * zeroed if it doesn't */
+struct lrpc_shm_confirm
+{
+  DWORD magic;
+  DWORD cookie[4];
+};
+
+struct lrpc_ring
+{
+  volatile LONG head; /* bytes written by the producer */
+  volatile LONG tail; /* bytes read by the consumer */
+  volatile LONG reader_waiting;
+  volatile LONG writer_waiting;
+  volatile LONG closed; /* the producer closed the connection */
+  DWORD cookie[4]; /* first ring only, see above */
+  LONG pad[7];
+  BYTE data[LRPC_SHM_RING_SIZE];
+};
+
+struct lrpc_shm
+{
+  HANDLE mapping;
+  /* client to server ring, then server to client ring */
+  struct lrpc_ring *rings;
+  /* data and space events of each ring */
+  HANDLE events[4];
+  CRITICAL_SECTION write_cs;
+};
+
+#define LRPC_DATA_EVENT(ring)  ((ring) * 2)
+#define LRPC_SPACE_EVENT(ring) ((ring) * 2 + 1)
+
+static BOOL lrpc_shm_enabled(void)
+{
+  static const WCHAR rpc_keyW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','R','p','c',0};
+  static const WCHAR shared_memoryW[] = {'S','h','a','r','e','d','M','e','m','o','r','y',0};
+  static LONG enabled = -1;
+
+  if (enabled == -1)
+  {
+    WCHAR buffer[8];
+    DWORD type, size = sizeof(buffer);
+    LONG value = FALSE;
+    HKEY key;
+
+    if (!RegOpenKeyW(HKEY_CURRENT_USER, rpc_keyW, &key))
+    {
+      if (!RegQueryValueExW(key, shared_memoryW, NULL, &type, (BYTE *)buffer, &size) && type == REG_SZ)
+        value = (buffer[0] == 'y' || buffer[0] == 'Y' || buffer[0] == 't' || buffer[0] == 'T' || buffer[0] == '1');
+      RegCloseKey(key);
+    }
+    TRACE("shared memory transport %s\n", value ? "enabled" : "disabled");
+    enabled = value;
+  }
+  return enabled;
+}
+
+static void lrpc_shm_free(struct lrpc_shm *shm)
+{
+  unsigned int i;
+
+  for (i = 0; i < sizeof(shm->events) / sizeof(shm->events[0]); i++)
+    if (shm->events[i]) CloseHandle(shm->events[i]);
+  if (shm->rings) UnmapViewOfFile(shm->rings);
+  if (shm->mapping) CloseHandle(shm->mapping);
+  shm->write_cs.DebugInfo->Spare[0] = 0;
+  DeleteCriticalSection(&shm->write_cs);
+  HeapFree(GetProcessHeap(), 0, shm);
+}
+
+static struct lrpc_shm *lrpc_shm_alloc(void)
+{
+  struct lrpc_shm *shm;
+
+  shm = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*shm));
+  if (!shm) return NULL;
+  InitializeCriticalSection(&shm->write_cs);
+  shm->write_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": lrpc_shm.write_cs");
+  return shm;
+}
+
+static BOOL lrpc_shm_map(struct lrpc_shm *shm)
+{
+  shm->rings = MapViewOfFile(shm->mapping, FILE_MAP_WRITE, 0, 0, 2 * sizeof(struct lrpc_ring));
+  if (!shm->rings)
+  {
+    WARN("couldn't map rings, error %u\n", GetLastError());
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* server side: creates the section and events */
+static struct lrpc_shm *lrpc_shm_create(void)
+{
+  struct lrpc_shm *shm;
+  unsigned int i;
+
+  if (!(shm = lrpc_shm_alloc())) return NULL;
+
+  shm->mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                    2 * sizeof(struct lrpc_ring), NULL);
+  if (!shm->mapping || !lrpc_shm_map(shm))
+  {
+    lrpc_shm_free(shm);
+    return NULL;
+  }
+
+  for (i = 0; i < sizeof(shm->events) / sizeof(shm->events[0]); i++)
+  {
+    if (!(shm->events[i] = CreateEventW(NULL, FALSE, FALSE, NULL)))
+    {
+      lrpc_shm_free(shm);
+      return NULL;
+    }
+  }
+
+  return shm;
+}
+
+/* client side: takes ownership of the handles the server gave us */
+static struct lrpc_shm *lrpc_shm_attach(const struct lrpc_shm_reply *reply)
+{
+  struct lrpc_shm *shm;
+  unsigned int i;
+
+  if (!(shm = lrpc_shm_alloc()))
+  {
+    CloseHandle(ULongToHandle(reply->mapping));
+    for (i = 0; i < sizeof(reply->events) / sizeof(reply->events[0]); i++)
+      CloseHandle(ULongToHandle(reply->events[i]));
+    return NULL;
+  }
+
+  shm->mapping = ULongToHandle(reply->mapping);
+  for (i = 0; i < sizeof(shm->events) / sizeof(shm->events[0]); i++)
+    shm->events[i] = ULongToHandle(reply->events[i]);
+
+  if (!lrpc_shm_map(shm))
+  {
+    lrpc_shm_free(shm);
+    return NULL;
+  }
+  return shm;
+}
+
+static inline LONG lrpc_load(volatile LONG *value)
+{
+  return InterlockedCompareExchange(value, 0, 0);
+}
+
+/* waits until *pos isn't value anymore, returns FALSE if the other side went away */
+static BOOL lrpc_shm_wait(RpcConnection_lrpc *lrpc, volatile LONG *waiting, volatile LONG *pos,
+                          LONG value, HANDLE event, volatile LONG *closed)
+{
+  for (;;)
+  {
+    InterlockedExchange(waiting, 1);
+    if (lrpc_load(pos) != value) return TRUE;
+    if (*closed) return FALSE;
+    if (WaitForSingleObject(event, LRPC_SHM_POLL) == WAIT_TIMEOUT &&
+        !PeekNamedPipe(lrpc->np.pipe, NULL, 0, NULL, NULL, NULL))
+    {
+      WARN("pipe closed while waiting, error %u\n", GetLastError());
+      return FALSE;
+    }
+  }
+}
+
+static int lrpc_shm_read(RpcConnection_lrpc *lrpc, void *buffer, unsigned int count)
+{
+  struct lrpc_shm *shm = lrpc->shm;
+  unsigned int r = lrpc->np.common.server ? 0 : 1;
+  struct lrpc_ring *ring = &shm->rings[r];
+  unsigned char *buf = buffer;
+  unsigned int bytes_left = count;
+
+  while (bytes_left)
+  {
+    ULONG tail = ring->tail, avail = (ULONG)lrpc_load(&ring->head) - tail, pos, len;
+
+    if (avail > LRPC_SHM_RING_SIZE)
+    {
+      ERR("corrupted ring, head %x tail %x\n", ring->head, tail);
+      return -1;
+    }
+    if (!avail)
+    {
+      if (!lrpc_shm_wait(lrpc, &ring->reader_waiting, &ring->head, tail,
+                         shm->events[LRPC_DATA_EVENT(r)], &ring->closed))
+        return -1;
+      continue;
+    }
+
+    pos = tail % LRPC_SHM_RING_SIZE;
+    len = min(min(avail, bytes_left), LRPC_SHM_RING_SIZE - pos);
+    memcpy(buf, ring->data + pos, len);
+    buf += len;
+    bytes_left -= len;
+
+    InterlockedExchangeAdd(&ring->tail, len);
+    if (ring->writer_waiting && InterlockedExchange(&ring->writer_waiting, 0))
+      SetEvent(shm->events[LRPC_SPACE_EVENT(r)]);
+  }
+  return count;
+}
+
+static int lrpc_shm_write(RpcConnection_lrpc *lrpc, const void *buffer, unsigned int count)
+{
+  struct lrpc_shm *shm = lrpc->shm;
+  unsigned int w = lrpc->np.common.server ? 1 : 0;
+  struct lrpc_ring *ring = &shm->rings[w];
+  const unsigned char *buf = buffer;
+  unsigned int bytes_left = count;
+  int ret = count;
+
+  /* packets written by different threads must not be interleaved */
+  EnterCriticalSection(&shm->write_cs);
+
+  while (bytes_left)
+  {
+    ULONG head = ring->head, tail = lrpc_load(&ring->tail);
+    ULONG space = LRPC_SHM_RING_SIZE - (head - tail), pos, len;
+
+    if (head - tail > LRPC_SHM_RING_SIZE)
+    {
+      ERR("corrupted ring, head %x tail %x\n", head, tail);
+      ret = -1;
+      break;
+    }
+    if (!space)
+    {
+      if (!lrpc_shm_wait(lrpc, &ring->writer_waiting, &ring->tail, tail,
+                         shm->events[LRPC_SPACE_EVENT(w)], &shm->rings[!w].closed))
+      {
+        ret = -1;
+        break;
+      }
+      continue;
+    }
+
+    pos = head % LRPC_SHM_RING_SIZE;
+    len = min(min(space, bytes_left), LRPC_SHM_RING_SIZE - pos);
+    memcpy(ring->data + pos, buf, len);
+    buf += len;
+    bytes_left -= len;
+
+    InterlockedExchangeAdd(&ring->head, len);
+    if (ring->reader_waiting && InterlockedExchange(&ring->reader_waiting, 0))
+      SetEvent(shm->events[LRPC_DATA_EVENT(w)]);
+  }
+
+  LeaveCriticalSection(&shm->write_cs);
+  return ret;
+}
+
+static void lrpc_shm_close(RpcConnection_lrpc *lrpc)
+{
+  struct lrpc_shm *shm = lrpc->shm;
+  unsigned int w = lrpc->np.common.server ? 1 : 0;
+
+  /* wake up the other side if it is waiting for data from us or for
+   * space in the ring we read from */
+  InterlockedExchange(&shm->rings[w].closed, 1);
+  SetEvent(shm->events[LRPC_DATA_EVENT(w)]);
+  SetEvent(shm->events[LRPC_SPACE_EVENT(!w)]);
+
+  lrpc_shm_free(shm);
+  lrpc->shm = NULL;
+}
+
+static void rpcrt4_ncalrpc_request_shm(RpcConnection_lrpc *lrpc)
+{
+  struct lrpc_shm_request request;
+  struct lrpc_shm_reply reply;
+  struct lrpc_shm_confirm confirm, ack;
+  struct lrpc_shm *shm;
+  DWORD count;
+
+  if (!lrpc_shm_enabled()) return;
+
+  request.magic = LRPC_SHM_MAGIC;
+  request.pid = GetCurrentProcessId();
+  request.reserved = 0;
+  request.ring_size = LRPC_SHM_RING_SIZE;
+
+  if (!WriteFile(lrpc->np.pipe, &request, sizeof(request), &count, NULL) || count != sizeof(request) ||
+      !ReadFile(lrpc->np.pipe, &reply, sizeof(reply), &count, NULL) || count != sizeof(reply) ||
+      reply.magic != LRPC_SHM_MAGIC || reply.ring_size != LRPC_SHM_RING_SIZE)
+  {
+    TRACE("server declined shared memory\n");
+    return;
+  }
+
+  /* the server waits for the cookie even if we couldn't map the section */
+  memset(&confirm, 0, sizeof(confirm));
+  confirm.magic = LRPC_SHM_MAGIC;
+  if ((shm = lrpc_shm_attach(&reply)))
+    memcpy(confirm.cookie, shm->rings[0].cookie, sizeof(confirm.cookie));
+
+  if (WriteFile(lrpc->np.pipe, &confirm, sizeof(confirm), &count, NULL) && count == sizeof(confirm) &&
+      ReadFile(lrpc->np.pipe, &ack, sizeof(ack), &count, NULL) && count == sizeof(ack) &&
+      shm && !memcmp(&ack, &confirm, sizeof(ack)))
+  {
+    TRACE("using shared memory\n");
+    lrpc->shm = shm;
+    return;
+  }
+
+  WARN("shared memory setup failed\n");
+  if (shm) lrpc_shm_free(shm);
+}
+
+/* closes the handles we duplicated into a process that turned out not to be the client */
+static void lrpc_shm_close_remote(HANDLE process, const struct lrpc_shm_reply *reply)
+{
+  unsigned int i;
+
+  DuplicateHandle(process, ULongToHandle(reply->mapping), NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+  for (i = 0; i < sizeof(reply->events) / sizeof(reply->events[0]); i++)
+    DuplicateHandle(process, ULongToHandle(reply->events[i]), NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+}
+
+static BOOL lrpc_shm_give_handles(HANDLE process, struct lrpc_shm *shm, struct lrpc_shm_reply *reply)
+{
+  HANDLE handle;
+  unsigned int i;
+
+  memset(reply, 0, sizeof(*reply));
+  reply->magic = LRPC_SHM_MAGIC;
+
+  if (!DuplicateHandle(GetCurrentProcess(), shm->mapping, process, &handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    return FALSE;
+  reply->mapping = HandleToULong(handle);
+
+  for (i = 0; i < sizeof(shm->events) / sizeof(shm->events[0]); i++)
+  {
+    if (!DuplicateHandle(GetCurrentProcess(), shm->events[i], process, &handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+      lrpc_shm_close_remote(process, reply);
+      memset(reply, 0, sizeof(*reply));
+      reply->magic = LRPC_SHM_MAGIC;
+      return FALSE;
+    }
+    reply->events[i] = HandleToULong(handle);
+  }
+
+  reply->ring_size = LRPC_SHM_RING_SIZE;
+  return TRUE;
+}
+
+static void rpcrt4_ncalrpc_accept_shm(RpcConnection_lrpc *lrpc, const struct lrpc_shm_request *request)
+{
+  struct lrpc_shm_reply reply;
+  struct lrpc_shm_confirm confirm, ack;
+  struct lrpc_shm *shm = NULL;
+  HANDLE process = NULL;
+  DWORD count;
+
+  memset(&reply, 0, sizeof(reply));
+  reply.magic = LRPC_SHM_MAGIC;
+
+  memset(&ack, 0, sizeof(ack));
+  ack.magic = LRPC_SHM_MAGIC;
+  RtlGenRandom(ack.cookie, sizeof(ack.cookie));
+  ack.cookie[0] |= 1; /* a zeroed cookie means the client declined */
+
+  if (request->ring_size == LRPC_SHM_RING_SIZE &&
+      (process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, request->pid)) &&
+      (shm = lrpc_shm_create()))
+  {
+    memcpy(shm->rings[0].cookie, ack.cookie, sizeof(ack.cookie));
+    if (!lrpc_shm_give_handles(process, shm, &reply))
+    {
+      lrpc_shm_free(shm);
+      shm = NULL;
+    }
+  }
+
+  if (!WriteFile(lrpc->np.pipe, &reply, sizeof(reply), &count, NULL) || count != sizeof(reply))
+  {
+    /* the client never saw the handles */
+    if (shm) lrpc_shm_close_remote(process, &reply);
+    goto failed;
+  }
+  if (!shm)
+  {
+    TRACE("declined shared memory for process %04x\n", request->pid);
+    goto done;
+  }
+
+  /* only the process at the other end of the pipe can know the cookie */
+  if (!ReadFile(lrpc->np.pipe, &confirm, sizeof(confirm), &count, NULL) || count != sizeof(confirm))
+    goto failed;
+  if (memcmp(&confirm, &ack, sizeof(confirm)))
+  {
+    if (confirm.cookie[0] || confirm.cookie[1] || confirm.cookie[2] || confirm.cookie[3])
+    {
+      WARN("process %04x isn't the pipe client\n", request->pid);
+      lrpc_shm_close_remote(process, &reply);
+    }
+    else
+      TRACE("process %04x couldn't use shared memory\n", request->pid);
+    memset(&ack, 0, sizeof(ack));
+    WriteFile(lrpc->np.pipe, &ack, sizeof(ack), &count, NULL);
+    goto failed;
+  }
+  if (!WriteFile(lrpc->np.pipe, &ack, sizeof(ack), &count, NULL) || count != sizeof(ack))
+    goto failed;
+
+  TRACE("using shared memory with process %04x\n", request->pid);
+  memset(shm->rings[0].cookie, 0, sizeof(shm->rings[0].cookie));
+  lrpc->shm = shm;
+  goto done;
+
+failed:
+  /* the handles in the client are its own to close */
+  if (shm) lrpc_shm_free(shm);
+done:
+  if (process) CloseHandle(process);
+}
+
 static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
 {
   RpcConnection_np *npc = (RpcConnection_np *) Connection;
@@ -262,6 +749,9 @@ static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
   r = rpcrt4_conn_open_pipe(Connection, pname, TRUE);
   I_RpcFree(pname);
 
+  if (r == RPC_S_OK)
+    rpcrt4_ncalrpc_request_shm((RpcConnection_lrpc *)Connection);
+
   return r;
 }
 
@@ -474,6 +964,52 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+static int rpcrt4_ncalrpc_read(RpcConnection *Connection,
+                               void *buffer, unsigned int count)
+{
+  RpcConnection_lrpc *lrpc = (RpcConnection_lrpc *)Connection;
+  int ret;
+
+  if (lrpc->shm)
+    return lrpc_shm_read(lrpc, buffer, count);
+
+  ret = rpcrt4_conn_np_read(Connection, buffer, count);
+
+  /* the first read of a connection is for a packet header, which is the
+   * same size as a shared memory request */
+  if (Connection->server && !lrpc->negotiated)
+  {
+    const struct lrpc_shm_request *request = buffer;
+
+    lrpc->negotiated = TRUE;
+    if (ret == sizeof(*request) && request->magic == LRPC_SHM_MAGIC)
+    {
+      rpcrt4_ncalrpc_accept_shm(lrpc, request);
+      return rpcrt4_ncalrpc_read(Connection, buffer, count);
+    }
+  }
+  return ret;
+}
+
+static int rpcrt4_ncalrpc_write(RpcConnection *Connection,
+                                const void *buffer, unsigned int count)
+{
+  RpcConnection_lrpc *lrpc = (RpcConnection_lrpc *)Connection;
+
+  if (lrpc->shm)
+    return lrpc_shm_write(lrpc, buffer, count);
+  return rpcrt4_conn_np_write(Connection, buffer, count);
+}
+
+static int rpcrt4_ncalrpc_close(RpcConnection *Connection)
+{
+  RpcConnection_lrpc *lrpc = (RpcConnection_lrpc *)Connection;
+
+  if (lrpc->shm)
+    lrpc_shm_close(lrpc);
+  return rpcrt4_conn_np_close(Connection);
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -2766,12 +3302,12 @@ static const struct connection_ops conn_protseq_list[] = {
   },
   { "ncalrpc",
     { EPM_PROTOCOL_NCALRPC, EPM_PROTOCOL_PIPE },
-    rpcrt4_conn_np_alloc,
+    rpcrt4_ncalrpc_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
+    rpcrt4_ncalrpc_read,
+    rpcrt4_ncalrpc_write,
+    rpcrt4_ncalrpc_close,
     rpcrt4_conn_np_cancel_call,
     rpcrt4_conn_np_wait_for_incoming_data,
     rpcrt4_ncalrpc_get_top_of_tower,
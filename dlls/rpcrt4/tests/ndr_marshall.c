@@ -1492,6 +1492,117 @@ static void test_conformant_array(void)
     HeapFree(GetProcessHeap(), 0, StubMsg.RpcMsg->Buffer);
 }
 
+static void test_conf_varying_array(void)
+{
+    RPC_MESSAGE RpcMessage;
+    MIDL_STUB_MESSAGE StubMsg;
+    MIDL_STUB_DESC StubDesc;
+    unsigned char *mem;
+    unsigned char memsrc[16];
+    unsigned int i;
+
+    static const unsigned char fmtstr_cvarray[] =
+    {
+        0x1c,              /* FC_CVARRAY */
+        0x0,               /* align */
+        NdrFcShort( 0x1 ), /* elem size */
+        0x40,              /* Corr desc:  const */
+        0x0,
+        NdrFcShort(0x10),  /* const = 0x10 */
+        0x40,              /* Corr desc:  const */
+        0x0,
+        NdrFcShort(0x10),  /* const = 0x10 */
+        0x1,               /* FC_BYTE */
+        0x5b               /* FC_END */
+    };
+    static const unsigned char fmtstr_cvarray_partial[] =
+    {
+        0x1c,              /* FC_CVARRAY */
+        0x0,               /* align */
+        NdrFcShort( 0x1 ), /* elem size */
+        0x40,              /* Corr desc:  const */
+        0x0,
+        NdrFcShort(0x10),  /* const = 0x10 */
+        0x40,              /* Corr desc:  const */
+        0x0,
+        NdrFcShort(0x8),   /* const = 0x8 */
+        0x1,               /* FC_BYTE */
+        0x5b               /* FC_END */
+    };
+
+    for (i = 0; i < sizeof(memsrc); i++)
+        memsrc[i] = i * i;
+
+    /* the whole array is transmitted */
+    StubDesc = Object_StubDesc;
+    StubDesc.pFormatTypes = fmtstr_cvarray;
+
+    NdrClientInitializeNew(&RpcMessage, &StubMsg, &StubDesc, 0);
+
+    StubMsg.BufferLength = 0;
+    NdrConformantVaryingArrayBufferSize(&StubMsg, memsrc, fmtstr_cvarray);
+    ok(StubMsg.BufferLength >= 28, "length %d\n", StubMsg.BufferLength);
+
+    StubMsg.RpcMsg->Buffer = StubMsg.BufferStart = StubMsg.Buffer = HeapAlloc(GetProcessHeap(), 0, StubMsg.BufferLength);
+    StubMsg.BufferEnd = StubMsg.BufferStart + StubMsg.BufferLength;
+
+    NdrConformantVaryingArrayMarshall(&StubMsg, memsrc, fmtstr_cvarray);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 28, "Buffer %p Start %p len %d\n",
+       StubMsg.Buffer, StubMsg.BufferStart, (int)(StubMsg.Buffer - StubMsg.BufferStart));
+    ok(!memcmp(StubMsg.BufferStart + 12, memsrc, 16), "incorrectly marshaled\n");
+
+    /* Server */
+    my_alloc_called = 0;
+    StubMsg.IsClient = 0;
+    mem = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    NdrConformantVaryingArrayUnmarshall(&StubMsg, &mem, fmtstr_cvarray, 0);
+    ok(mem == StubMsg.BufferStart + 12 || broken(mem != NULL),
+       "mem not pointing at buffer %p/%p\n", mem, StubMsg.BufferStart + 12);
+    ok(my_alloc_called == 0 || broken(my_alloc_called == 1), "alloc called %d\n", my_alloc_called);
+    ok(!memcmp(mem, memsrc, 16), "incorrectly unmarshaled\n");
+    if (mem != StubMsg.BufferStart + 12) StubMsg.pfnFree(mem);
+
+    my_alloc_called = 0;
+    mem = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    NdrConformantVaryingArrayUnmarshall(&StubMsg, &mem, fmtstr_cvarray, 1);
+    ok(mem != StubMsg.BufferStart + 12, "mem pointing at buffer\n");
+    ok(my_alloc_called == 1, "alloc called %d\n", my_alloc_called);
+    ok(!memcmp(mem, memsrc, 16), "incorrectly unmarshaled\n");
+    StubMsg.pfnFree(mem);
+
+    HeapFree(GetProcessHeap(), 0, StubMsg.RpcMsg->Buffer);
+
+    /* only part of the array is transmitted, so the server can't use the buffer */
+    StubDesc.pFormatTypes = fmtstr_cvarray_partial;
+
+    NdrClientInitializeNew(&RpcMessage, &StubMsg, &StubDesc, 0);
+
+    StubMsg.BufferLength = 0;
+    NdrConformantVaryingArrayBufferSize(&StubMsg, memsrc, fmtstr_cvarray_partial);
+    ok(StubMsg.BufferLength >= 20, "length %d\n", StubMsg.BufferLength);
+
+    StubMsg.RpcMsg->Buffer = StubMsg.BufferStart = StubMsg.Buffer = HeapAlloc(GetProcessHeap(), 0, StubMsg.BufferLength);
+    StubMsg.BufferEnd = StubMsg.BufferStart + StubMsg.BufferLength;
+
+    NdrConformantVaryingArrayMarshall(&StubMsg, memsrc, fmtstr_cvarray_partial);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 20, "Buffer %p Start %p len %d\n",
+       StubMsg.Buffer, StubMsg.BufferStart, (int)(StubMsg.Buffer - StubMsg.BufferStart));
+
+    my_alloc_called = 0;
+    StubMsg.IsClient = 0;
+    mem = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    NdrConformantVaryingArrayUnmarshall(&StubMsg, &mem, fmtstr_cvarray_partial, 0);
+    ok(mem != NULL && mem != StubMsg.BufferStart + 12, "mem pointing at buffer\n");
+    ok(my_alloc_called == 1, "alloc called %d\n", my_alloc_called);
+    ok(!memcmp(mem, memsrc, 8), "incorrectly unmarshaled\n");
+    StubMsg.pfnFree(mem);
+
+    HeapFree(GetProcessHeap(), 0, StubMsg.RpcMsg->Buffer);
+}
+
 static void test_conformant_string(void)
 {
     RPC_MESSAGE RpcMessage;
@@ -2417,6 +2528,7 @@ START_TEST( ndr_marshall )
     test_server_init();
     test_ndr_allocate();
     test_conformant_array();
+    test_conf_varying_array();
     test_conformant_string();
     test_nonconformant_string();
     test_conf_complex_struct();
@@ -47,6 +47,7 @@ static BOOLEAN (WINAPI *pGetUserNameExA)(EXTENDED_NAME_FORMAT, LPSTR, PULONG);
 static RPC_STATUS (WINAPI *pRpcBindingSetAuthInfoExA)(RPC_BINDING_HANDLE, RPC_CSTR, ULONG, ULONG,
                                                       RPC_AUTH_IDENTITY_HANDLE, ULONG, RPC_SECURITY_QOS *);
 static RPC_STATUS (WINAPI *pRpcServerRegisterAuthInfoA)(RPC_CSTR, ULONG, RPC_AUTH_KEY_RETRIEVAL_FN, LPVOID);
+static const char *(CDECL *pwine_get_version)(void);
 
 static char *domain_and_user;
 
@@ -64,6 +65,7 @@ static void InitFunctionPointers(void)
     pRpcBindingSetAuthInfoExA = (void *)GetProcAddress(hrpcrt4, "RpcBindingSetAuthInfoExA");
     pRpcServerRegisterAuthInfoA = (void *)GetProcAddress(hrpcrt4, "RpcServerRegisterAuthInfoA");
     pGetUserNameExA = (void *)GetProcAddress(hsecur32, "GetUserNameExA");
+    pwine_get_version = (void *)GetProcAddress(GetModuleHandleA("ntdll.dll"), "wine_get_version");
 
     if (!pNDRSContextMarshall2) old_windows_version = TRUE;
 }
@@ -1457,6 +1459,85 @@ run_tests(void)
   context_handle_test();
 }
 
+/* packets bigger than the shared memory rings, split in many fragments */
+static void
+large_packet_tests(void)
+{
+  doub_carr_t *dc;
+  int *x, i, n = 0x20000, sum = 0;
+
+  x = HeapAlloc(GetProcessHeap(), 0, n * sizeof(*x));
+  for (i = 0; i < n; i++)
+  {
+    x[i] = i % 1000;
+    sum += x[i];
+  }
+  ok(sum_conf_array(x, n) == sum, "RPC sum_conf_array\n");
+  HeapFree(GetProcessHeap(), 0, x);
+
+  dc = NULL;
+  make_pyramid_doub_carr(255, &dc);
+  ok(dc != NULL && dc->n == 255, "RPC make_pyramid_doub_carr\n");
+  if (dc)
+  {
+    ok(check_pyramid_doub_carr(dc), "RPC make_pyramid_doub_carr\n");
+    free_pyramid_doub_carr(dc);
+  }
+}
+
+#define CALL_THREADS 4
+
+static DWORD WINAPI call_thread(void *arg)
+{
+  int i, calls = (INT_PTR)arg, failures = 0;
+
+  for (i = 0; i < calls; i++)
+    if (square(i % 1000) != (i % 1000) * (i % 1000)) failures++;
+
+  return failures;
+}
+
+static void
+call_throughput_test(void)
+{
+  HANDLE threads[CALL_THREADS];
+  DWORD start, elapsed, failures;
+  int i, calls = winetest_interactive ? 20000 : 200;
+
+  start = GetTickCount();
+
+  for (i = 0; i < CALL_THREADS; i++)
+  {
+    threads[i] = CreateThread(NULL, 0, call_thread, (void *)(INT_PTR)calls, 0, NULL);
+    ok(threads[i] != NULL, "CreateThread failed: %u\n", GetLastError());
+  }
+
+  for (i = 0; i < CALL_THREADS; i++)
+  {
+    if (!threads[i]) continue;
+    ok(WaitForSingleObject(threads[i], 60000) == WAIT_OBJECT_0, "call thread %d didn't finish\n", i);
+    GetExitCodeThread(threads[i], &failures);
+    ok(failures == 0, "call thread %d got %u wrong results\n", i, failures);
+    CloseHandle(threads[i]);
+  }
+
+  elapsed = GetTickCount() - start;
+  if (winetest_interactive)
+    trace("%d calls from %d threads in %u ms (%u calls/s)\n", calls * CALL_THREADS, CALL_THREADS,
+          elapsed, elapsed ? MulDiv(calls * CALL_THREADS, 1000, elapsed) : 0);
+
+  /* round trip latency of a single caller */
+  start = GetTickCount();
+  for (i = 0; i < calls; i++)
+    if (int_return() != INT_CODE) break;
+  ok(i == calls, "int_return failed on call %d\n", i);
+
+  elapsed = GetTickCount() - start;
+  if (winetest_interactive)
+    trace("%d sequential calls in %u ms (%u us per call)\n", calls, elapsed,
+          MulDiv(elapsed, 1000, calls));
+}
+
 static void
 set_auth_info(RPC_BINDING_HANDLE handle)
 {
@@ -1476,6 +1557,25 @@ set_auth_info(RPC_BINDING_HANDLE handle)
     ok(status == RPC_S_OK, "RpcBindingSetAuthInfoExA failed %d\n", status);
 }
 
+/* counts the sections in our handle table that are big enough to hold the
+ * two 64k rings of an ncalrpc connection */
+static unsigned int
+count_ring_sections(void)
+{
+  MEMORY_BASIC_INFORMATION info;
+  unsigned int count = 0;
+  ULONG_PTR handle;
+  void *view;
+
+  for (handle = 4; handle < 0x10000; handle += 4)
+  {
+    if (!(view = MapViewOfFile((HANDLE)handle, FILE_MAP_READ, 0, 0, 0))) continue;
+    if (VirtualQuery(view, &info, sizeof(info)) && info.RegionSize >= 0x20000) count++;
+    UnmapViewOfFile(view);
+  }
+  return count;
+}
+
 static void
 client(const char *test)
 {
@@ -1518,6 +1618,27 @@ client(const char *test)
     ok(RPC_S_OK == RpcBindingFromStringBinding(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
+    call_throughput_test();
+    authinfo_test(RPC_PROTSEQ_LRPC, 0);
+
+    ok(RPC_S_OK == RpcStringFree(&binding), "RpcStringFree\n");
+    ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
+  }
+  else if (strcmp(test, "ncalrpc_shm") == 0)
+  {
+    unsigned int sections;
+
+    ok(RPC_S_OK == RpcStringBindingCompose(NULL, ncalrpc, NULL, guid, NULL, &binding), "RpcStringBindingCompose\n");
+    ok(RPC_S_OK == RpcBindingFromStringBinding(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
+
+    /* the first call opens the connection, which maps the rings */
+    sections = count_ring_sections();
+    ok(int_return() == INT_CODE, "RPC int_return\n");
+    ok(count_ring_sections() == sections + 1, "connection didn't switch to shared memory\n");
+
+    run_tests();
+    large_packet_tests();
+    call_throughput_test();
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
 
     ok(RPC_S_OK == RpcStringFree(&binding), "RpcStringFree\n");
@@ -1548,6 +1669,33 @@ client(const char *test)
   }
 }
 
+/* Wine only: moves ncalrpc connections of client processes to shared memory */
+static void
+set_lrpc_shared_memory(BOOL enable)
+{
+  static BOOL created;
+  DWORD disposition;
+  HKEY key;
+
+  if (enable)
+  {
+    if (RegCreateKeyExA(HKEY_CURRENT_USER, "Software\\Wine\\Rpc", 0, NULL, 0, KEY_ALL_ACCESS,
+                        NULL, &key, &disposition))
+      return;
+    created = (disposition == REG_CREATED_NEW_KEY);
+    RegSetValueExA(key, "SharedMemory", 0, REG_SZ, (const BYTE *)"Y", 2);
+    RegCloseKey(key);
+  }
+  else
+  {
+    if (RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Rpc", &key))
+      return;
+    RegDeleteValueA(key, "SharedMemory");
+    RegCloseKey(key);
+    if (created) RegDeleteKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Rpc");
+  }
+}
+
 static void
 server(void)
 {
@@ -1595,6 +1743,15 @@ server(void)
   if (ncalrpc_status == RPC_S_OK)
   {
     run_client("ncalrpc_basic");
+
+    /* the shared memory transport only exists in Wine */
+    if (pwine_get_version)
+    {
+      set_lrpc_shared_memory(TRUE);
+      run_client("ncalrpc_shm");
+      set_lrpc_shared_memory(FALSE);
+    }
+
     if (pGetUserNameExA)
     {
       /* we don't need to register RPC_C_AUTHN_WINNT for ncalrpc */
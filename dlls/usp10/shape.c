@@ -695,12 +695,17 @@ static VOID *load_gdef_table(HDC hdc)
 
 static VOID load_ot_tables(HDC hdc, ScriptCache *psc)
 {
+    /* don't query the tables a font doesn't have again on every call */
+    if (psc->ot_tables_loaded || !hdc)
+        return;
+
     if (!psc->GSUB_Table)
         psc->GSUB_Table = load_gsub_table(hdc);
     if (!psc->GPOS_Table)
         psc->GPOS_Table = load_gpos_table(hdc);
     if (!psc->GDEF_Table)
         psc->GDEF_Table = load_gdef_table(hdc);
+    psc->ot_tables_loaded = TRUE;
 }
 
 INT SHAPE_does_GSUB_feature_apply_to_chars(HDC hdc, SCRIPT_ANALYSIS *psa, ScriptCache* psc, const WCHAR *chars, INT write_dir, INT count, const char* feature)
@@ -3398,6 +3403,19 @@ HRESULT SHAPE_CheckFontForRequiredFeatures(HDC hdc, ScriptCache *psc, SCRIPT_ANA
     return USP_E_SCRIPT_NOT_IN_FONT;
 }
 
+/* Runs that no shaping step can change: left to right, in a script without
+ * contextual shaping or required features, with a font that has no GSUB table. */
+BOOL SHAPE_IsSimpleRun(HDC hdc, ScriptCache *psc, const SCRIPT_ANALYSIS *psa)
+{
+    if (ShapingData[psa->eScript].contextProc || ShapingData[psa->eScript].requiredFeatures)
+        return FALSE;
+    if (!psa->fLogicalOrder && psa->fRTL)
+        return FALSE;
+
+    load_ot_tables(hdc, psc);
+    return !psc->GSUB_Table;
+}
+
 HRESULT SHAPE_GetFontScriptTags( HDC hdc, ScriptCache *psc,
                                  SCRIPT_ANALYSIS *psa, int cMaxTags,
                                  OPENTYPE_TAG *pScriptTags, int *pcTags)
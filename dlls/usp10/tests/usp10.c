@@ -1326,6 +1326,56 @@ static void test_ScriptShapeOpenType(HDC hdc)
     }
 }
 
+static void test_ScriptShape_repeated(HDC hdc)
+{
+    static const WCHAR latin[] = {'w','i','n','e',0};
+    static const WCHAR arabic[] = {0x0633,0x0644,0x0627,0x0645,0};
+    static const WCHAR hebrew[] = {0x05e9,0x05dc,0x05d5,0x05dd,0};
+    static const WCHAR *strings[] = {latin, arabic, hebrew};
+    WORD glyphs[2][16], logclust[2][4];
+    SCRIPT_VISATTR attrs[2][16];
+    SCRIPT_CACHE sc = NULL;
+    SCRIPT_ITEM items[3];
+    int i, j, k, nb[2], nitems;
+    HRESULT hr;
+
+    for (i = 0; i < sizeof(strings)/sizeof(strings[0]); i++)
+    {
+        hr = ScriptItemize(strings[i], 4, 2, NULL, NULL, items, &nitems);
+        ok(hr == S_OK, "%d: ScriptItemize failed: %08x\n", i, hr);
+
+        for (j = 0; j < 2; j++)
+        {
+            memset(glyphs[j], 0xcc, sizeof(glyphs[j]));
+            memset(logclust[j], 0xcc, sizeof(logclust[j]));
+            memset(attrs[j], 0xcc, sizeof(attrs[j]));
+            hr = ScriptShape(hdc, &sc, strings[i], 4, 16, &items[0].a, glyphs[j], logclust[j], attrs[j], &nb[j]);
+            ok(hr == S_OK || broken(hr == USP_E_SCRIPT_NOT_IN_FONT), "%d: ScriptShape failed: %08x\n", i, hr);
+            if (hr != S_OK) break;
+
+            /* shape something else with the same cache in between */
+            for (k = 0; k < sizeof(strings)/sizeof(strings[0]); k++)
+            {
+                WORD tmp_glyphs[16], tmp_logclust[4];
+                SCRIPT_VISATTR tmp_attrs[16];
+                SCRIPT_ITEM tmp_items[3];
+                int tmp_nb;
+
+                if (k == i) continue;
+                ScriptItemize(strings[k], 4, 2, NULL, NULL, tmp_items, NULL);
+                ScriptShape(hdc, &sc, strings[k], 4, 16, &tmp_items[0].a, tmp_glyphs, tmp_logclust, tmp_attrs, &tmp_nb);
+            }
+        }
+        if (hr != S_OK) continue;
+
+        ok(nb[0] == nb[1], "%d: got %d glyphs, expected %d\n", i, nb[1], nb[0]);
+        ok(!memcmp(glyphs[0], glyphs[1], nb[0] * sizeof(WORD)), "%d: glyphs differ\n", i);
+        ok(!memcmp(logclust[0], logclust[1], sizeof(logclust[0])), "%d: clusters differ\n", i);
+        ok(!memcmp(attrs[0], attrs[1], nb[0] * sizeof(SCRIPT_VISATTR)), "%d: visual attributes differ\n", i);
+    }
+    ScriptFreeCache(&sc);
+}
+
 static void test_ScriptShape(HDC hdc)
 {
     static const WCHAR test1[] = {'w', 'i', 'n', 'e',0};
@@ -3205,6 +3255,7 @@ START_TEST(usp10)
     test_ScriptCacheGetHeight(hdc);
     test_ScriptGetGlyphABCWidth(hdc);
     test_ScriptShape(hdc);
+    test_ScriptShape_repeated(hdc);
     test_ScriptShapeOpenType(hdc);
     test_ScriptPlace(hdc);
 
@@ -847,6 +847,7 @@ static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
     if (!hdc) return E_PENDING;
 
     if (!(sc = heap_alloc_zero(sizeof(ScriptCache)))) return E_OUTOFMEMORY;
+    list_init(&sc->shaped_run_lru);
     if (!GetTextMetricsW(hdc, &sc->tm))
     {
         heap_free(sc);
@@ -875,6 +876,88 @@ static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
     return S_OK;
 }
 
+static struct list *get_shaped_run_bucket(ScriptCache *sc, const SCRIPT_ANALYSIS *psa, const WCHAR *chars, int count)
+{
+    DWORD hash = psa->eScript;
+    int i;
+
+    for (i = 0; i < count; i++)
+        hash = hash * 31 + chars[i];
+    return &sc->shaped_runs[hash % SHAPED_RUN_HASH_SIZE];
+}
+
+static ShapedRun *find_shaped_run(ScriptCache *sc, const SCRIPT_ANALYSIS *psa, OPENTYPE_TAG script_tag,
+                                  OPENTYPE_TAG lang_tag, const WCHAR *chars, int count)
+{
+    ShapedRun *run;
+
+    if (!sc->shaped_runs || count > SHAPED_RUN_MAX_CHARS) return NULL;
+
+    LIST_FOR_EACH_ENTRY(run, get_shaped_run_bucket(sc, psa, chars, count), ShapedRun, entry)
+    {
+        if (run->char_count == count && run->script_tag == script_tag && run->lang_tag == lang_tag &&
+            !memcmp(&run->sa, psa, sizeof(*psa)) && !memcmp(run->chars, chars, count * sizeof(WCHAR)))
+        {
+            list_remove(&run->lru_entry);
+            list_add_head(&sc->shaped_run_lru, &run->lru_entry);
+            return run;
+        }
+    }
+    return NULL;
+}
+
+static void free_shaped_run(ScriptCache *sc, ShapedRun *run)
+{
+    list_remove(&run->entry);
+    list_remove(&run->lru_entry);
+    sc->shaped_run_count--;
+    heap_free(run);
+}
+
+static void add_shaped_run(ScriptCache *sc, const SCRIPT_ANALYSIS *psa, OPENTYPE_TAG script_tag,
+                           OPENTYPE_TAG lang_tag, const WCHAR *chars, int char_count, const WORD *glyphs,
+                           int glyph_count, const WORD *log_clust, const SCRIPT_CHARPROP *char_props,
+                           const SCRIPT_GLYPHPROP *glyph_props)
+{
+    ShapedRun *run;
+    SIZE_T size;
+    int i;
+
+    if (char_count > SHAPED_RUN_MAX_CHARS) return;
+
+    if (!sc->shaped_runs)
+    {
+        if (!(sc->shaped_runs = heap_alloc(SHAPED_RUN_HASH_SIZE * sizeof(*sc->shaped_runs)))) return;
+        for (i = 0; i < SHAPED_RUN_HASH_SIZE; i++)
+            list_init(&sc->shaped_runs[i]);
+    }
+
+    size = sizeof(*run) + glyph_count * (sizeof(SCRIPT_GLYPHPROP) + sizeof(WORD)) +
+           char_count * (sizeof(SCRIPT_CHARPROP) + sizeof(WCHAR) + sizeof(WORD));
+    if (!(run = heap_alloc(size))) return;
+
+    run->sa = *psa;
+    run->script_tag = script_tag;
+    run->lang_tag = lang_tag;
+    run->char_count = char_count;
+    run->glyph_count = glyph_count;
+    run->glyph_props = (SCRIPT_GLYPHPROP *)(run + 1);
+    run->char_props = (SCRIPT_CHARPROP *)(run->glyph_props + glyph_count);
+    run->chars = (WCHAR *)(run->char_props + char_count);
+    run->glyphs = (WORD *)(run->chars + char_count);
+    run->log_clust = run->glyphs + glyph_count;
+    memcpy(run->glyph_props, glyph_props, glyph_count * sizeof(*glyph_props));
+    memcpy(run->char_props, char_props, char_count * sizeof(*char_props));
+    memcpy(run->chars, chars, char_count * sizeof(*chars));
+    memcpy(run->glyphs, glyphs, glyph_count * sizeof(*glyphs));
+    memcpy(run->log_clust, log_clust, char_count * sizeof(*log_clust));
+
+    list_add_head(get_shaped_run_bucket(sc, psa, chars, char_count), &run->entry);
+    list_add_head(&sc->shaped_run_lru, &run->lru_entry);
+    if (++sc->shaped_run_count > SHAPED_RUN_MAX_COUNT)
+        free_shaped_run(sc, LIST_ENTRY(list_tail(&sc->shaped_run_lru), ShapedRun, lru_entry));
+}
+
 static WCHAR mirror_char( WCHAR ch )
 {
     extern const WCHAR wine_mirror_map[];
@@ -1051,6 +1134,13 @@ HRESULT WINAPI ScriptFreeCache(SCRIPT_CACHE *psc)
         }
         heap_free(((ScriptCache *)*psc)->scripts);
         heap_free(((ScriptCache *)*psc)->otm);
+        if (((ScriptCache *)*psc)->shaped_runs)
+        {
+            ShapedRun *run, *next;
+            LIST_FOR_EACH_ENTRY_SAFE(run, next, &((ScriptCache *)*psc)->shaped_run_lru, ShapedRun, lru_entry)
+                free_shaped_run(*psc, run);
+            heap_free(((ScriptCache *)*psc)->shaped_runs);
+        }
         heap_free(*psc);
         *psc = NULL;
     }
@@ -2899,8 +2989,27 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
     if (psa && !psa->fNoGlyphIndex)
     {
         WCHAR *rChars;
+        ShapedRun *run = NULL;
+        BOOL simple;
+
         if ((hr = SHAPE_CheckFontForRequiredFeatures(hdc, (ScriptCache *)*psc, psa)) != S_OK) return hr;
 
+        /* Simple runs are quicker to shape than to look up, the others are cached
+         * since callers tend to shape the same runs over and over. */
+        simple = SHAPE_IsSimpleRun(hdc, (ScriptCache *)*psc, psa);
+        if (!simple && !cRanges &&
+            (run = find_shaped_run(*psc, psa, tagScript, tagLangSys, pwcChars, cChars)) &&
+            run->glyph_count <= cMaxGlyphs)
+        {
+            TRACE("using cached run %p\n", run);
+            memcpy(pwOutGlyphs, run->glyphs, run->glyph_count * sizeof(*pwOutGlyphs));
+            memcpy(pOutGlyphProps, run->glyph_props, run->glyph_count * sizeof(*pOutGlyphProps));
+            memcpy(pwLogClust, run->log_clust, cChars * sizeof(*pwLogClust));
+            memcpy(pCharProps, run->char_props, cChars * sizeof(*pCharProps));
+            *pcGlyphs = run->glyph_count;
+            return S_OK;
+        }
+
         rChars = heap_alloc(sizeof(WCHAR) * cChars);
         if (!rChars) return E_OUTOFMEMORY;
         for (i = 0, g = 0, cluster = 0; i < cChars; i++)
@@ -2957,10 +3066,17 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
         }
         *pcGlyphs = g;
 
-        SHAPE_ContextualShaping(hdc, (ScriptCache *)*psc, psa, rChars, cChars, pwOutGlyphs, pcGlyphs, cMaxGlyphs, pwLogClust);
-        SHAPE_ApplyDefaultOpentypeFeatures(hdc, (ScriptCache *)*psc, psa, pwOutGlyphs, pcGlyphs, cMaxGlyphs, cChars, pwLogClust);
+        if (!simple)
+        {
+            SHAPE_ContextualShaping(hdc, (ScriptCache *)*psc, psa, rChars, cChars, pwOutGlyphs, pcGlyphs, cMaxGlyphs, pwLogClust);
+            SHAPE_ApplyDefaultOpentypeFeatures(hdc, (ScriptCache *)*psc, psa, pwOutGlyphs, pcGlyphs, cMaxGlyphs, cChars, pwLogClust);
+        }
         SHAPE_CharGlyphProp(hdc, (ScriptCache *)*psc, psa, pwcChars, cChars, pwOutGlyphs, *pcGlyphs, pwLogClust, pCharProps, pOutGlyphProps);
         heap_free(rChars);
+
+        if (!simple && !cRanges && !run)
+            add_shaped_run(*psc, psa, tagScript, tagLangSys, pwcChars, cChars, pwOutGlyphs, *pcGlyphs,
+                           pwLogClust, pCharProps, pOutGlyphProps);
     }
     else
     {
@@ -18,6 +18,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  *
  */
+#include "wine/list.h"
+
 #define MS_MAKE_TAG( _x1, _x2, _x3, _x4 ) \
           ( ( (ULONG)_x4 << 24 ) |     \
             ( (ULONG)_x3 << 16 ) |     \
@@ -163,6 +165,26 @@ typedef struct {
     WORD *glyphs[GLYPH_MAX / GLYPH_BLOCK_SIZE];
 } CacheGlyphPage;
 
+/* result of ScriptShapeOpenType for a run */
+typedef struct {
+    struct list entry;      /* entry in the hash bucket */
+    struct list lru_entry;
+    SCRIPT_ANALYSIS sa;
+    OPENTYPE_TAG script_tag;
+    OPENTYPE_TAG lang_tag;
+    int char_count;
+    int glyph_count;
+    SCRIPT_GLYPHPROP *glyph_props;
+    SCRIPT_CHARPROP *char_props;
+    WCHAR *chars;
+    WORD *glyphs;
+    WORD *log_clust;
+} ShapedRun;
+
+#define SHAPED_RUN_HASH_SIZE 64
+#define SHAPED_RUN_MAX_COUNT 256
+#define SHAPED_RUN_MAX_CHARS 256
+
 typedef struct {
     LOGFONTW lf;
     TEXTMETRICW tm;
@@ -176,12 +198,17 @@ typedef struct {
     LPVOID CMAP_Table;
     LPVOID CMAP_format12_Table;
     LPVOID GPOS_Table;
+    BOOL ot_tables_loaded;
     BOOL scripts_initialized;
     INT script_count;
     LoadedScript *scripts;
 
     OPENTYPE_TAG userScript;
     OPENTYPE_TAG userLang;
+
+    struct list *shaped_runs;  /* hash table of ShapedRun, allocated on first use */
+    struct list shaped_run_lru;
+    int shaped_run_count;
 } ScriptCache;
 
 typedef struct _scriptData
@@ -233,6 +260,7 @@ void SHAPE_ContextualShaping(HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa, WC
 void SHAPE_ApplyDefaultOpentypeFeatures(HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa, WORD* pwOutGlyphs, INT* pcGlyphs, INT cMaxGlyphs, INT cChars, WORD *pwLogClust) DECLSPEC_HIDDEN;
 void SHAPE_ApplyOpenTypePositions(HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa, const WORD* pwGlyphs, INT cGlyphs, int *piAdvance, GOFFSET *pGoffset ) DECLSPEC_HIDDEN;
 HRESULT SHAPE_CheckFontForRequiredFeatures(HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa) DECLSPEC_HIDDEN;
+BOOL SHAPE_IsSimpleRun(HDC hdc, ScriptCache *psc, const SCRIPT_ANALYSIS *psa) DECLSPEC_HIDDEN;
 void SHAPE_CharGlyphProp(HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa, const WCHAR* pwcChars, const INT cChars, const WORD* pwGlyphs, const INT cGlyphs, WORD *pwLogClust, SCRIPT_CHARPROP *pCharProp, SCRIPT_GLYPHPROP *pGlyphProp) DECLSPEC_HIDDEN;
 INT SHAPE_does_GSUB_feature_apply_to_chars(HDC hdc, SCRIPT_ANALYSIS *psa, ScriptCache* psc, const WCHAR *chars, INT write_dir, INT count, const char* feature) DECLSPEC_HIDDEN;
 HRESULT SHAPE_GetFontScriptTags( HDC hdc, ScriptCache *psc, SCRIPT_ANALYSIS *psa, int cMaxTags, OPENTYPE_TAG *pScriptTags, int *pcTags) DECLSPEC_HIDDEN;
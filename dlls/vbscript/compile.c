@@ -1199,6 +1199,79 @@ static void resolve_labels(compile_ctx_t *ctx, unsigned off)
     ctx->labels_cnt = 0;
 }
 
+static int lookup_local_slot(function_t *func, const WCHAR *name)
+{
+    unsigned i;
+
+    for(i=0; i < func->var_cnt; i++) {
+        if(!strcmpiW(func->vars[i].name, name))
+            return i;
+    }
+
+    for(i=0; i < func->arg_cnt; i++) {
+        if(!strcmpiW(func->args[i].name, name))
+            return func->var_cnt+i;
+    }
+
+    return -1;
+}
+
+/*
+ * Replaces references to local variables and arguments with instructions
+ * accessing their slots directly, so that they don't need to be looked up
+ * by name each time they are executed. The lookup order matches
+ * lookup_identifier: assigning to the function name sets its return value.
+ */
+static void resolve_local_vars(compile_ctx_t *ctx, function_t *func)
+{
+    BOOL has_ret_val = func->type == FUNC_FUNCTION || func->type == FUNC_PROPGET || func->type == FUNC_DEFGET;
+    instr_t *instr;
+    int slot;
+
+    for(instr = ctx->code->instrs+func->code_off; instr < ctx->code->instrs+ctx->instr_cnt; instr++) {
+        switch(instr->op) {
+        case OP_icall:
+            if(instr->arg2.uint)
+                break;
+            slot = lookup_local_slot(func, instr->arg1.bstr);
+            if(slot != -1) {
+                instr->op = OP_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_assign_ident:
+        case OP_set_ident:
+            if(instr->arg2.uint || (has_ret_val && !strcmpiW(instr->arg1.bstr, func->name)))
+                break;
+            slot = lookup_local_slot(func, instr->arg1.bstr);
+            if(slot != -1) {
+                instr->op = instr->op == OP_assign_ident ? OP_assign_local : OP_set_local;
+                instr->arg1.uint = slot;
+                instr->arg2.uint = 0;
+            }
+            break;
+        case OP_incc:
+            if(has_ret_val && !strcmpiW(instr->arg1.bstr, func->name))
+                break;
+            slot = lookup_local_slot(func, instr->arg1.bstr);
+            if(slot != -1) {
+                instr->op = OP_incc_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_step:
+            slot = lookup_local_slot(func, instr->arg2.bstr);
+            if(slot != -1) {
+                instr->op = OP_step_local;
+                instr->arg2.uint = slot;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *func)
 {
     HRESULT hres;
@@ -1292,6 +1365,9 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         }
     }
 
+    if(func->type != FUNC_GLOBAL)
+        resolve_local_vars(ctx, func);
+
     return S_OK;
 }
 
@@ -1523,18 +1599,9 @@ static HRESULT compile_class(compile_ctx_t *ctx, class_decl_t *class_decl)
 static BOOL lookup_script_identifier(script_ctx_t *script, const WCHAR *identifier)
 {
     class_desc_t *class;
-    dynamic_var_t *var;
-    function_t *func;
 
-    for(var = script->global_vars; var; var = var->next) {
-        if(!strcmpiW(var->name, identifier))
-            return TRUE;
-    }
-
-    for(func = script->global_funcs; func; func = func->next) {
-        if(!strcmpiW(func->name, identifier))
-            return TRUE;
-    }
+    if(find_global_var(script, identifier) || find_global_func(script, identifier))
+        return TRUE;
 
     for(class = script->classes; class; class = class->next) {
         if(!strcmpiW(class->name, identifier))
@@ -1647,8 +1714,10 @@ HRESULT compile_script(script_ctx_t *script, const WCHAR *src, const WCHAR *deli
     function_t *new_func;
     function_decl_t *func_decl;
     class_decl_t *class_decl;
+    dynamic_var_t *var;
     compile_ctx_t ctx;
     vbscode_t *code;
+    unsigned cnt = 0;
     HRESULT hres;
 
     hres = parse_script(&ctx.parser, src, delimiter);
@@ -1702,9 +1771,22 @@ HRESULT compile_script(script_ctx_t *script, const WCHAR *src, const WCHAR *deli
         return hres;
     }
 
-    if(ctx.global_vars) {
-        dynamic_var_t *var;
+    for(var = ctx.global_vars; var; var = var->next)
+        cnt++;
+    for(new_func = ctx.funcs; new_func; new_func = new_func->next)
+        cnt++;
+    hres = reserve_global_hash(script, cnt);
+    if(FAILED(hres)) {
+        release_compiler(&ctx);
+        return hres;
+    }
 
+    for(var = ctx.global_vars; var; var = var->next)
+        add_global_var_hash(script, var);
+    for(new_func = ctx.funcs; new_func; new_func = new_func->next)
+        add_global_func_hash(script, new_func);
+
+    if(ctx.global_vars) {
         for(var = ctx.global_vars; var->next; var = var->next);
 
         var->next = script->global_vars;
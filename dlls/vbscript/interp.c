@@ -72,6 +72,15 @@ typedef struct {
     } u;
 } ref_t;
 
+/* Local variables and arguments resolved by the compiler are addressed by
+ * slot: variables come first, followed by arguments. */
+static inline VARIANT *get_local_var(exec_ctx_t *ctx, unsigned slot)
+{
+    if(slot < ctx->func->var_cnt)
+        return ctx->vars+slot;
+    return ctx->args+slot-ctx->func->var_cnt;
+}
+
 typedef struct {
     VARIANT *v;
     VARIANT store;
@@ -93,6 +102,19 @@ static BOOL lookup_dynamic_vars(dynamic_var_t *var, const WCHAR *name, ref_t *re
     return FALSE;
 }
 
+static BOOL lookup_global_vars(script_ctx_t *script, const WCHAR *name, ref_t *ref)
+{
+    dynamic_var_t *var;
+
+    var = find_global_var(script, name);
+    if(!var)
+        return FALSE;
+
+    ref->type = var->is_const ? REF_CONST : REF_VAR;
+    ref->u.v = &var->v;
+    return TRUE;
+}
+
 static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_t invoke_type, ref_t *ref)
 {
     named_item_t *item;
@@ -127,7 +149,9 @@ static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_
         }
     }
 
-    if(lookup_dynamic_vars(ctx->func->type == FUNC_GLOBAL ? ctx->script->global_vars : ctx->dynamic_vars, name, ref))
+    if(ctx->func->type == FUNC_GLOBAL
+            ? lookup_global_vars(ctx->script, name, ref)
+            : lookup_dynamic_vars(ctx->dynamic_vars, name, ref))
         return S_OK;
 
     if(ctx->func->type != FUNC_GLOBAL) {
@@ -140,15 +164,14 @@ static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_
         }
     }
 
-    if(ctx->func->type != FUNC_GLOBAL && lookup_dynamic_vars(ctx->script->global_vars, name, ref))
+    if(ctx->func->type != FUNC_GLOBAL && lookup_global_vars(ctx->script, name, ref))
         return S_OK;
 
-    for(func = ctx->script->global_funcs; func; func = func->next) {
-        if(!strcmpiW(func->name, name)) {
-            ref->type = REF_FUNC;
-            ref->u.f = func;
-            return S_OK;
-        }
+    func = find_global_func(ctx->script, name);
+    if(func) {
+        ref->type = REF_FUNC;
+        ref->u.f = func;
+        return S_OK;
     }
 
     if(!strcmpiW(name, errW)) {
@@ -215,7 +238,14 @@ static HRESULT add_dynamic_var(exec_ctx_t *ctx, const WCHAR *name,
     unsigned size;
     HRESULT hres;
 
-    heap = ctx->func->type == FUNC_GLOBAL ? &ctx->script->heap : &ctx->heap;
+    if(ctx->func->type == FUNC_GLOBAL) {
+        hres = reserve_global_hash(ctx->script, 1);
+        if(FAILED(hres))
+            return hres;
+        heap = &ctx->script->heap;
+    }else {
+        heap = &ctx->heap;
+    }
 
     new_var = heap_pool_alloc(heap, sizeof(*new_var));
     if(!new_var)
@@ -241,6 +271,7 @@ static HRESULT add_dynamic_var(exec_ctx_t *ctx, const WCHAR *name,
     if(ctx->func->type == FUNC_GLOBAL) {
         new_var->next = ctx->script->global_vars;
         ctx->script->global_vars = new_var;
+        add_global_var_hash(ctx->script, new_var);
     }else {
         new_var->next = ctx->dynamic_vars;
         ctx->dynamic_vars = new_var;
@@ -568,6 +599,18 @@ static HRESULT interp_icallv(exec_ctx_t *ctx)
     return do_icall(ctx, NULL);
 }
 
+static HRESULT interp_local(exec_ctx_t *ctx)
+{
+    VARIANT *var = get_local_var(ctx, ctx->instr->arg1.uint);
+    VARIANT v;
+
+    TRACE("%u\n", ctx->instr->arg1.uint);
+
+    V_VT(&v) = VT_BYREF|VT_VARIANT;
+    V_BYREF(&v) = V_VT(var) == (VT_VARIANT|VT_BYREF) ? V_VARIANTREF(var) : var;
+    return stack_push(ctx, &v);
+}
+
 static HRESULT do_mcall(exec_ctx_t *ctx, VARIANT *res)
 {
     const BSTR identifier = ctx->instr->arg1.bstr;
@@ -620,6 +663,19 @@ static HRESULT interp_mcallv(exec_ctx_t *ctx)
     return do_mcall(ctx, NULL);
 }
 
+static HRESULT assign_var(VARIANT *v, DISPPARAMS *dp)
+{
+    if(arg_cnt(dp)) {
+        FIXME("arg_cnt %d not supported\n", arg_cnt(dp));
+        return E_NOTIMPL;
+    }
+
+    if(V_VT(v) == (VT_VARIANT|VT_BYREF))
+        v = V_VARIANTREF(v);
+
+    return VariantCopy(v, dp->rgvarg);
+}
+
 static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, DISPPARAMS *dp)
 {
     ref_t ref;
@@ -630,20 +686,9 @@ static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, DISPPARAMS *dp)
         return hres;
 
     switch(ref.type) {
-    case REF_VAR: {
-        VARIANT *v = ref.u.v;
-
-        if(arg_cnt(dp)) {
-            FIXME("arg_cnt %d not supported\n", arg_cnt(dp));
-            return E_NOTIMPL;
-        }
-
-        if(V_VT(v) == (VT_VARIANT|VT_BYREF))
-            v = V_VARIANTREF(v);
-
-        hres = VariantCopy(v, dp->rgvarg);
+    case REF_VAR:
+        hres = assign_var(ref.u.v, dp);
         break;
-    }
     case REF_DISP:
         hres = disp_propput(ctx->script, ref.u.d.disp, ref.u.d.id, dp);
         break;
@@ -696,6 +741,26 @@ static HRESULT interp_assign_ident(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_assign_local(exec_ctx_t *ctx)
+{
+    DISPPARAMS dp;
+    HRESULT hres;
+
+    TRACE("%u\n", ctx->instr->arg1.uint);
+
+    hres = stack_assume_val(ctx, 0);
+    if(FAILED(hres))
+        return hres;
+
+    vbstack_to_dp(ctx, 0, TRUE, &dp);
+    hres = assign_var(get_local_var(ctx, ctx->instr->arg1.uint), &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, 1);
+    return S_OK;
+}
+
 static HRESULT interp_set_ident(exec_ctx_t *ctx)
 {
     const BSTR arg = ctx->instr->arg1.bstr;
@@ -723,6 +788,26 @@ static HRESULT interp_set_ident(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_set_local(exec_ctx_t *ctx)
+{
+    DISPPARAMS dp;
+    HRESULT hres;
+
+    TRACE("%u\n", ctx->instr->arg1.uint);
+
+    hres = stack_assume_disp(ctx, 0, NULL);
+    if(FAILED(hres))
+        return hres;
+
+    vbstack_to_dp(ctx, 0, TRUE, &dp);
+    hres = assign_var(get_local_var(ctx, ctx->instr->arg1.uint), &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, 1);
+    return S_OK;
+}
+
 static HRESULT interp_assign_member(exec_ctx_t *ctx)
 {
     BSTR identifier = ctx->instr->arg1.bstr;
@@ -887,16 +972,12 @@ static HRESULT interp_new(exec_ctx_t *ctx)
     return stack_push(ctx, &v);
 }
 
-static HRESULT interp_step(exec_ctx_t *ctx)
+static HRESULT do_step(exec_ctx_t *ctx, VARIANT *var)
 {
-    const BSTR ident = ctx->instr->arg2.bstr;
     BOOL gteq_zero;
     VARIANT zero;
-    ref_t ref;
     HRESULT hres;
 
-    TRACE("%s\n", debugstr_w(ident));
-
     V_VT(&zero) = VT_I2;
     V_I2(&zero) = 0;
     hres = VarCmp(stack_top(ctx, 0), &zero, ctx->script->lcid, 0);
@@ -905,16 +986,7 @@ static HRESULT interp_step(exec_ctx_t *ctx)
 
     gteq_zero = hres == VARCMP_GT || hres == VARCMP_EQ;
 
-    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
-    if(FAILED(hres))
-        return hres;
-
-    if(ref.type != REF_VAR) {
-        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
-        return E_FAIL;
-    }
-
-    hres = VarCmp(ref.u.v, stack_top(ctx, 1), ctx->script->lcid, 0);
+    hres = VarCmp(var, stack_top(ctx, 1), ctx->script->lcid, 0);
     if(FAILED(hres))
         return hres;
 
@@ -927,6 +999,33 @@ static HRESULT interp_step(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_step(exec_ctx_t *ctx)
+{
+    const BSTR ident = ctx->instr->arg2.bstr;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(ident));
+
+    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    if(ref.type != REF_VAR) {
+        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
+        return E_FAIL;
+    }
+
+    return do_step(ctx, ref.u.v);
+}
+
+static HRESULT interp_step_local(exec_ctx_t *ctx)
+{
+    TRACE("%u\n", ctx->instr->arg2.uint);
+
+    return do_step(ctx, get_local_var(ctx, ctx->instr->arg2.uint));
+}
+
 static HRESULT interp_newenum(exec_ctx_t *ctx)
 {
     VARIANT *v, r;
@@ -1766,10 +1865,23 @@ static HRESULT interp_neg(exec_ctx_t *ctx)
     return stack_push(ctx, &v);
 }
 
+static HRESULT do_incc(exec_ctx_t *ctx, VARIANT *var)
+{
+    VARIANT v;
+    HRESULT hres;
+
+    hres = VarAdd(stack_top(ctx, 0), var, &v);
+    if(FAILED(hres))
+        return hres;
+
+    VariantClear(var);
+    *var = v;
+    return S_OK;
+}
+
 static HRESULT interp_incc(exec_ctx_t *ctx)
 {
     const BSTR ident = ctx->instr->arg1.bstr;
-    VARIANT v;
     ref_t ref;
     HRESULT hres;
 
@@ -1784,13 +1896,14 @@ static HRESULT interp_incc(exec_ctx_t *ctx)
         return E_FAIL;
     }
 
-    hres = VarAdd(stack_top(ctx, 0), ref.u.v, &v);
-    if(FAILED(hres))
-        return hres;
+    return do_incc(ctx, ref.u.v);
+}
 
-    VariantClear(ref.u.v);
-    *ref.u.v = v;
-    return S_OK;
+static HRESULT interp_incc_local(exec_ctx_t *ctx)
+{
+    TRACE("%u\n", ctx->instr->arg1.uint);
+
+    return do_incc(ctx, get_local_var(ctx, ctx->instr->arg1.uint));
 }
 
 static const instr_func_t op_funcs[] = {
@@ -1813,6 +1926,128 @@ void release_dynamic_vars(dynamic_var_t *var)
     }
 }
 
+#define GLOBAL_HASH_MIN_SIZE 32
+#define GOLDEN_RATIO 0x9E3779B9U
+
+static inline unsigned global_hash_idx(script_ctx_t *ctx, const WCHAR *name)
+{
+    unsigned h = 0;
+    for(; *name; name++)
+        h = (h>>(sizeof(unsigned)*8-4)) ^ (h<<4) ^ tolowerW(*name);
+    return (h*GOLDEN_RATIO) & (ctx->global_hash_size-1);
+}
+
+/* Makes room for cnt more global variables and functions. Once the buckets
+ * exist adding to the hash can't fail, so callers reserve before linking. */
+HRESULT reserve_global_hash(script_ctx_t *ctx, unsigned cnt)
+{
+    unsigned old_size = ctx->global_hash_size, size, idx, i;
+    dynamic_var_t **var_hash, *var, *next_var;
+    function_t **func_hash, *func, *next_func;
+
+    cnt += ctx->global_var_cnt + ctx->global_func_cnt;
+    size = old_size ? old_size : GLOBAL_HASH_MIN_SIZE;
+    while(size < cnt)
+        size *= 2;
+    if(size == old_size)
+        return S_OK;
+
+    var_hash = heap_alloc_zero(size*sizeof(*var_hash));
+    func_hash = heap_alloc_zero(size*sizeof(*func_hash));
+    if(!var_hash || !func_hash) {
+        heap_free(var_hash);
+        heap_free(func_hash);
+        /* longer chains are slower, but still correct */
+        return old_size ? S_OK : E_OUTOFMEMORY;
+    }
+
+    ctx->global_hash_size = size;
+    for(i=0; i < old_size; i++) {
+        for(var = ctx->global_var_hash[i]; var; var = next_var) {
+            next_var = var->hash_next;
+            idx = global_hash_idx(ctx, var->name);
+            var->hash_next = var_hash[idx];
+            var_hash[idx] = var;
+        }
+        for(func = ctx->global_func_hash[i]; func; func = next_func) {
+            next_func = func->hash_next;
+            idx = global_hash_idx(ctx, func->name);
+            func->hash_next = func_hash[idx];
+            func_hash[idx] = func;
+        }
+    }
+
+    heap_free(ctx->global_var_hash);
+    heap_free(ctx->global_func_hash);
+    ctx->global_var_hash = var_hash;
+    ctx->global_func_hash = func_hash;
+    return S_OK;
+}
+
+dynamic_var_t *find_global_var(script_ctx_t *ctx, const WCHAR *name)
+{
+    dynamic_var_t *var;
+
+    if(!ctx->global_hash_size)
+        return NULL;
+
+    for(var = ctx->global_var_hash[global_hash_idx(ctx, name)]; var; var = var->hash_next) {
+        if(!strcmpiW(var->name, name))
+            return var;
+    }
+
+    return NULL;
+}
+
+function_t *find_global_func(script_ctx_t *ctx, const WCHAR *name)
+{
+    function_t *func;
+
+    if(!ctx->global_hash_size)
+        return NULL;
+
+    for(func = ctx->global_func_hash[global_hash_idx(ctx, name)]; func; func = func->hash_next) {
+        if(!strcmpiW(func->name, name))
+            return func;
+    }
+
+    return NULL;
+}
+
+/* Like the list lookups it replaces, the first definition of a name wins. */
+void add_global_var_hash(script_ctx_t *ctx, dynamic_var_t *var)
+{
+    unsigned idx;
+
+    if(find_global_var(ctx, var->name))
+        return;
+
+    idx = global_hash_idx(ctx, var->name);
+    var->hash_next = ctx->global_var_hash[idx];
+    ctx->global_var_hash[idx] = var;
+    ctx->global_var_cnt++;
+}
+
+void add_global_func_hash(script_ctx_t *ctx, function_t *func)
+{
+    unsigned idx;
+
+    if(find_global_func(ctx, func->name))
+        return;
+
+    idx = global_hash_idx(ctx, func->name);
+    func->hash_next = ctx->global_func_hash[idx];
+    ctx->global_func_hash[idx] = func;
+    ctx->global_func_cnt++;
+}
+
+void clear_global_var_hash(script_ctx_t *ctx)
+{
+    if(ctx->global_var_hash)
+        memset(ctx->global_var_hash, 0, ctx->global_hash_size*sizeof(*ctx->global_var_hash));
+    ctx->global_var_cnt = 0;
+}
+
 static void release_exec(exec_ctx_t *ctx)
 {
     unsigned i;
@@ -2532,6 +2532,48 @@ SimpleMatch(REGlobalData *gData, match_state_t *x, REOp op,
     return NULL;
 }
 
+/*
+ * Find the first position at or after cp where the simple op starting the
+ * program may match. Literals and character classes are searched for
+ * directly instead of trying SimpleMatch on each character.
+ */
+static const WCHAR *
+FindSimpleMatchStart(REGlobalData *gData, REOp op, jsbytecode *pc, const WCHAR *cp)
+{
+    size_t offset, index;
+    RECharSet *charSet;
+    WCHAR ch;
+
+    switch (op) {
+      case REOP_FLAT:
+        ReadCompactIndex(pc, &offset);
+        ch = gData->regexp->source[offset];
+        break;
+      case REOP_FLAT1:
+        ch = *pc;
+        break;
+      case REOP_UCFLAT1:
+        ch = GET_ARG(pc);
+        break;
+      case REOP_CLASS:
+        ReadCompactIndex(pc, &index);
+        charSet = &gData->regexp->classList[index];
+        assert(charSet->converted);
+        if (charSet->length == 0)
+            return NULL;
+        for (; cp < gData->cpend; cp++) {
+            ch = *cp;
+            if (ch <= charSet->length && (charSet->u.bits[ch >> 3] & (1 << (ch & 0x7))))
+                return cp;
+        }
+        return NULL;
+      default:
+        return cp;
+    }
+
+    return memchrW(cp, ch, gData->cpend - cp);
+}
+
 static inline match_state_t *
 ExecuteREBytecode(REGlobalData *gData, match_state_t *x)
 {
@@ -2559,6 +2601,15 @@ ExecuteREBytecode(REGlobalData *gData, match_state_t *x)
     if (REOP_IS_SIMPLE(op) && !(gData->regexp->flags & REG_STICKY)) {
         anchor = FALSE;
         while (x->cp <= gData->cpend) {
+            startcp = FindSimpleMatchStart(gData, op, pc, x->cp);
+            if (!startcp) {
+                /* Nothing can match in the rest of the input. */
+                gData->skipped += gData->cpend - x->cp + 1;
+                break;
+            }
+            gData->skipped += startcp - x->cp;
+            x->cp = startcp;
+
             nextpc = pc;    /* reset back to start each time */
             result = SimpleMatch(gData, x, op, &nextpc, TRUE);
             if (result) {
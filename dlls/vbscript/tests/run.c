@@ -1554,6 +1554,27 @@ static void test_procedures(void)
     close_script(script);
 }
 
+static void test_global_hash(void)
+{
+    static char script[16384];
+    char *p = script;
+    int i;
+
+    /* enough globals to grow the script's identifier hash several times */
+    for(i=0; i < 100; i++)
+        p += sprintf(p, "Dim gvar%d\nFunction gfunc%d\ngfunc%d = %d\nEnd Function\n", i, i, i, i);
+    for(i=0; i < 100; i++)
+        p += sprintf(p, "GVAR%d = GFunc%d()\nDVAR%d = gvar%d\n", i, i, i, i);
+    sprintf(p, "Sub checkvars\n"
+               "Call ok(gvar0 = 0, \"gvar0 = \" & gvar0)\n"
+               "Call ok(GVar99 = 99, \"gvar99 = \" & GVar99)\n"
+               "Call ok(dvar50 = 50, \"dvar50 = \" & dvar50)\n"
+               "Call ok(gfunc73() = 73, \"gfunc73() = \" & gfunc73())\n"
+               "End Sub\n"
+               "Call checkvars()\n");
+    parse_script_a(script);
+}
+
 static void test_gc(void)
 {
     IActiveScriptParse *parser;
@@ -1926,6 +1947,7 @@ static void run_tests(void)
     run_from_res("regexp.vbs");
 
     test_procedures();
+    test_global_hash();
     test_gc();
     test_msgbox();
 }
@@ -121,6 +121,7 @@ static void release_script(script_ctx_t *ctx)
 
     release_dynamic_vars(ctx->global_vars);
     ctx->global_vars = NULL;
+    clear_global_var_hash(ctx);
 
     while(!list_empty(&ctx->named_items)) {
         named_item_t *iter = LIST_ENTRY(list_head(&ctx->named_items), named_item_t, entry);
@@ -182,6 +183,8 @@ static void destroy_script(script_ctx_t *ctx)
         release_vbscode(LIST_ENTRY(list_head(&ctx->code_list), vbscode_t, entry));
 
     release_script(ctx);
+    heap_free(ctx->global_var_hash);
+    heap_free(ctx->global_func_hash);
     heap_free(ctx);
 }
 
@@ -154,6 +154,7 @@ static inline VARIANT *get_arg(DISPPARAMS *dp, DWORD i)
 
 typedef struct _dynamic_var_t {
     struct _dynamic_var_t *next;
+    struct _dynamic_var_t *hash_next;
     VARIANT v;
     const WCHAR *name;
     BOOL is_const;
@@ -178,6 +179,14 @@ struct _script_ctx_t {
 
     dynamic_var_t *global_vars;
     function_t *global_funcs;
+
+    /* global_vars and global_funcs chained by case insensitive name hash */
+    dynamic_var_t **global_var_hash;
+    function_t **global_func_hash;
+    unsigned global_hash_size;
+    unsigned global_var_cnt;
+    unsigned global_func_cnt;
+
     class_desc_t *classes;
     class_desc_t *procs;
 
@@ -207,6 +216,7 @@ typedef enum {
     X(add,            1, 0,           0)          \
     X(and,            1, 0,           0)          \
     X(assign_ident,   1, ARG_BSTR,    ARG_UINT)   \
+    X(assign_local,   1, ARG_UINT,    0)          \
     X(assign_member,  1, ARG_BSTR,    ARG_UINT)   \
     X(bool,           1, ARG_INT,     0)          \
     X(case,           0, ARG_ADDR,    0)          \
@@ -227,11 +237,13 @@ typedef enum {
     X(idiv,           1, 0,           0)          \
     X(imp,            1, 0,           0)          \
     X(incc,           1, ARG_BSTR,    0)          \
+    X(incc_local,     1, ARG_UINT,    0)          \
     X(is,             1, 0,           0)          \
     X(jmp,            0, ARG_ADDR,    0)          \
     X(jmp_false,      0, ARG_ADDR,    0)          \
     X(jmp_true,       0, ARG_ADDR,    0)          \
     X(long,           1, ARG_INT,     0)          \
+    X(local,          1, ARG_UINT,    0)          \
     X(lt,             1, 0,           0)          \
     X(lteq,           1, 0,           0)          \
     X(mcall,          1, ARG_BSTR,    ARG_UINT)   \
@@ -250,9 +262,11 @@ typedef enum {
     X(pop,            1, ARG_UINT,    0)          \
     X(ret,            0, 0,           0)          \
     X(set_ident,      1, ARG_BSTR,    ARG_UINT)   \
+    X(set_local,      1, ARG_UINT,    0)          \
     X(set_member,     1, ARG_BSTR,    ARG_UINT)   \
     X(short,          1, ARG_INT,     0)          \
     X(step,           0, ARG_ADDR,    ARG_BSTR)   \
+    X(step_local,     0, ARG_ADDR,    ARG_UINT)   \
     X(stop,           1, 0,           0)          \
     X(string,         1, ARG_STR,     0)          \
     X(sub,            1, 0,           0)          \
@@ -310,6 +324,7 @@ struct _function_t {
     unsigned code_off;
     vbscode_t *code_ctx;
     function_t *next;
+    function_t *hash_next;
 };
 
 struct _vbscode_t {
@@ -333,6 +348,12 @@ void release_vbscode(vbscode_t*) DECLSPEC_HIDDEN;
 HRESULT compile_script(script_ctx_t*,const WCHAR*,const WCHAR*,vbscode_t**) DECLSPEC_HIDDEN;
 HRESULT exec_script(script_ctx_t*,function_t*,IDispatch*,DISPPARAMS*,VARIANT*) DECLSPEC_HIDDEN;
 void release_dynamic_vars(dynamic_var_t*) DECLSPEC_HIDDEN;
+HRESULT reserve_global_hash(script_ctx_t*,unsigned) DECLSPEC_HIDDEN;
+void add_global_var_hash(script_ctx_t*,dynamic_var_t*) DECLSPEC_HIDDEN;
+void add_global_func_hash(script_ctx_t*,function_t*) DECLSPEC_HIDDEN;
+dynamic_var_t *find_global_var(script_ctx_t*,const WCHAR*) DECLSPEC_HIDDEN;
+function_t *find_global_func(script_ctx_t*,const WCHAR*) DECLSPEC_HIDDEN;
+void clear_global_var_hash(script_ctx_t*) DECLSPEC_HIDDEN;
 
 typedef struct {
     UINT16 len;
@@ -75,7 +75,9 @@ typedef struct FormatConverter {
     WICBitmapDitherType dither;
     double alpha_threshold;
     WICBitmapPaletteType palette_type;
-    CRITICAL_SECTION lock; /* must be held when initialized */
+    BYTE *scratch; /* source rows being converted */
+    UINT scratch_size;
+    CRITICAL_SECTION lock; /* must be held when initialized or converting */
 } FormatConverter;
 
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
@@ -83,388 +85,325 @@ static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
-static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
-    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
-{
-    switch (source_format)
-    {
-    case format_1bppIndexed:
-    case format_BlackWhite:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[2];
-            IWICPalette *palette;
-            UINT actualcolors;
+/* Source rows are read in bands of at most this many bytes. */
+#define CONVERT_BAND_SIZE 0x10000
 
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
+/* Converts a row of width pixels; colors is the palette of indexed formats. */
+typedef void (*convert_row_func)(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors);
 
-            if (source_format == format_1bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedBW, FALSE);
+struct row_converter {
+    enum pixelformat format;
+    UINT bpp;
+    convert_row_func convert;
+};
 
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 2, colors, &actualcolors);
+static void convert_row_8bppGray_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
+    for (x=0; x<width; x++)
+        dstpixel[x] = 0xff000000|(src[x]<<16)|(src[x]<<8)|src[x];
+}
 
-            srcstride = (prc->Width+7)/8;
-            srcdatasize = srcstride * prc->Height;
+static void convert_row_8bppIndexed_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+    for (x=0; x<width; x++)
+        dstpixel[x] = colors[src[x]];
+}
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+static void convert_row_16bppGray_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=8) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>7&1];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>6&1];
-                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>5&1];
-                        if (x+3 < prc->Width) *dstpixel++ = colors[srcval>>4&1];
-                        if (x+4 < prc->Width) *dstpixel++ = colors[srcval>>3&1];
-                        if (x+5 < prc->Width) *dstpixel++ = colors[srcval>>2&1];
-                        if (x+6 < prc->Width) *dstpixel++ = colors[srcval>>1&1];
-                        if (x+7 < prc->Width) *dstpixel++ = colors[srcval&1];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    for (x=0; x<width; x++)
+        dstpixel[x] = 0xff000000|(src[x*2]<<16)|(src[x*2]<<8)|src[x*2];
+}
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+static void convert_row_16bppBGR555_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    const WORD *srcpixel = (const WORD*)src;
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            return res;
-        }
-        return S_OK;
-    case format_2bppIndexed:
-    case format_2bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[4];
-            IWICPalette *palette;
-            UINT actualcolors;
+    for (x=0; x<width; x++)
+    {
+        DWORD srcval = srcpixel[x];
+        dstpixel[x] = 0xff000000 | /* constant 255 alpha */
+                      ((srcval << 9) & 0xf80000) | /* r */
+                      ((srcval << 4) & 0x070000) | /* r - 3 bits */
+                      ((srcval << 6) & 0x00f800) | /* g */
+                      ((srcval << 1) & 0x000700) | /* g - 3 bits */
+                      ((srcval << 3) & 0x0000f8) | /* b */
+                      ((srcval >> 2) & 0x000007);  /* b - 3 bits */
+    }
+}
 
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
+static void convert_row_16bppBGR565_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    const WORD *srcpixel = (const WORD*)src;
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            if (source_format == format_2bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray4, FALSE);
+    for (x=0; x<width; x++)
+    {
+        DWORD srcval = srcpixel[x];
+        dstpixel[x] = 0xff000000 | /* constant 255 alpha */
+                      ((srcval << 8) & 0xf80000) | /* r */
+                      ((srcval << 3) & 0x070000) | /* r - 3 bits */
+                      ((srcval << 5) & 0x00fc00) | /* g */
+                      ((srcval >> 1) & 0x000300) | /* g - 2 bits */
+                      ((srcval << 3) & 0x0000f8) | /* b */
+                      ((srcval >> 2) & 0x000007);  /* b - 3 bits */
+    }
+}
 
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 4, colors, &actualcolors);
+static void convert_row_16bppBGRA5551_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    const WORD *srcpixel = (const WORD*)src;
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
+    for (x=0; x<width; x++)
+    {
+        DWORD srcval = srcpixel[x];
+        dstpixel[x] = ((srcval & 0x8000) ? 0xff000000 : 0) | /* alpha */
+                      ((srcval << 9) & 0xf80000) | /* r */
+                      ((srcval << 4) & 0x070000) | /* r - 3 bits */
+                      ((srcval << 6) & 0x00f800) | /* g */
+                      ((srcval << 1) & 0x000700) | /* g - 3 bits */
+                      ((srcval << 3) & 0x0000f8) | /* b */
+                      ((srcval >> 2) & 0x000007);  /* b - 3 bits */
+    }
+}
 
-            srcstride = (prc->Width+3)/4;
-            srcdatasize = srcstride * prc->Height;
+static void convert_row_24bppBGR_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+    for (x=0; x<width; x++, src+=3)
+        dstpixel[x] = 0xff000000|(src[2]<<16)|(src[1]<<8)|src[0];
+}
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+static void convert_row_24bppRGB_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=4) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>6];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>4&0x3];
-                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>2&0x3];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval&0x3];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    for (x=0; x<width; x++, src+=3)
+        dstpixel[x] = 0xff000000|(src[0]<<16)|(src[1]<<8)|src[2];
+}
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+static void convert_row_48bppRGB_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            return res;
-        }
-        return S_OK;
-    case format_4bppIndexed:
-    case format_4bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[16];
-            IWICPalette *palette;
-            UINT actualcolors;
+    for (x=0; x<width; x++, src+=6)
+        dstpixel[x] = 0xff000000|(src[0]<<16)|(src[2]<<8)|src[4];
+}
 
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
+static void convert_row_64bppRGBA_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    DWORD *dstpixel = (DWORD*)dst;
+    UINT x;
 
-            if (source_format == format_4bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray16, FALSE);
+    for (x=0; x<width; x++, src+=8)
+        dstpixel[x] = (src[6]<<24)|(src[0]<<16)|(src[2]<<8)|src[4];
+}
 
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 16, colors, &actualcolors);
+static void convert_row_32bpp_to_24bppBGR(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    UINT x;
 
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
+    for (x=0; x<width; x++, src+=4, dst+=3)
+    {
+        dst[0] = src[0]; /* blue */
+        dst[1] = src[1]; /* green */
+        dst[2] = src[2]; /* red */
+    }
+}
 
-            srcstride = (prc->Width+1)/2;
-            srcdatasize = srcstride * prc->Height;
+static void convert_row_32bpp_to_24bppRGB(const BYTE *src, BYTE *dst, UINT width, const WICColor *colors)
+{
+    UINT x;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+    for (x=0; x<width; x++, src+=4, dst+=3)
+    {
+        dst[0] = src[2]; /* red */
+        dst[1] = src[1]; /* green */
+        dst[2] = src[0]; /* blue */
+    }
+}
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+static const struct row_converter row_converters_to_32bppBGRA[] = {
+    {format_8bppGray, 8, convert_row_8bppGray_to_32bppBGRA},
+    {format_8bppIndexed, 8, convert_row_8bppIndexed_to_32bppBGRA},
+    {format_16bppGray, 16, convert_row_16bppGray_to_32bppBGRA},
+    {format_16bppBGR555, 16, convert_row_16bppBGR555_to_32bppBGRA},
+    {format_16bppBGR565, 16, convert_row_16bppBGR565_to_32bppBGRA},
+    {format_16bppBGRA5551, 16, convert_row_16bppBGRA5551_to_32bppBGRA},
+    {format_24bppBGR, 24, convert_row_24bppBGR_to_32bppBGRA},
+    {format_24bppRGB, 24, convert_row_24bppRGB_to_32bppBGRA},
+    {format_48bppRGB, 48, convert_row_48bppRGB_to_32bppBGRA},
+    {format_64bppRGBA, 64, convert_row_64bppRGBA_to_32bppBGRA}
+};
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=2) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>4];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval&0xf];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+/* Multiply the color channels of 32bppBGRA pixels by their alpha. */
+static void premultiply_row(DWORD *pixels, UINT width)
+{
+    UINT x;
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    for (x=0; x<width; x++)
+    {
+        DWORD pixel = pixels[x], alpha = pixel >> 24, rb, g;
 
-            return res;
-        }
-        return S_OK;
-    case format_8bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
+        if (alpha == 255) continue;
 
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
+        /* (v + 1 + (v >> 8)) >> 8 == v / 255 for all v <= 255 * 255. Red and
+         * blue are done in one multiply; each 16-bit field stays below 65536. */
+        rb = (pixel & 0xff00ff) * alpha;
+        g = ((pixel >> 8) & 0xff) * alpha;
+        rb = ((rb + 0x10001 + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+        g = (g + 1 + (g >> 8)) >> 8;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+        pixels[x] = (alpha << 24) | rb | (g << 8);
+    }
+}
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+/* Divide the color channels of 32bppPBGRA pixels by their alpha.
+ * (v * recip[alpha]) >> 16 == v * 255 / alpha for all bytes v. */
+static void unpremultiply_row(BYTE *pixels, UINT width, const DWORD *recip)
+{
+    UINT x;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    for (x=0; x<width; x++, pixels+=4)
+    {
+        BYTE alpha = pixels[3];
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+        if (alpha != 0 && alpha != 255)
+        {
+            DWORD scale = recip[alpha];
 
-            return res;
+            pixels[0] = (pixels[0] * scale) >> 16;
+            pixels[1] = (pixels[1] * scale) >> 16;
+            pixels[2] = (pixels[2] * scale) >> 16;
         }
-        return S_OK;
-    case format_8bppIndexed:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[256];
-            IWICPalette *palette;
-            UINT actualcolors;
+    }
+}
 
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
+static void init_unpremultiply_table(DWORD *recip)
+{
+    UINT alpha;
 
-            res = IWICBitmapSource_CopyPalette(This->source, palette);
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 256, colors, &actualcolors);
+    recip[0] = 0;
+    for (alpha=1; alpha<256; alpha++)
+        recip[alpha] = (255 * 65536 + alpha - 1) / alpha;
+}
 
-            IWICPalette_Release(palette);
+/* Returns a scratch buffer of at least size bytes owned by the converter.
+ * The converter lock must be held. */
+static BYTE *get_scratch_buffer(struct FormatConverter *This, UINT size)
+{
+    if (size > This->scratch_size)
+    {
+        BYTE *buffer;
 
-            if (FAILED(res)) return res;
+        if (This->scratch)
+            buffer = HeapReAlloc(GetProcessHeap(), 0, This->scratch, size);
+        else
+            buffer = HeapAlloc(GetProcessHeap(), 0, size);
+        if (!buffer) return NULL;
 
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
+        This->scratch = buffer;
+        This->scratch_size = size;
+    }
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+    return This->scratch;
+}
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+/* Read the source rectangle in bands of rows and convert each row into the
+ * destination buffer, so the scratch memory stays small for large images. */
+static HRESULT copypixels_by_rows(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, BYTE *pbBuffer, UINT src_bpp, convert_row_func convert, const WICColor *colors)
+{
+    UINT srcstride = (prc->Width * src_bpp + 7) / 8;
+    UINT band, y, i;
+    BYTE *srcdata;
+    WICRect rc;
+    HRESULT res = S_OK;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                        *dstpixel++ = colors[*srcbyte++];
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    if (!srcstride || prc->Height <= 0)
+        return S_OK;
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    band = min(max(CONVERT_BAND_SIZE / srcstride, 1), prc->Height);
 
-            return res;
-        }
-        return S_OK;
-    case format_16bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
+    srcdata = get_scratch_buffer(This, srcstride * band);
+    if (!srcdata) return E_OUTOFMEMORY;
 
-            srcstride = prc->Width * 2;
-            srcdatasize = srcstride * prc->Height;
+    rc = *prc;
+    for (y=0; y<prc->Height; y+=band)
+    {
+        rc.Y = prc->Y + y;
+        rc.Height = min(band, prc->Height - y);
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+        res = IWICBitmapSource_CopyPixels(This->source, &rc, srcstride, srcstride * rc.Height, srcdata);
+        if (FAILED(res)) break;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+        for (i=0; i<rc.Height; i++)
+            convert(srcdata + srcstride * i, pbBuffer + cbStride * (y + i), prc->Width, colors);
+    }
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte+=2;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    return res;
+}
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+{
+    UINT i;
 
-            return res;
-        }
-        return S_OK;
-    case format_16bppBGR555:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const WORD *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
+    for (i=0; i<sizeof(row_converters_to_32bppBGRA)/sizeof(row_converters_to_32bppBGRA[0]); i++)
+    {
+        const struct row_converter *converter = &row_converters_to_32bppBGRA[i];
+        WICColor colors[256];
 
-            srcstride = 2 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
+        if (converter->format != source_format)
+            continue;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+        if (!prc)
+            return S_OK;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+        if (source_format == format_8bppIndexed)
+        {
+            HRESULT res;
+            IWICPalette *palette;
+            UINT actualcolors;
 
+            res = PaletteImpl_Create(&palette);
+            if (FAILED(res)) return res;
+
+            res = IWICBitmapSource_CopyPalette(This->source, palette);
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                res = IWICPalette_GetColors(palette, 256, colors, &actualcolors);
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+            IWICPalette_Release(palette);
 
-            return res;
+            if (FAILED(res)) return res;
         }
-        return S_OK;
-    case format_16bppBGR565:
+
+        return copypixels_by_rows(This, prc, cbStride, pbBuffer, converter->bpp,
+            converter->convert, colors);
+    }
+
+    switch (source_format)
+    {
+    case format_1bppIndexed:
+    case format_BlackWhite:
         if (prc)
         {
             HRESULT res;
@@ -472,11 +411,28 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const WORD *srcpixel;
+            const BYTE *srcbyte;
             BYTE *dstrow;
             DWORD *dstpixel;
+            WICColor colors[2];
+            IWICPalette *palette;
+            UINT actualcolors;
+
+            res = PaletteImpl_Create(&palette);
+            if (FAILED(res)) return res;
+
+            if (source_format == format_1bppIndexed)
+                res = IWICBitmapSource_CopyPalette(This->source, palette);
+            else
+                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedBW, FALSE);
+
+            if (SUCCEEDED(res))
+                res = IWICPalette_GetColors(palette, 2, colors, &actualcolors);
+
+            IWICPalette_Release(palette);
+            if (FAILED(res)) return res;
 
-            srcstride = 2 * prc->Width;
+            srcstride = (prc->Width+7)/8;
             srcdatasize = srcstride * prc->Height;
 
             srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
@@ -489,18 +445,19 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
+                    srcbyte = srcrow;
                     dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 8) & 0xf80000) | /* r */
-                                    ((srcval << 3) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 5) & 0x00fc00) | /* g */
-                                    ((srcval >> 1) & 0x000300) | /* g - 2 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
+                    for (x=0; x<prc->Width; x+=8) {
+                        BYTE srcval;
+                        srcval=*srcbyte++;
+                        *dstpixel++ = colors[srcval>>7&1];
+                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>6&1];
+                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>5&1];
+                        if (x+3 < prc->Width) *dstpixel++ = colors[srcval>>4&1];
+                        if (x+4 < prc->Width) *dstpixel++ = colors[srcval>>3&1];
+                        if (x+5 < prc->Width) *dstpixel++ = colors[srcval>>2&1];
+                        if (x+6 < prc->Width) *dstpixel++ = colors[srcval>>1&1];
+                        if (x+7 < prc->Width) *dstpixel++ = colors[srcval&1];
                     }
                     srcrow += srcstride;
                     dstrow += cbStride;
@@ -512,7 +469,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             return res;
         }
         return S_OK;
-    case format_16bppBGRA5551:
+    case format_2bppIndexed:
+    case format_2bppGray:
         if (prc)
         {
             HRESULT res;
@@ -520,11 +478,28 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const WORD *srcpixel;
+            const BYTE *srcbyte;
             BYTE *dstrow;
             DWORD *dstpixel;
+            WICColor colors[4];
+            IWICPalette *palette;
+            UINT actualcolors;
+
+            res = PaletteImpl_Create(&palette);
+            if (FAILED(res)) return res;
+
+            if (source_format == format_2bppIndexed)
+                res = IWICBitmapSource_CopyPalette(This->source, palette);
+            else
+                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray4, FALSE);
+
+            if (SUCCEEDED(res))
+                res = IWICPalette_GetColors(palette, 4, colors, &actualcolors);
 
-            srcstride = 2 * prc->Width;
+            IWICPalette_Release(palette);
+            if (FAILED(res)) return res;
+
+            srcstride = (prc->Width+3)/4;
             srcdatasize = srcstride * prc->Height;
 
             srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
@@ -537,18 +512,15 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
+                    srcbyte = srcrow;
                     dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=((srcval & 0x8000) ? 0xff000000 : 0) | /* alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
+                    for (x=0; x<prc->Width; x+=4) {
+                        BYTE srcval;
+                        srcval=*srcbyte++;
+                        *dstpixel++ = colors[srcval>>6];
+                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>4&0x3];
+                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>2&0x3];
+                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval&0x3];
                     }
                     srcrow += srcstride;
                     dstrow += cbStride;
@@ -560,7 +532,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             return res;
         }
         return S_OK;
-    case format_24bppBGR:
+    case format_4bppIndexed:
+    case format_4bppGray:
         if (prc)
         {
             HRESULT res;
@@ -568,55 +541,28 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
+            const BYTE *srcbyte;
             BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
+            DWORD *dstpixel;
+            WICColor colors[16];
+            IWICPalette *palette;
+            UINT actualcolors;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+            res = PaletteImpl_Create(&palette);
+            if (FAILED(res)) return res;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+            if (source_format == format_4bppIndexed)
+                res = IWICBitmapSource_CopyPalette(This->source, palette);
+            else
+                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray16, FALSE);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
+                res = IWICPalette_GetColors(palette, 16, colors, &actualcolors);
 
-            return res;
-        }
-        return S_OK;
-    case format_24bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
+            IWICPalette_Release(palette);
+            if (FAILED(res)) return res;
 
-            srcstride = 3 * prc->Width;
+            srcstride = (prc->Width+1)/2;
             srcdatasize = srcstride * prc->Height;
 
             srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
@@ -629,17 +575,13 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
+                    srcbyte = srcrow;
+                    dstpixel=(DWORD*)dstrow;
+                    for (x=0; x<prc->Width; x+=2) {
+                        BYTE srcval;
+                        srcval=*srcbyte++;
+                        *dstpixel++ = colors[srcval>>4];
+                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval&0xf];
                     }
                     srcrow += srcstride;
                     dstrow += cbStride;
@@ -662,8 +604,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
+            {
+                DWORD *dstpixel = (DWORD*)(pbBuffer + cbStride * y);
                 for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                    dstpixel[x] |= 0xff000000;
+            }
         }
         return S_OK;
     case format_32bppBGRA:
@@ -674,111 +619,15 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
+            DWORD recip[256];
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
+            init_unpremultiply_table(recip);
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
-        }
-        return S_OK;
-    case format_48bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 6 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue;
-                        red = *srcpixel++; srcpixel++;
-                        green = *srcpixel++; srcpixel++;
-                        blue = *srcpixel++; srcpixel++;
-                        *dstpixel++=0xff000000|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_64bppRGBA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 8 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue, alpha;
-                        red = *srcpixel++; srcpixel++;
-                        green = *srcpixel++; srcpixel++;
-                        blue = *srcpixel++; srcpixel++;
-                        alpha = *srcpixel++; srcpixel++;
-                        *dstpixel++=alpha<<24|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width, recip);
         }
         return S_OK;
     case format_32bppCMYK:
@@ -838,19 +687,10 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_row((DWORD*)(pbBuffer + cbStride * y), prc->Width);
         }
         return hr;
     }
@@ -877,46 +717,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
     case format_32bppBGRA:
     case format_32bppPBGRA:
         if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
+            return copypixels_by_rows(This, prc, cbStride, pbBuffer, 32,
+                convert_row_32bpp_to_24bppBGR, NULL);
         return S_OK;
     default:
         FIXME("Unimplemented conversion path!\n");
@@ -945,48 +747,8 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
     case format_32bppBGRA:
     case format_32bppPBGRA:
         if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-
-                reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
+            return copypixels_by_rows(This, prc, cbStride, pbBuffer, 32,
+                convert_row_32bpp_to_24bppRGB, NULL);
         return S_OK;
     default:
         FIXME("Unimplemented conversion path!\n");
@@ -1074,6 +836,7 @@ static ULONG WINAPI FormatConverter_Release(IWICFormatConverter *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        HeapFree(GetProcessHeap(), 0, This->scratch);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -1150,8 +913,12 @@ static HRESULT WINAPI FormatConverter_CopyPixels(IWICFormatConverter *iface,
             prc = &rc;
         }
 
-        return This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
+        EnterCriticalSection(&This->lock);
+        hr = This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
             pbBuffer, This->src_format->format);
+        LeaveCriticalSection(&This->lock);
+
+        return hr;
     }
     else
         return WINCODEC_ERR_NOTINITIALIZED;
@@ -1288,6 +1055,8 @@ HRESULT FormatConverter_CreateInstance(IUnknown *pUnkOuter, REFIID iid, void** p
     This->IWICFormatConverter_iface.lpVtbl = &FormatConverter_Vtbl;
     This->ref = 1;
     This->source = NULL;
+    This->scratch = NULL;
+    This->scratch_size = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": FormatConverter.lock");
 
@@ -169,6 +169,7 @@ MAKE_FUNCPTR(png_get_error_ptr);
 MAKE_FUNCPTR(png_get_iCCP);
 MAKE_FUNCPTR(png_get_image_height);
 MAKE_FUNCPTR(png_get_image_width);
+MAKE_FUNCPTR(png_get_interlace_type);
 MAKE_FUNCPTR(png_get_io_ptr);
 MAKE_FUNCPTR(png_get_pHYs);
 MAKE_FUNCPTR(png_get_PLTE);
@@ -192,6 +193,7 @@ MAKE_FUNCPTR(png_set_write_fn);
 MAKE_FUNCPTR(png_read_end);
 MAKE_FUNCPTR(png_read_image);
 MAKE_FUNCPTR(png_read_info);
+MAKE_FUNCPTR(png_read_row);
 MAKE_FUNCPTR(png_write_end);
 MAKE_FUNCPTR(png_write_info);
 MAKE_FUNCPTR(png_write_rows);
@@ -218,6 +220,7 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_get_iCCP);
         LOAD_FUNCPTR(png_get_image_height);
         LOAD_FUNCPTR(png_get_image_width);
+        LOAD_FUNCPTR(png_get_interlace_type);
         LOAD_FUNCPTR(png_get_io_ptr);
         LOAD_FUNCPTR(png_get_pHYs);
         LOAD_FUNCPTR(png_get_PLTE);
@@ -241,6 +244,7 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_read_end);
         LOAD_FUNCPTR(png_read_image);
         LOAD_FUNCPTR(png_read_info);
+        LOAD_FUNCPTR(png_read_row);
         LOAD_FUNCPTR(png_write_end);
         LOAD_FUNCPTR(png_write_info);
         LOAD_FUNCPTR(png_write_rows);
@@ -281,6 +285,9 @@ typedef struct {
     UINT stride;
     const WICPixelFormatGUID *format;
     BYTE *image_bits;
+    IStream *stream; /* held while rows remain to be decoded */
+    ULARGE_INTEGER stream_pos;
+    int rows_decoded;
     CRITICAL_SECTION lock; /* must be held when png structures are accessed or initialized is set */
 } PngDecoder;
 
@@ -347,6 +354,8 @@ static ULONG WINAPI PngDecoder_Release(IWICBitmapDecoder *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         HeapFree(GetProcessHeap(), 0, This->image_bits);
+        if (This->stream)
+            IStream_Release(This->stream);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -554,7 +563,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
     /* read the image data */
     This->width = ppng_get_image_width(This->png_ptr, This->info_ptr);
     This->height = ppng_get_image_height(This->png_ptr, This->info_ptr);
-    This->stride = This->width * This->bpp;
+    This->stride = (This->width * This->bpp + 7)/8;
     image_size = This->stride * This->height;
 
     This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
@@ -564,6 +573,22 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         goto end;
     }
 
+    if (ppng_get_interlace_type(This->png_ptr, This->info_ptr) == PNG_INTERLACE_NONE)
+    {
+        /* Rows are decoded on demand by CopyPixels, remember where the
+         * image data starts so we can get back to it. */
+        seek.QuadPart = 0;
+        hr = IStream_Seek(pIStream, seek, STREAM_SEEK_CUR, &This->stream_pos);
+        if (FAILED(hr)) goto end;
+
+        IStream_AddRef(pIStream);
+        This->stream = pIStream;
+        This->rows_decoded = 0;
+        This->initialized = TRUE;
+        goto end;
+    }
+
+    /* interlaced images need every pass before any row is complete */
     row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
     if (!row_pointers)
     {
@@ -581,6 +606,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
 
     ppng_read_end(This->png_ptr, This->end_info);
 
+    This->rows_decoded = This->height;
     This->initialized = TRUE;
 
 end:
@@ -844,12 +870,71 @@ end:
     return hr;
 }
 
+/* Decode rows up to (but not including) max_row. Must be called with the lock held. */
+static HRESULT PngDecoder_ReadRows(PngDecoder *This, int max_row)
+{
+    LARGE_INTEGER seek;
+    HRESULT hr;
+    jmp_buf jmpbuf;
+
+    if (This->rows_decoded >= max_row)
+        return S_OK;
+
+    if (!This->stream)
+        return E_FAIL;
+
+    /* the stream may have been used since we last read from it */
+    seek.QuadPart = This->stream_pos.QuadPart;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr)) return hr;
+
+    if (setjmp(jmpbuf))
+    {
+        IStream_Release(This->stream);
+        This->stream = NULL;
+        return E_FAIL;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    while (This->rows_decoded < max_row)
+    {
+        ppng_read_row(This->png_ptr, This->image_bits + This->rows_decoded * This->stride, NULL);
+        This->rows_decoded++;
+    }
+
+    if (This->rows_decoded == This->height)
+    {
+        ppng_read_end(This->png_ptr, This->end_info);
+        IStream_Release(This->stream);
+        This->stream = NULL;
+        return S_OK;
+    }
+
+    seek.QuadPart = 0;
+    return IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, &This->stream_pos);
+}
+
 static HRESULT WINAPI PngDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     PngDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    int max_row;
+    HRESULT hr;
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
+    if (!prc)
+        max_row = This->height;
+    else if (prc->Y < 0 || prc->Height < 0 || prc->Y + prc->Height > This->height)
+        return E_INVALIDARG;
+    else
+        max_row = prc->Y + prc->Height;
+
+    EnterCriticalSection(&This->lock);
+    hr = PngDecoder_ReadRows(This, max_row);
+    LeaveCriticalSection(&This->lock);
+
+    if (FAILED(hr)) return hr;
+
     return copy_pixels(This->bpp, This->image_bits,
         This->width, This->height, This->stride,
         prc, cbStride, cbBufferSize, pbBuffer);
@@ -1010,6 +1095,8 @@ HRESULT PngDecoder_CreateInstance(IUnknown *pUnkOuter, REFIID iid, void** ppv)
     This->end_info = NULL;
     This->initialized = FALSE;
     This->image_bits = NULL;
+    This->stream = NULL;
+    This->rows_decoded = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": PngDecoder.lock");
 
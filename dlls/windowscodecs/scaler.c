@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -33,6 +34,19 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Weights are fixed point numbers with this many fractional bits. */
+#define FILTER_SHIFT 14
+/* Extra fractional bits kept in horizontally filtered rows. */
+#define ROW_SHIFT 7
+
+struct scaler_filter
+{
+    UINT *start; /* first source pixel for each destination pixel */
+    UINT *count; /* number of source pixels for each destination pixel */
+    INT *weights; /* max_taps weights for each destination pixel */
+    UINT max_taps;
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -43,6 +57,12 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct scaler_filter x_filter, y_filter;
+    INT *row_cache; /* y_filter.max_taps horizontally filtered source rows */
+    INT *row_cache_y; /* source row held by each cache slot, or -1 */
+    INT *row_accum;
+    UINT row_cache_x, row_cache_width;
+    UINT row_cache_next_y; /* destination row following the previous CopyPixels */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -51,6 +71,25 @@ static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
 }
 
+static void free_scaler_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->count);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    memset(filter, 0, sizeof(*filter));
+}
+
+static void free_scaler_filters(BitmapScaler *This)
+{
+    free_scaler_filter(&This->x_filter);
+    free_scaler_filter(&This->y_filter);
+    HeapFree(GetProcessHeap(), 0, This->row_cache);
+    HeapFree(GetProcessHeap(), 0, This->row_cache_y);
+    HeapFree(GetProcessHeap(), 0, This->row_accum);
+    This->row_cache = This->row_cache_y = This->row_accum = NULL;
+    This->row_cache_x = This->row_cache_width = This->row_cache_next_y = 0;
+}
+
 static HRESULT WINAPI BitmapScaler_QueryInterface(IWICBitmapScaler *iface, REFIID iid,
     void **ppv)
 {
@@ -97,6 +136,7 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_scaler_filters(This);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -166,6 +206,292 @@ static HRESULT WINAPI BitmapScaler_CopyPalette(IWICBitmapScaler *iface,
     return IWICBitmapSource_CopyPalette(This->source, pIPalette);
 }
 
+static double linear_kernel(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline */
+static double cubic_kernel(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/* Compute the source pixels and weights contributing to each destination
+ * pixel along one axis. Linear and cubic kernels are widened when
+ * downscaling so every source pixel contributes; Fant averages the source
+ * area covered by each destination pixel. Source pixels outside the image
+ * are clamped to the edge. */
+static HRESULT create_scaler_filter(WICBitmapInterpolationMode mode, UINT src_size,
+    UINT dst_size, struct scaler_filter *filter)
+{
+    double scale, filter_scale, support;
+    double *weights;
+    UINT i;
+
+    scale = dst_size ? (double)src_size / dst_size : 1.0;
+    filter_scale = max(scale, 1.0);
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        support = filter_scale;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        support = 2.0 * filter_scale;
+        break;
+    default: /* WICBitmapInterpolationModeFant */
+        support = scale / 2.0;
+        break;
+    }
+
+    filter->max_taps = (UINT)ceil(2.0 * support) + 2;
+    filter->start = HeapAlloc(GetProcessHeap(), 0, sizeof(UINT) * max(dst_size, 1));
+    filter->count = HeapAlloc(GetProcessHeap(), 0, sizeof(UINT) * max(dst_size, 1));
+    filter->weights = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        sizeof(INT) * filter->max_taps * max(dst_size, 1));
+    weights = HeapAlloc(GetProcessHeap(), 0, sizeof(double) * filter->max_taps);
+
+    if (!filter->start || !filter->count || !filter->weights || !weights)
+    {
+        HeapFree(GetProcessHeap(), 0, weights);
+        free_scaler_filter(filter);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i=0; i<dst_size; i++)
+    {
+        INT *fixed_weights = &filter->weights[i * filter->max_taps];
+        INT first, last, j, total, largest=0;
+        double sum=0.0, lo, hi, center=0.0;
+
+        if (mode == WICBitmapInterpolationModeFant)
+        {
+            lo = i * scale;
+            hi = (i + 1) * scale;
+            first = floor(lo);
+            last = ceil(hi) - 1;
+        }
+        else
+        {
+            center = (i + 0.5) * scale - 0.5;
+            lo = center - support;
+            hi = center + support;
+            first = ceil(lo);
+            last = floor(hi);
+        }
+
+        if (!src_size)
+        {
+            filter->start[i] = filter->count[i] = 0;
+            continue;
+        }
+
+        filter->start[i] = min(max(first, 0), (INT)src_size - 1);
+        filter->count[i] = min(max(last, 0), (INT)src_size - 1) - filter->start[i] + 1;
+        memset(weights, 0, sizeof(double) * filter->max_taps);
+
+        for (j=first; j<=last; j++)
+        {
+            INT index = min(max(j, 0), (INT)src_size - 1) - filter->start[i];
+            double weight;
+
+            switch (mode)
+            {
+            case WICBitmapInterpolationModeLinear:
+                weight = linear_kernel((j - center) / filter_scale);
+                break;
+            case WICBitmapInterpolationModeCubic:
+                weight = cubic_kernel((j - center) / filter_scale);
+                break;
+            default:
+                weight = min(j + 1, hi) - max(j, lo);
+                break;
+            }
+
+            weights[index] += weight;
+            sum += weight;
+        }
+
+        if (sum == 0.0)
+        {
+            weights[0] = sum = 1.0;
+            filter->count[i] = 1;
+        }
+
+        /* Convert to fixed point, making sure the weights still add up to one. */
+        total = 0;
+        for (j=0; j<filter->count[i]; j++)
+        {
+            fixed_weights[j] = floor(weights[j] / sum * (1 << FILTER_SHIFT) + 0.5);
+            total += fixed_weights[j];
+            if (fixed_weights[j] > fixed_weights[largest]) largest = j;
+        }
+        fixed_weights[largest] += (1 << FILTER_SHIFT) - total;
+    }
+
+    HeapFree(GetProcessHeap(), 0, weights);
+
+    return S_OK;
+}
+
+static void filter_row(const struct scaler_filter *filter, UINT channels,
+    const BYTE *src, UINT src_x, UINT dst_x, UINT dst_width, INT *dst)
+{
+    UINT i, c, t;
+
+    for (i=0; i<dst_width; i++)
+    {
+        const INT *weights = &filter->weights[(dst_x + i) * filter->max_taps];
+        const BYTE *src_pixel = src + (filter->start[dst_x + i] - src_x) * channels;
+        UINT count = filter->count[dst_x + i];
+
+        for (c=0; c<channels; c++)
+        {
+            INT sum = 0;
+
+            for (t=0; t<count; t++)
+                sum += weights[t] * src_pixel[t * channels + c];
+
+            dst[i * channels + c] = (sum + (1 << (FILTER_SHIFT - ROW_SHIFT - 1))) >> (FILTER_SHIFT - ROW_SHIFT);
+        }
+    }
+}
+
+/* Filter the destination rectangle one row at a time. Horizontally filtered
+ * source rows are kept in a small ring buffer, so that scanlines requested
+ * from top to bottom (as MSDN recommends) read each source row once and
+ * memory use does not depend on the image height. The source may change
+ * between calls, so cached rows are only reused while the calls continue
+ * one top-to-bottom pass. */
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dest_rect,
+    UINT cbStride, BYTE *pbBuffer)
+{
+    UINT channels = This->bpp / 8;
+    UINT row_size = dest_rect->Width * channels;
+    UINT slots = This->y_filter.max_taps;
+    UINT src_x, src_x_end, x, y, t, i;
+    WICRect src_rect;
+    BYTE *src_row;
+    INT *accum;
+    HRESULT hr = S_OK;
+
+    if (!dest_rect->Width || !dest_rect->Height)
+        return S_OK;
+
+    src_x = This->x_filter.start[dest_rect->X];
+    src_x_end = src_x;
+    for (x=dest_rect->X; x<dest_rect->X + dest_rect->Width; x++)
+        src_x_end = max(src_x_end, This->x_filter.start[x] + This->x_filter.count[x]);
+
+    if (!This->row_cache || This->row_cache_x != dest_rect->X ||
+        This->row_cache_width != dest_rect->Width)
+    {
+        HeapFree(GetProcessHeap(), 0, This->row_cache);
+        HeapFree(GetProcessHeap(), 0, This->row_cache_y);
+        HeapFree(GetProcessHeap(), 0, This->row_accum);
+        This->row_cache = HeapAlloc(GetProcessHeap(), 0, sizeof(INT) * row_size * slots);
+        This->row_cache_y = HeapAlloc(GetProcessHeap(), 0, sizeof(INT) * slots);
+        This->row_accum = HeapAlloc(GetProcessHeap(), 0, sizeof(INT) * row_size);
+
+        if (!This->row_cache || !This->row_cache_y || !This->row_accum)
+        {
+            HeapFree(GetProcessHeap(), 0, This->row_cache);
+            HeapFree(GetProcessHeap(), 0, This->row_cache_y);
+            HeapFree(GetProcessHeap(), 0, This->row_accum);
+            This->row_cache = This->row_cache_y = This->row_accum = NULL;
+            return E_OUTOFMEMORY;
+        }
+
+        for (i=0; i<slots; i++)
+            This->row_cache_y[i] = -1;
+        This->row_cache_x = dest_rect->X;
+        This->row_cache_width = dest_rect->Width;
+    }
+    else if (dest_rect->Y < This->row_cache_next_y)
+    {
+        for (i=0; i<slots; i++)
+            This->row_cache_y[i] = -1;
+    }
+    This->row_cache_next_y = dest_rect->Y + dest_rect->Height;
+    accum = This->row_accum;
+
+    src_row = HeapAlloc(GetProcessHeap(), 0, max(src_x_end - src_x, 1) * channels);
+    if (!src_row)
+        return E_OUTOFMEMORY;
+
+    src_rect.X = src_x;
+    src_rect.Width = src_x_end - src_x;
+    src_rect.Height = 1;
+
+    for (y=dest_rect->Y; SUCCEEDED(hr) && y<dest_rect->Y + dest_rect->Height; y++)
+    {
+        const INT *weights = &This->y_filter.weights[y * This->y_filter.max_taps];
+        UINT src_y = This->y_filter.start[y];
+        BYTE *dst = pbBuffer + cbStride * (y - dest_rect->Y);
+
+        memset(accum, 0, sizeof(INT) * row_size);
+
+        for (t=0; t<This->y_filter.count[y]; t++)
+        {
+            UINT slot = (src_y + t) % slots;
+            INT *cached = This->row_cache + slot * row_size;
+            INT weight = weights[t];
+
+            if (This->row_cache_y[slot] != src_y + t)
+            {
+                src_rect.Y = src_y + t;
+                hr = IWICBitmapSource_CopyPixels(This->source, &src_rect,
+                    src_rect.Width * channels, src_rect.Width * channels, src_row);
+                if (FAILED(hr))
+                {
+                    This->row_cache_y[slot] = -1;
+                    break;
+                }
+
+                filter_row(&This->x_filter, channels, src_row, src_x,
+                    dest_rect->X, dest_rect->Width, cached);
+                This->row_cache_y[slot] = src_y + t;
+            }
+
+            for (i=0; i<row_size; i++)
+                accum[i] += weight * cached[i];
+        }
+
+        for (i=0; i<row_size; i++)
+        {
+            INT value = (accum[i] + (1 << (FILTER_SHIFT + ROW_SHIFT - 1))) >> (FILTER_SHIFT + ROW_SHIFT);
+            dst[i] = min(max(value, 0), 255);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, src_row);
+
+    return hr;
+}
+
+static BOOL is_filterable_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID *formats[] = {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA
+    };
+    UINT i;
+
+    for (i=0; i<sizeof(formats)/sizeof(formats[0]); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+
+    return FALSE;
+}
+
 static void NearestNeighbor_GetRequiredSourceRect(BitmapScaler *This,
     UINT x, UINT y, WICRect *src_rect)
 {
@@ -245,6 +571,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->x_filter.weights)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -336,6 +668,34 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            if (is_filterable_format(&src_pixelformat))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+            }
+
+            if (SUCCEEDED(hr))
+                hr = create_scaler_filter(mode, This->src_width, This->width, &This->x_filter);
+
+            if (SUCCEEDED(hr))
+                hr = create_scaler_filter(mode, This->src_height, This->height, &This->y_filter);
+
+            if (FAILED(hr))
+            {
+                free_scaler_filters(This);
+                if (This->source) IWICBitmapSource_Release(This->source);
+                This->source = NULL;
+            }
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -391,6 +751,10 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->x_filter, 0, sizeof(This->x_filter));
+    memset(&This->y_filter, 0, sizeof(This->y_filter));
+    This->row_cache = This->row_cache_y = This->row_accum = NULL;
+    This->row_cache_x = This->row_cache_width = This->row_cache_next_y = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -950,6 +950,129 @@ static void test_clipper(void)
     IWICBitmapClipper_Release(clipper);
 }
 
+static void test_scaler(void)
+{
+    static const BYTE gray_data[] = {
+        0, 100, 200, 40,
+        0, 100, 200, 40,
+        20, 20, 60, 60,
+        20, 20, 60, 60 };
+    static const BYTE fant_expected[] = { 50, 120, 20, 60 };
+    static const BYTE ramp_data[] = { 0, 255 };
+    static const BYTE linear_expected[] = { 0, 64, 191, 255 };
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    IWICBitmapLock *lock;
+    WICPixelFormatGUID format;
+    BYTE buffer[64], *data;
+    UINT width, height, size, i;
+    WICRect rect;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat8bppGray,
+        4, sizeof(gray_data), (BYTE*)gray_data, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    /* Fant averages the covered source pixels */
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource*)bitmap, 2, 2,
+        WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(width == 2 && height == 2, "got %ux%u\n", width, height);
+
+    hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppGray), "got %s\n", debugstr_guid(&format));
+
+    memset(buffer, 0xcc, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 2, sizeof(buffer), buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i=0; i<4; i++)
+        ok(abs(buffer[i] - fant_expected[i]) <= 1, "%u: expected %u, got %u\n",
+            i, fant_expected[i], buffer[i]);
+
+    /* one scanline at a time */
+    rect.X = 0;
+    rect.Width = 2;
+    rect.Height = 1;
+    for (i=0; i<2; i++)
+    {
+        rect.Y = i;
+        hr = IWICBitmapScaler_CopyPixels(scaler, &rect, 2, 2, buffer + i * 2);
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+    }
+    for (i=0; i<4; i++)
+        ok(abs(buffer[i] - fant_expected[i]) <= 1, "%u: expected %u, got %u\n",
+            i, fant_expected[i], buffer[i]);
+
+    IWICBitmapScaler_Release(scaler);
+
+    /* Cubic keeps a flat image flat */
+    memset(buffer, 77, 16);
+    IWICBitmap_Release(bitmap);
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat8bppGray,
+        4, 16, buffer, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource*)bitmap, 7, 5,
+        WICBitmapInterpolationModeCubic);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    memset(buffer, 0, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 7, sizeof(buffer), buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i=0; i<35; i++)
+        ok(buffer[i] == 77, "%u: expected 77, got %u\n", i, buffer[i]);
+
+    /* changes to the source show up in the next CopyPixels call */
+    hr = IWICBitmap_Lock(bitmap, NULL, WICBitmapLockWrite, &lock);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    hr = IWICBitmapLock_GetDataPointer(lock, &size, &data);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(size == 16, "got %u\n", size);
+    memset(data, 150, 16);
+    IWICBitmapLock_Release(lock);
+
+    memset(buffer, 0, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 7, sizeof(buffer), buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i=0; i<35; i++)
+        ok(buffer[i] == 150, "%u: expected 150, got %u\n", i, buffer[i]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+
+    /* Linear interpolates between pixel centers */
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 1, &GUID_WICPixelFormat8bppGray,
+        2, sizeof(ramp_data), (BYTE*)ramp_data, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource*)bitmap, 4, 1,
+        WICBitmapInterpolationModeLinear);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    memset(buffer, 0xcc, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(buffer), buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i=0; i<4; i++)
+        ok(abs(buffer[i] - linear_expected[i]) <= 2, "%u: expected %u, got %u\n",
+            i, linear_expected[i], buffer[i]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -966,6 +1089,7 @@ START_TEST(bitmap)
     test_CreateBitmapFromHICON();
     test_CreateBitmapFromHBITMAP();
     test_clipper();
+    test_scaler();
 
     IWICImagingFactory_Release(factory);
 
@@ -295,6 +295,45 @@ static const BYTE bits_32bppBGRA[] = {
 static const struct bitmap_data testdata_32bppBGRA = {
     &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA, 4, 2, 96.0, 96.0};
 
+static const BYTE bits_16bppBGR565[] = {
+    0x1f,0x00, 0xe0,0x07, 0x00,0xf8, 0x00,0x00,
+    0xe0,0xff, 0x1f,0xf8, 0xff,0x07, 0xff,0xff};
+static const struct bitmap_data testdata_16bppBGR565 = {
+    &GUID_WICPixelFormat16bppBGR565, 16, bits_16bppBGR565, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_16bppBGR555[] = {
+    0x1f,0x00, 0xe0,0x03, 0x00,0x7c, 0x00,0x00,
+    0xe0,0x7f, 0x1f,0x7c, 0xff,0x03, 0xff,0x7f};
+static const struct bitmap_data testdata_16bppBGR555 = {
+    &GUID_WICPixelFormat16bppBGR555, 16, bits_16bppBGR555, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_8bppGray[] = {
+    0, 80, 160, 255,
+    255, 160, 80, 0};
+static const struct bitmap_data testdata_8bppGray = {
+    &GUID_WICPixelFormat8bppGray, 8, bits_8bppGray, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_8bppGray_32bppBGRA[] = {
+    0,0,0,255, 80,80,80,255, 160,160,160,255, 255,255,255,255,
+    255,255,255,255, 160,160,160,255, 80,80,80,255, 0,0,0,255};
+static const struct bitmap_data testdata_8bppGray_32bppBGRA = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_8bppGray_32bppBGRA, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_32bppBGRA_alpha[] = {
+    200,100,50,128, 10,20,30,0, 255,255,255,255, 40,80,120,64};
+static const struct bitmap_data testdata_32bppBGRA_alpha = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA_alpha, 4, 1, 96.0, 96.0};
+
+static const BYTE bits_32bppPBGRA[] = {
+    100,50,25,128, 0,0,0,0, 255,255,255,255, 10,20,30,64};
+static const struct bitmap_data testdata_32bppPBGRA = {
+    &GUID_WICPixelFormat32bppPBGRA, 32, bits_32bppPBGRA, 4, 1, 96.0, 96.0};
+
+static const BYTE bits_32bppPBGRA_32bppBGRA[] = {
+    199,99,49,128, 0,0,0,0, 255,255,255,255, 39,79,119,64};
+static const struct bitmap_data testdata_32bppPBGRA_32bppBGRA = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppPBGRA_32bppBGRA, 4, 1, 96.0, 96.0};
+
 static void test_conversion(const struct bitmap_data *src, const struct bitmap_data *dst, const char *name, BOOL todo)
 {
     BitmapTestSrc *src_obj;
@@ -319,6 +358,33 @@ static void test_conversion(const struct bitmap_data *src, const struct bitmap_d
     DeleteTestBitmap(src_obj);
 }
 
+static void test_conversion_large(void)
+{
+    struct bitmap_data src = {&GUID_WICPixelFormat24bppBGR, 24, NULL, 256, 200, 96.0, 96.0};
+    struct bitmap_data dst = {&GUID_WICPixelFormat32bppBGRA, 32, NULL, 256, 200, 96.0, 96.0};
+    BYTE *src_bits, *dst_bits;
+    UINT i;
+
+    /* large enough that the source is read in several pieces */
+    src_bits = HeapAlloc(GetProcessHeap(), 0, src.width * src.height * 3);
+    dst_bits = HeapAlloc(GetProcessHeap(), 0, dst.width * dst.height * 4);
+
+    for (i=0; i<src.width * src.height; i++)
+    {
+        src_bits[i*3] = dst_bits[i*4] = i;
+        src_bits[i*3+1] = dst_bits[i*4+1] = i >> 8;
+        src_bits[i*3+2] = dst_bits[i*4+2] = i * 7;
+        dst_bits[i*4+3] = 0xff;
+    }
+
+    src.bits = src_bits;
+    dst.bits = dst_bits;
+    test_conversion(&src, &dst, "large 24bppBGR -> 32bppBGRA", 0);
+
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, dst_bits);
+}
+
 static void test_invalid_conversion(void)
 {
     BitmapTestSrc *src_obj;
@@ -659,6 +725,18 @@ START_TEST(converter)
 
     test_conversion(&testdata_32bppBGR, &testdata_24bppRGB, "32bppBGR -> 24bppRGB", 0);
     test_conversion(&testdata_24bppRGB, &testdata_32bppBGR, "24bppRGB -> 32bppBGR", 0);
+    test_conversion(&testdata_24bppBGR, &testdata_32bppBGRA, "24bppBGR -> 32bppBGRA", 0);
+    test_conversion(&testdata_24bppRGB, &testdata_32bppBGRA, "24bppRGB -> 32bppBGRA", 0);
+    test_conversion(&testdata_32bppBGRA, &testdata_24bppBGR, "32bppBGRA -> 24bppBGR", 0);
+
+    test_conversion(&testdata_16bppBGR565, &testdata_32bppBGRA, "16bppBGR565 -> 32bppBGRA", 0);
+    test_conversion(&testdata_16bppBGR555, &testdata_32bppBGRA, "16bppBGR555 -> 32bppBGRA", 0);
+    test_conversion(&testdata_8bppGray, &testdata_8bppGray_32bppBGRA, "8bppGray -> 32bppBGRA", 0);
+
+    test_conversion(&testdata_32bppBGRA_alpha, &testdata_32bppPBGRA, "32bppBGRA -> 32bppPBGRA", 0);
+    test_conversion(&testdata_32bppPBGRA, &testdata_32bppPBGRA_32bppBGRA, "32bppPBGRA -> 32bppBGRA", 0);
+
+    test_conversion_large();
 
     test_invalid_conversion();
     test_default_converter();
@@ -585,6 +585,78 @@ static void test_png_palette(void)
     IWICBitmapDecoder_Release(decoder);
 }
 
+/* 3x4 pixel 24bpp RGB PNG image */
+static const char png_3x4_rgb[] = {
+  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+  0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+  0x08, 0x02, 0x00, 0x00, 0x00, 0xc4, 0x4f, 0x12, 0x50, 0x00, 0x00, 0x00,
+  0x31, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x74, 0x68, 0x60,
+  0x72, 0x6c, 0x64, 0x76, 0x6a, 0x62, 0x10, 0x0c, 0x98, 0x20, 0x14, 0x38,
+  0x51, 0x38, 0x68, 0x12, 0x83, 0x62, 0xc2, 0x02, 0xa5, 0xc4, 0x85, 0xca,
+  0x49, 0x8b, 0x18, 0x0c, 0x0b, 0x36, 0x18, 0x15, 0x6e, 0x34, 0x2e, 0xda,
+  0x04, 0x00, 0xd9, 0x0c, 0x0c, 0x91, 0x63, 0x63, 0x81, 0x73, 0x00, 0x00,
+  0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+};
+
+static const BYTE png_3x4_bgr[] = {
+  0x80, 0x40, 0x01, 0x81, 0x41, 0x02, 0x82, 0x42, 0x03,
+  0x90, 0x50, 0x11, 0x91, 0x51, 0x12, 0x92, 0x52, 0x13,
+  0xa0, 0x60, 0x21, 0xa1, 0x61, 0x22, 0xa2, 0x62, 0x23,
+  0xb0, 0x70, 0x31, 0xb1, 0x71, 0x32, 0xb2, 0x72, 0x33
+};
+
+static void test_png_rows(void)
+{
+    HRESULT hr;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    GUID format;
+    WICRect rc;
+    BYTE buf[36];
+
+    decoder = create_decoder(png_3x4_rgb, sizeof(png_3x4_rgb));
+    ok(decoder != 0, "Failed to load PNG image data\n");
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_GetPixelFormat(frame, &format);
+    ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR),
+       "got wrong format %s\n", debugstr_guid(&format));
+
+    rc.X = 0;
+    rc.Y = 4;
+    rc.Width = 3;
+    rc.Height = 1;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 9, sizeof(buf), buf);
+    ok(hr == E_INVALIDARG, "expected E_INVALIDARG, got %#x\n", hr);
+
+    /* a row in the middle first, then one we have already passed */
+    rc.Y = 1;
+    memset(buf, 0, sizeof(buf));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 9, sizeof(buf), buf);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(!memcmp(buf, png_3x4_bgr + 9, 9), "row 1 data mismatch\n");
+
+    rc.X = 1;
+    rc.Y = 0;
+    rc.Width = 2;
+    memset(buf, 0, sizeof(buf));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 6, sizeof(buf), buf);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(!memcmp(buf, png_3x4_bgr + 3, 6), "row 0 data mismatch\n");
+
+    memset(buf, 0, sizeof(buf));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 9, sizeof(buf), buf);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(!memcmp(buf, png_3x4_bgr, sizeof(png_3x4_bgr)), "image data mismatch\n");
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -597,6 +669,7 @@ START_TEST(pngformat)
 
     test_color_contexts();
     test_png_palette();
+    test_png_rows();
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
@@ -72,6 +72,7 @@ static void *libtiff_handle;
 MAKE_FUNCPTR(TIFFClientOpen);
 MAKE_FUNCPTR(TIFFClose);
 MAKE_FUNCPTR(TIFFCurrentDirOffset);
+MAKE_FUNCPTR(TIFFCurrentDirectory);
 MAKE_FUNCPTR(TIFFGetField);
 MAKE_FUNCPTR(TIFFIsByteSwapped);
 MAKE_FUNCPTR(TIFFNumberOfDirectories);
@@ -106,6 +107,7 @@ static void *load_libtiff(void)
         LOAD_FUNCPTR(TIFFClientOpen);
         LOAD_FUNCPTR(TIFFClose);
         LOAD_FUNCPTR(TIFFCurrentDirOffset);
+        LOAD_FUNCPTR(TIFFCurrentDirectory);
         LOAD_FUNCPTR(TIFFGetField);
         LOAD_FUNCPTR(TIFFIsByteSwapped);
         LOAD_FUNCPTR(TIFFNumberOfDirectories);
@@ -258,8 +260,10 @@ typedef struct {
     TiffDecoder *parent;
     UINT index;
     tiff_decode_info decode_info;
-    INT cached_tile_x, cached_tile_y;
-    BYTE *cached_tile;
+    INT cached_tile_y; /* row of tiles held in cached_tiles */
+    UINT cached_tile_count;
+    BYTE *cached_tiles;
+    BYTE *cached_tile_valid;
 } TiffFrameDecode;
 
 static const IWICBitmapFrameDecodeVtbl TiffFrameDecode_Vtbl;
@@ -735,14 +739,20 @@ static HRESULT WINAPI TiffDecoder_GetFrame(IWICBitmapDecoder *iface,
             result->parent = This;
             result->index = index;
             result->decode_info = decode_info;
-            result->cached_tile_x = -1;
-            result->cached_tile = HeapAlloc(GetProcessHeap(), 0, decode_info.tile_size);
-
-            if (result->cached_tile)
+            result->cached_tile_y = -1;
+            result->cached_tile_count = decode_info.tiled ? decode_info.tiles_across : 1;
+            result->cached_tiles = HeapAlloc(GetProcessHeap(), 0,
+                decode_info.tile_size * result->cached_tile_count);
+            result->cached_tile_valid = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+                result->cached_tile_count);
+
+            if (result->cached_tiles && result->cached_tile_valid)
                 *ppIBitmapFrame = &result->IWICBitmapFrameDecode_iface;
             else
             {
                 hr = E_OUTOFMEMORY;
+                HeapFree(GetProcessHeap(), 0, result->cached_tiles);
+                HeapFree(GetProcessHeap(), 0, result->cached_tile_valid);
                 HeapFree(GetProcessHeap(), 0, result);
             }
         }
@@ -818,7 +828,8 @@ static ULONG WINAPI TiffFrameDecode_Release(IWICBitmapFrameDecode *iface)
 
     if (ref == 0)
     {
-        HeapFree(GetProcessHeap(), 0, This->cached_tile);
+        HeapFree(GetProcessHeap(), 0, This->cached_tiles);
+        HeapFree(GetProcessHeap(), 0, This->cached_tile_valid);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -920,23 +931,33 @@ static HRESULT TiffFrameDecode_ReadTile(TiffFrameDecode *This, UINT tile_x, UINT
     HRESULT hr=S_OK;
     tsize_t ret;
     int swap_bytes;
+    BYTE *tile;
 
-    swap_bytes = pTIFFIsByteSwapped(This->parent->tiff);
+    if (tile_y != This->cached_tile_y)
+    {
+        memset(This->cached_tile_valid, 0, This->cached_tile_count);
+        This->cached_tile_y = tile_y;
+    }
 
-    ret = pTIFFSetDirectory(This->parent->tiff, This->index);
+    tile = This->cached_tiles + tile_x * This->decode_info.tile_size;
 
-    if (ret == -1)
+    swap_bytes = pTIFFIsByteSwapped(This->parent->tiff);
+
+    /* Setting the directory rereads it from the file, so only do it if
+     * another frame has been decoded since we last read a tile. */
+    if (pTIFFCurrentDirectory(This->parent->tiff) != This->index &&
+        !pTIFFSetDirectory(This->parent->tiff, This->index))
         hr = E_FAIL;
 
     if (hr == S_OK)
     {
         if (This->decode_info.tiled)
         {
-            ret = pTIFFReadEncodedTile(This->parent->tiff, tile_x + tile_y * This->decode_info.tiles_across, This->cached_tile, This->decode_info.tile_size);
+            ret = pTIFFReadEncodedTile(This->parent->tiff, tile_x + tile_y * This->decode_info.tiles_across, tile, This->decode_info.tile_size);
         }
         else
         {
-            ret = pTIFFReadEncodedStrip(This->parent->tiff, tile_y, This->cached_tile, This->decode_info.tile_size);
+            ret = pTIFFReadEncodedStrip(This->parent->tiff, tile_y, tile, This->decode_info.tile_size);
         }
 
         if (ret == -1)
@@ -949,7 +970,7 @@ static HRESULT TiffFrameDecode_ReadTile(TiffFrameDecode *This, UINT tile_x, UINT
         {
             UINT sample_count = This->decode_info.samples;
 
-            reverse_bgr8(sample_count, This->cached_tile, This->decode_info.tile_width,
+            reverse_bgr8(sample_count, tile, This->decode_info.tile_width,
                 This->decode_info.tile_height, This->decode_info.tile_width * sample_count);
         }
     }
@@ -966,7 +987,7 @@ static HRESULT TiffFrameDecode_ReadTile(TiffFrameDecode *This, UINT tile_x, UINT
         case 16:
             for (row=0; row<This->decode_info.tile_height; row++)
             {
-                sample = This->cached_tile + row * This->decode_info.tile_stride;
+                sample = tile + row * This->decode_info.tile_stride;
                 for (i=0; i<samples_per_row; i++)
                 {
                     temp = sample[1];
@@ -992,17 +1013,14 @@ static HRESULT TiffFrameDecode_ReadTile(TiffFrameDecode *This, UINT tile_x, UINT
             return E_FAIL;
         }
 
-        end = This->cached_tile+This->decode_info.tile_size;
+        end = tile+This->decode_info.tile_size;
 
-        for (byte = This->cached_tile; byte != end; byte++)
+        for (byte = tile; byte != end; byte++)
             *byte = ~(*byte);
     }
 
     if (hr == S_OK)
-    {
-        This->cached_tile_x = tile_x;
-        This->cached_tile_y = tile_y;
-    }
+        This->cached_tile_valid[tile_x] = TRUE;
 
     return hr;
 }
@@ -1051,11 +1069,13 @@ static HRESULT WINAPI TiffFrameDecode_CopyPixels(IWICBitmapFrameDecode *iface,
 
     EnterCriticalSection(&This->parent->lock);
 
-    for (tile_x=min_tile_x; tile_x <= max_tile_x; tile_x++)
+    /* Walk the tiles a row at a time, so callers reading a scanline at a
+     * time only decode each row of tiles once. */
+    for (tile_y=min_tile_y; tile_y <= max_tile_y; tile_y++)
     {
-        for (tile_y=min_tile_y; tile_y <= max_tile_y; tile_y++)
+        for (tile_x=min_tile_x; tile_x <= max_tile_x; tile_x++)
         {
-            if (tile_x != This->cached_tile_x || tile_y != This->cached_tile_y)
+            if (tile_y != This->cached_tile_y || !This->cached_tile_valid[tile_x])
             {
                 hr = TiffFrameDecode_ReadTile(This, tile_x, tile_y);
             }
@@ -1089,7 +1109,7 @@ static HRESULT WINAPI TiffFrameDecode_CopyPixels(IWICBitmapFrameDecode *iface,
                 dst_tilepos = pbBuffer + (cbStride * ((rc.Y + tile_y * This->decode_info.tile_height) - prc->Y)) +
                     ((This->decode_info.bpp * ((rc.X + tile_x * This->decode_info.tile_width) - prc->X) + 7) / 8);
 
-                hr = copy_pixels(This->decode_info.bpp, This->cached_tile,
+                hr = copy_pixels(This->decode_info.bpp, This->cached_tiles + tile_x * This->decode_info.tile_size,
                     This->decode_info.tile_width, This->decode_info.tile_height, This->decode_info.tile_stride,
                     &rc, cbStride, cbBufferSize, dst_tilepos);
             }